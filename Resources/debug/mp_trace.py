@@ -0,0 +1,156 @@
+# coding=utf-8
+#
+# mp_trace.py - decode a planner trace captured from $trd or $trb
+#
+# Usage: mp_trace.py [logfile]     (reads stdin if no file is given)
+#
+# The log may contain anything else the board printed. Lines holding a trace header
+# {"trh":...} start a new trace, and the {"tr":[...]} or {"trb":"..."} lines after it are
+# its entries. See g2core/plan_trace.h for the entry layout.
+#
+import json
+import struct
+import sys
+
+TRACE_VERSION = 1
+ENTRY_FORMAT = '<IIfHHBBBBB3x'      # mpTraceEntry_t
+ENTRY_SIZE = struct.calcsize(ENTRY_FORMAT)
+
+EVENTS = ['NONE', 'COMMIT', 'BACKPLAN', 'PLAN', 'RUN', 'STARVED', 'UNPLANNED', 'FREE',
+          'STEP_LIMIT']
+
+BLOCK_TYPES = ['NULL', 'ALINE', 'ARC', 'DWELL', 'COMMAND', 'JSON_WAIT', 'TOOL',
+               'SPINDLE_SPEED', 'STOP', 'END']
+
+HINTS = ['NO_HINT', 'COMMAND_BLOCK', 'PERFECT_ACCELERATION', 'PERFECT_DECELERATION',
+         'PERFECT_CRUISE', 'MIXED_ACCELERATION', 'MIXED_DECELERATION', 'ZERO_VELOCITY',
+         'ZERO_BUMP', 'SYMMETRIC_BUMP', 'ASYMMETRIC_BUMP']
+
+ZOID_EXITS = ['', '1a', '1c', '1d', '2a', '2c', '2d', '3c', '3s', '3s2', '3d2', '3a2']
+
+FIELDS = ['time', 'event', 'buffer', 'linenum', 'queued', 'block_type', 'hint',
+          'zoid_exit', 'meet_iterations', 'value']
+
+
+def name(table, index):
+    if index < len(table):
+        return table[index]
+    return str(index)
+
+
+def decode_binary(hex_string):
+    raw = bytes.fromhex(hex_string)
+    entries = []
+    for offset in range(0, len(raw) - ENTRY_SIZE + 1, ENTRY_SIZE):
+        (time, linenum, value, buffer, queued, event, block_type, hint,
+         zoid_exit, meet_iterations) = struct.unpack_from(ENTRY_FORMAT, raw, offset)
+        entries.append({'time': time, 'event': event, 'buffer': buffer, 'linenum': linenum,
+                        'queued': queued, 'block_type': block_type, 'hint': hint,
+                        'zoid_exit': zoid_exit, 'meet_iterations': meet_iterations,
+                        'value': value})
+    return entries
+
+
+def load_traces(lines):
+    traces = []
+    for line in lines:
+        line = line.strip()
+        if not line.startswith('{"tr'):
+            continue
+        try:
+            obj = json.loads(line)
+        except ValueError:
+            continue
+        if 'trh' in obj:
+            header = obj['trh']
+            if header['ver'] != TRACE_VERSION or header['size'] != ENTRY_SIZE:
+                sys.stderr.write("unsupported trace version %s, entry size %s\n" %
+                                 (header['ver'], header['size']))
+                header = None
+            traces.append({'header': header, 'entries': []})
+        elif traces and traces[-1]['header'] is not None:
+            if 'tr' in obj:
+                traces[-1]['entries'].append(dict(zip(FIELDS, obj['tr'])))
+            elif 'trb' in obj:
+                traces[-1]['entries'].extend(decode_binary(obj['trb']))
+    return [t for t in traces if t['header'] is not None]
+
+
+def print_entries(header, entries):
+    tick_ms = header['tick_us'] / 1000.0
+    start = entries[0]['time'] if entries else 0
+    print("%10s  %-9s %4s %7s %3s  %-9s %-20s %-4s %4s %10s" %
+          ('ms', 'event', 'buf', 'line', 'q', 'type', 'hint', 'exit', 'iter', 'value'))
+    for e in entries:
+        print("%10.3f  %-9s %4d %7d %3d  %-9s %-20s %-4s %4d %10.3f" %
+              ((e['time'] - start) * tick_ms, name(EVENTS, e['event']), e['buffer'],
+               e['linenum'], e['queued'], name(BLOCK_TYPES, e['block_type']),
+               name(HINTS, e['hint']), name(ZOID_EXITS, e['zoid_exit']),
+               e['meet_iterations'], e['value']))
+
+
+def print_summary(header, entries):
+    tick_ms = header['tick_us'] / 1000.0
+    counts = {}
+    for e in entries:
+        event = name(EVENTS, e['event'])
+        counts[event] = counts.get(event, 0) + 1
+
+    print("\n%d entries of %d recorded" % (header['entries'], header['recorded']))
+    print("events: " + ", ".join("%s %d" % (event, counts[event]) for event in EVENTS
+                                 if event in counts))
+
+    # starvation - blocks that started with too little planned behind them
+    for e in entries:
+        if name(EVENTS, e['event']) in ('STARVED', 'UNPLANNED'):
+            print("%-9s line %d (buffer %d) with %.1f ms queued" %
+                  (name(EVENTS, e['event']), e['linenum'], e['buffer'], e['value']))
+
+    limited = [e for e in entries if name(EVENTS, e['event']) == 'STEP_LIMIT']
+    if limited:
+        low = min(limited, key=lambda e: e['value'])
+        print("step rate limited: %d blocks, lowest %.1f mm/min, line %d (buffer %d)" %
+              (len(limited), low['value'], low['linenum'], low['buffer']))
+
+    runs = [e for e in entries if name(EVENTS, e['event']) == 'RUN']
+    if runs:
+        low = min(runs, key=lambda e: e['value'])
+        print("least queued at RUN: %.1f ms, line %d (buffer %d)" %
+              (low['value'], low['linenum'], low['buffer']))
+
+    # margin between a block's last planning and its start
+    planned = {}
+    margins = []
+    for e in entries:
+        event = name(EVENTS, e['event'])
+        if event == 'PLAN':
+            planned[e['buffer']] = e
+        elif event == 'RUN' and e['buffer'] in planned:
+            plan = planned.pop(e['buffer'])
+            margins.append(((e['time'] - plan['time']) * tick_ms, e))
+    if margins:
+        low_margin, low = min(margins, key=lambda m: m[0])
+        average = sum(m[0] for m in margins) / len(margins)
+        print("PLAN to RUN: %d blocks, least %.3f ms (line %d), average %.3f ms" %
+              (len(margins), low_margin, low['linenum'], average))
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1]) as log:
+            lines = log.readlines()
+    else:
+        lines = sys.stdin.readlines()
+
+    traces = load_traces(lines)
+    if not traces:
+        sys.stderr.write("no trace found\n")
+        sys.exit(1)
+    for trace in traces:
+        print_entries(trace['header'], trace['entries'])
+        print_summary(trace['header'], trace['entries'])
+        print("")
+
+
+if __name__ == '__main__':
+    main()
@@ -62,6 +62,10 @@ enum hwPlatform {
 #define COORDS      6           // number of supported coordinate systems (1-6)
 #define PWMS        2           // number of supported PWM channels
 
+/***** Planner queue *****/
+
+#define PLANNER_BUFFER_POOL_SIZE 48     // planner buffers (blocks)
+
 
 ////////////////////////////
 /////// ARM VERSION ////////
@@ -0,0 +1,79 @@
+# ----------------------------------------------------------------------------
+# This file is part of the Synthetos g2core project
+
+
+# To compile:
+#   make BOARD=sim
+# Or, with a CONFIG from boards.mk:
+#   make CONFIG=Sim
+#
+# The result is a host executable that runs the firmware against a virtual clock.
+# Feed it gcode on stdin (or name a file) and read the responses on stdout:
+#   ./bin/sim/g2core.elf < part.gcode
+
+
+
+##########
+# BOARDs for use directly from the make command line (with default settings) or by CONFIGs.
+
+ifeq ("$(BOARD)","sim")
+    # The host simulator. There is no chip - Motate is replaced by the sim layer
+    # in board/sim/motate, and the code is built with the host compiler.
+
+    BASE_BOARD = g2core-sim
+    DEVICE_DEFINES += MOTATE_BOARD="sim"
+    DEVICE_DEFINES += SETTINGS_FILE=${SETTINGS_FILE}
+
+    # Planner queue depth, for scaling runs of the benchmark, e.g.
+    #   make BOARD=sim PLANNER_BUFFERS=512
+    ifneq ("$(PLANNER_BUFFERS)","")
+        DEVICE_DEFINES += PLANNER_BUFFER_POOL_SIZE=$(PLANNER_BUFFERS)
+    endif
+
+    # Arcs expanded into lines instead of queued as arc blocks, to compare them, e.g.
+    #   make BOARD=sim ARC_BLOCKS=0
+    ifneq ("$(ARC_BLOCKS)","")
+        DEVICE_DEFINES += ARC_BLOCKS=$(ARC_BLOCKS)
+    endif
+
+    # Integer step prep instead of float, to compare them, e.g.
+    #   make BOARD=sim STEP_PREP=1
+    ifneq ("$(STEP_PREP)","")
+        DEVICE_DEFINES += STEP_PREP=$(STEP_PREP)
+    endif
+
+    # The packed DDA kernel (1), or step bitmaps played by the sim's DMA instead of a DDA
+    # interrupt per tick (2), in place of the branched kernel, e.g.
+    #   make BOARD=sim DDA_KERNEL=2
+    ifneq ("$(DDA_KERNEL)","")
+        DEVICE_DEFINES += DDA_KERNEL=$(DDA_KERNEL)
+    endif
+
+    # Another kinematic model (see kinematics.h), e.g.
+    #   make BOARD=sim KINEMATICS=1
+    ifneq ("$(KINEMATICS)","")
+        DEVICE_DEFINES += KINEMATICS=$(KINEMATICS)
+    endif
+
+    # Latency profile left out, to time the DDA kernel alone, e.g.
+    #   make BOARD=sim PF_ENABLE=0
+    ifneq ("$(PF_ENABLE)","")
+        DEVICE_DEFINES += PF_ENABLE=$(PF_ENABLE)
+    endif
+endif
+
+
+
+##########
+# The general g2core-sim BASE_BOARD.
+
+ifeq ("$(BASE_BOARD)","g2core-sim")
+    _BOARD_FOUND = 1
+
+    BOARD_PATH = ./board/sim
+    SOURCE_DIRS += ${BOARD_PATH} ${BOARD_PATH}/motate
+
+    PLATFORM_BASE = ${BOARD_PATH}/motate/host
+
+    include $(PLATFORM_BASE).mk
+endif
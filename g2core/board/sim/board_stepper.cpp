@@ -0,0 +1,155 @@
+/*
+ * board_stepper.cpp - board-specific code for stepper.cpp
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "board_stepper.h"
+
+// These are identical to board_stepper.h, except for the word "extern"
+SimStepper motor_1{};
+SimStepper motor_2{};
+SimStepper motor_3{};
+SimStepper motor_4{};
+SimStepper motor_5{};
+SimStepper motor_6{};
+
+Stepper* Motors[MOTORS] = {&motor_1, &motor_2, &motor_3, &motor_4, &motor_5, &motor_6};
+uint32_t sim_step_masks[1 << MOTORS];
+
+/*
+ * sim_count_packed_steps() - add the pulses the packed DDA kernel sent to the motors' counts
+ */
+void sim_count_packed_steps() {
+    for (uint32_t steps = 1; steps < (1 << MOTORS); steps++) {
+        for (uint8_t motor = 0; motor < MOTORS; motor++) {
+            if (steps & (1 << motor)) {
+                ((SimStepper *)Motors[motor])->countSteps(sim_step_masks[steps]);
+            }
+        }
+        sim_step_masks[steps] = 0;
+    }
+}
+
+/**** Sim step DMA ****
+ *
+ *  The firings alternate between writing a word (on whole DDA ticks from the start) and
+ *  clearing the step pins. Every rising edge the words make is checked for:
+ *    - a clean edge - the pin was low
+ *    - at least one DDA tick since the pin's last rising edge
+ *    - at least half a DDA tick of direction setup since the motor last reversed
+ */
+
+simStepDma_t sim_step_dma;
+
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+extern dda_timer_type dda_timer;            // stepper.cpp
+
+#define SIM_TICK_NS         ((uint64_t)(1000000000 / FREQUENCY_DDA) - 1)    // less a ns of firing time rounding
+#define SIM_HALF_TICK_NS    ((uint64_t)(1000000000 / (2 * FREQUENCY_DDA)) - 1)
+
+static struct {
+    Motate::Sim::InterruptSource source;
+    const boardStepBitmap_t *bitmap;        // bitmap playing, nullptr if none
+    uint32_t ticks;                         // its length
+    uint32_t tick;                          // next word to write
+    bool clear_phase;                       // true if the last firing cleared the step pins
+    uint64_t rise_ns[MOTORS];               // last rising edge of each motor's step pin
+} _dma;
+
+static void _check_rising_edges(const uint32_t old_a, const uint32_t old_b, const uint32_t word_a, const uint32_t word_b) {
+    const uint64_t now = Motate::Sim::now();
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        const uint32_t pin = board_step_pins[motor].mask;
+        const uint32_t word = (board_step_pins[motor].port == 'A') ? word_a : word_b;
+        const uint32_t old = (board_step_pins[motor].port == 'A') ? old_a : old_b;
+        if ((pin == 0) || !(word & pin)) {
+            continue;
+        }
+        SimStepper *m = (SimStepper *)Motors[motor];
+        if ((old & pin) ||
+            ((m->step_count != 0) && (now - _dma.rise_ns[motor] < SIM_TICK_NS)) ||
+            ((m->direction_changes != 0) && (now - m->direction_ns < SIM_HALF_TICK_NS))) {
+            sim_step_dma.faults++;
+        }
+        _dma.rise_ns[motor] = now;
+        sim_step_dma.pulses++;
+        m->countSteps(1);
+    }
+}
+
+static void _step_dma_interrupt() {
+    _dma.clear_phase = !_dma.clear_phase;
+    if (_dma.clear_phase) {
+        board_step_end();
+        return;
+    }
+    if (_dma.bitmap == nullptr) {           // nothing was queued when the last bitmap ended
+        Motate::Sim::stopPeriodic(&_dma.source);
+        return;
+    }
+    Motate::Port32<'A'> port_a;
+    Motate::Port32<'B'> port_b;
+    const uint32_t word_a = _dma.bitmap->port_a[_dma.tick];
+    const uint32_t word_b = _dma.bitmap->port_b[_dma.tick];
+    _check_rising_edges(port_a.getOutputValue(), port_b.getOutputValue(), word_a, word_b);
+    port_a.set(word_a);
+    port_b.set(word_b);
+    sim_step_dma.words++;
+
+    if (++_dma.tick == _dma.ticks) {        // end of buffer - the DDA interrupt loads the next segment
+        _dma.bitmap = nullptr;
+        dda_timer.setInterruptPending();
+    }
+}
+
+/*
+ * board_step_dma_start() - play a step bitmap from the next whole tick
+ * board_step_dma_stop()  - drop the bitmap playing and clear the step pins
+ */
+void board_step_dma_start(const boardStepBitmap_t *bitmap, const uint32_t ticks) {
+    _dma.bitmap = bitmap;
+    _dma.ticks = ticks;
+    _dma.tick = 0;
+    if (!_dma.source.running) {
+        _dma.clear_phase = false;           // the first firing is the half tick in between
+        Motate::Sim::startPeriodic(&_dma.source);
+    }
+}
+
+void board_step_dma_stop() {
+    Motate::Sim::stopPeriodic(&_dma.source);
+    _dma.bitmap = nullptr;
+    board_step_end();
+}
+#endif // DDA_KERNEL_BITMAP
+
+void board_stepper_init() {
+    for (uint8_t motor = 0; motor < MOTORS; motor++) { Motors[motor]->init(); }
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    Motate::Sim::registerSource(&_dma.source, "step_dma", -1, &_step_dma_interrupt, 2 * FREQUENCY_DDA);
+    Motate::Sim::setLevel(&_dma.source, Motate::kInterruptPriorityHighest);
+#endif
+}
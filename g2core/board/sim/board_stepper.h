@@ -0,0 +1,175 @@
+/*
+ * board_stepper.h - board-specific code for stepper.h
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BOARD_STEPPER_H_ONCE
+#define BOARD_STEPPER_H_ONCE
+
+#include "hardware.h"  // for MOTORS
+#include "stepper.h"
+
+void sim_count_packed_steps();
+
+/**** SimStepper - a motor that counts its steps ****
+ *
+ * Stands in for StepDirStepper<>. It keeps the state a step/dir driver would see:
+ * the step line, the direction line, and the enable. Every rising step edge moves
+ * the position one microstep in the current direction, so the final positions can be
+ * compared with what the planner asked for.
+ */
+
+struct SimStepper : Stepper {
+    bool _step_high;
+    bool _enabled;
+    uint8_t _direction;
+    uint8_t _microsteps;
+    float _power_level;
+    int32_t position;                       // microsteps, signed by direction
+    uint32_t step_count;                    // total step pulses emitted
+    uint32_t direction_changes;             // total direction reversals
+    uint64_t direction_ns;                  // virtual time of the last reversal
+
+    SimStepper() : Stepper{}, _step_high{false}, _enabled{false}, _direction{STEP_INITIAL_DIRECTION},
+                   _microsteps{1}, _power_level{0.0}, position{0}, step_count{0}, direction_changes{0},
+                   direction_ns{0} {};
+
+    /* Functions that must be implemented in subclasses */
+
+    bool canStep() override { return true; };
+
+    void setMicrosteps(const uint8_t microsteps) override { _microsteps = microsteps; };
+
+    void _enableImpl() override { _enabled = true; };
+
+    void _disableImpl() override { _enabled = false; };
+
+    void stepStart() override {
+        if (!_step_high) {
+            _step_high = true;
+            countSteps(1);
+        }
+    };
+
+    void countSteps(const uint32_t steps) {
+        step_count += steps;
+        position += (_direction == DIRECTION_CW) ? (int32_t)steps : -(int32_t)steps;
+    };
+
+    void stepEnd() override { _step_high = false; };
+
+    void setDirection(uint8_t new_direction) override {
+        if (new_direction != _direction) {
+            sim_count_packed_steps();       // pulses so far were in the old direction
+            direction_changes++;
+            direction_ns = Motate::Sim::now();
+        }
+        _direction = new_direction;
+    };
+
+    void setPowerLevel(float new_pl) override { _power_level = new_pl; };
+};
+
+extern SimStepper motor_1;
+extern SimStepper motor_2;
+extern SimStepper motor_3;
+extern SimStepper motor_4;
+extern SimStepper motor_5;
+extern SimStepper motor_6;
+
+extern Stepper* Motors[MOTORS];
+
+void board_stepper_init();
+
+/**** Packed step ports (see "DDA step kernel" in stepper.h) ****
+ *
+ *  The step pins are on virtual ports A and B (see sim-pinout.h). The port writes are the
+ *  packed kernel's real cost. Counting the pulses for the run report is the sim's own, so
+ *  it is kept off the tick: each tick only counts its step mask, and the masks are folded
+ *  into the motors by sim_count_packed_steps() on a reversal and before the report.
+ */
+
+#define BOARD_STEP_PORTS
+
+constexpr stStepPin_t board_step_pins[MOTORS] = {
+    st_step_pin<Motate::kSocket1_StepPinNumber>(),
+    st_step_pin<Motate::kSocket2_StepPinNumber>(),
+    st_step_pin<Motate::kSocket3_StepPinNumber>(),
+    st_step_pin<Motate::kSocket4_StepPinNumber>(),
+    st_step_pin<Motate::kSocket5_StepPinNumber>(),
+    st_step_pin<Motate::kSocket6_StepPinNumber>()
+};
+
+constexpr stStepPortMasks board_step_port_a{'A', board_step_pins};
+constexpr stStepPortMasks board_step_port_b{'B', board_step_pins};
+
+extern uint32_t sim_step_masks[1 << MOTORS];    // ticks that stepped each set of motors
+
+inline void board_step_start(uint32_t steps) {
+    Motate::Port32<'A'>().set(board_step_port_a.mask[steps]);
+    Motate::Port32<'B'>().set(board_step_port_b.mask[steps]);
+    sim_step_masks[steps]++;
+}
+
+inline void board_step_end() {
+    Motate::Port32<'A'>().clear(board_step_port_a.all);
+    Motate::Port32<'B'>().clear(board_step_port_b.all);
+}
+
+/**** Step bitmaps and DMA (see "DDA step kernel" in stepper.h) ****
+ *
+ *  A bitmap holds each port's word for every tick. The sim's DMA is an interrupt source
+ *  at twice the DDA frequency that writes the next words to the ports on whole ticks and
+ *  clears the step pins half a tick later. At the end of a bitmap it pends the DDA
+ *  interrupt, and a bitmap the loader queues from there plays on from the next tick.
+ *
+ *  Each rising edge on the ports is checked the way a driver would see it and counted
+ *  into its motor's position (see board_stepper.cpp). Checker faults are in sim_step_dma.
+ */
+
+#define BOARD_STEP_DMA
+
+typedef struct boardStepBitmap {
+    uint32_t port_a[STEP_BITMAP_TICKS];
+    uint32_t port_b[STEP_BITMAP_TICKS];
+} boardStepBitmap_t;
+
+inline void board_step_bitmap_set(boardStepBitmap_t *bitmap, const uint32_t tick, const uint32_t steps) {
+    bitmap->port_a[tick] = board_step_port_a.mask[steps];
+    bitmap->port_b[tick] = board_step_port_b.mask[steps];
+}
+
+void board_step_dma_start(const boardStepBitmap_t *bitmap, const uint32_t ticks);
+void board_step_dma_stop();
+
+typedef struct simStepDma {
+    uint64_t words;                         // ticks played from bitmaps
+    uint64_t pulses;                        // rising edges on the step pins
+    uint64_t faults;                        // pulses that broke one of the checks
+} simStepDma_t;
+
+extern simStepDma_t sim_step_dma;
+
+#endif  // BOARD_STEPPER_H_ONCE
@@ -0,0 +1,382 @@
+/*
+ * hardware.cpp - general hardware support functions (host simulator)
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "g2core.h"  // #1
+#include "config.h"  // #2
+#include "hardware.h"
+#include "controller.h"
+#include "planner.h"
+#include "stepper.h"
+#include "text_parser.h"
+#include "board_xio.h"
+#include "board_stepper.h"
+#include "sim_bench.h"
+
+#include "MotateUtilities.h"
+#include "MotateUniqueID.h"
+#include "MotatePower.h"
+#include "MotateUART.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**** Simulator run control ****
+ *
+ *  Every pass through the controller loop costs sim_loop_ns of virtual time. That is
+ *  when the periodic sources (DDA, dwell, SysTick) get to fire, so the loop sees the
+ *  same interleaving it would on hardware at roughly that loop rate.
+ *
+ *  The run ends when the input is exhausted and the machine has been idle for
+ *  SIM_IDLE_EXIT_NS, or when --max-seconds of virtual time have passed. In --bench
+ *  mode the same idle test moves on to the next program (see sim_bench.h).
+ */
+
+#define SIM_IDLE_EXIT_NS    500000000ULL    // 500 ms of idle after end of input
+
+static uint64_t sim_loop_ns = 10000;        // 10 uSec per controller loop pass
+static uint64_t sim_max_ns = 0;             // 0 = no limit
+static uint64_t sim_idle_since_ns = 0;      // 0 = not idle
+
+static void _sim_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [--loop-us N] [--max-seconds N] [gcode_file]\n", name);
+    fprintf(stderr, "       %s --bench [--json results.json] [--setup text] [--loop-us N] program...\n", name);
+    fprintf(stderr, "       %s --meet-accuracy N [--seed S] [--json results.json]\n", name);
+    fprintf(stderr, "       %s --segment-drift HOURS [--seed S] [--json results.json]\n", name);
+    fprintf(stderr, "       %s --kinematics N [--seed S] [--json results.json]\n", name);
+    fprintf(stderr, "       %s --mesh N [--seed S] [--json results.json]\n", name);
+    fprintf(stderr, "       %s --tram N [--seed S] [--json results.json]\n", name);
+    fprintf(stderr, "  reads stdin if no file is given; responses go to stdout, the run summary to stderr\n");
+    exit(1);
+}
+
+/*
+ * sim_parse_args() - handle the host command line (called from main() before setup())
+ */
+
+void sim_parse_args(int argc, char **argv)
+{
+    const char *input_path = nullptr;
+    const char *json_path = nullptr;
+    const char *setup = nullptr;
+    bool bench = false;
+    uint32_t meet_samples = 0;
+    float drift_hours = 0;
+    uint32_t kinematics_samples = 0;
+    uint32_t mesh_samples = 0;
+    uint32_t tram_samples = 0;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if ((strcmp(argv[i], "--meet-accuracy") == 0) && (i+1 < argc)) {
+            meet_samples = atol(argv[++i]);
+        } else if ((strcmp(argv[i], "--segment-drift") == 0) && (i+1 < argc)) {
+            drift_hours = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "--kinematics") == 0) && (i+1 < argc)) {
+            kinematics_samples = atol(argv[++i]);
+        } else if ((strcmp(argv[i], "--mesh") == 0) && (i+1 < argc)) {
+            mesh_samples = atol(argv[++i]);
+        } else if ((strcmp(argv[i], "--tram") == 0) && (i+1 < argc)) {
+            tram_samples = atol(argv[++i]);
+        } else if ((strcmp(argv[i], "--seed") == 0) && (i+1 < argc)) {
+            seed = atol(argv[++i]);
+        } else if ((strcmp(argv[i], "--json") == 0) && (i+1 < argc)) {
+            json_path = argv[++i];
+        } else if ((strcmp(argv[i], "--setup") == 0) && (i+1 < argc)) {
+            setup = argv[++i];
+        } else if ((strcmp(argv[i], "--loop-us") == 0) && (i+1 < argc)) {
+            sim_loop_ns = (uint64_t)(atof(argv[++i]) * 1000.0);
+        } else if ((strcmp(argv[i], "--max-seconds") == 0) && (i+1 < argc)) {
+            sim_max_ns = (uint64_t)(atof(argv[++i]) * 1000000000.0);
+        } else if ((argv[i][0] == '-') && (argv[i][1] != 0)) {
+            _sim_usage(argv[0]);
+        } else if (bench) {
+            continue;                       // programs are collected below
+        } else {
+            input_path = argv[i];
+        }
+    }
+    if (sim_loop_ns == 0) {
+        sim_loop_ns = 1;
+    }
+    if (meet_samples != 0) {
+        sim_bench_meet_accuracy(meet_samples, seed, json_path);
+        exit(0);
+    }
+    if (drift_hours > 0) {
+        sim_bench_segment_drift(drift_hours, seed, json_path);
+        exit(0);
+    }
+    if (kinematics_samples != 0) {
+        sim_bench_kinematics(kinematics_samples, seed, json_path);
+        exit(0);
+    }
+    if (mesh_samples != 0) {
+        sim_bench_mesh(mesh_samples, seed, json_path);
+        exit(0);
+    }
+    if (tram_samples != 0) {
+        sim_bench_tram(tram_samples, seed, json_path);
+        exit(0);
+    }
+    if (bench) {
+        sim_bench_init(json_path, setup);
+        for (int i = 1; i < argc; i++) {
+            if ((strcmp(argv[i], "--json") == 0) || (strcmp(argv[i], "--loop-us") == 0) ||
+                (strcmp(argv[i], "--max-seconds") == 0) || (strcmp(argv[i], "--setup") == 0)) {
+                i++;
+            } else if (argv[i][0] != '-') {
+                sim_bench_add_program(argv[i]);
+            }
+        }
+        if (!sim_bench_next_program(0)) {
+            _sim_usage(argv[0]);
+        }
+        return;
+    }
+    if (!Motate::SimStdio::open(input_path)) {
+        fprintf(stderr, "sim: cannot open %s\n", input_path);
+        exit(1);
+    }
+}
+
+/*
+ * _sim_report() - print the run summary to stderr
+ */
+
+static void _sim_report()
+{
+    Motate::SimStdio::flush();
+    fprintf(stderr, "sim: virtual time %.6f s, %llu input bytes\n",
+            (double)Motate::Sim::now() / 1e9, (unsigned long long)Motate::SimStdio::bytesRead());
+
+    for (Motate::Sim::InterruptSource *src = Motate::Sim::firstSource(); src != nullptr; src = src->next) {
+        char name[24];
+        if (src->number < 0) {
+            snprintf(name, sizeof(name), "%s", src->name);
+        } else {
+            snprintf(name, sizeof(name), "%s%d", src->name, src->number);
+        }
+        fprintf(stderr, "sim: isr %-14s level %d calls %llu\n", name, src->level, (unsigned long long)src->call_count);
+    }
+    sim_count_packed_steps();
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        SimStepper *m = (SimStepper *)Motors[motor];
+        fprintf(stderr, "sim: motor %d steps %lu position %ld reversals %lu\n", motor+1,
+                (unsigned long)m->step_count, (long)m->position, (unsigned long)m->direction_changes);
+    }
+    if (sim_step_dma.words != 0) {
+        fprintf(stderr, "sim: step dma words %llu pulses %llu faults %llu\n", (unsigned long long)sim_step_dma.words,
+                (unsigned long long)sim_step_dma.pulses, (unsigned long long)sim_step_dma.faults);
+    }
+}
+
+/*
+ * _sim_check_exit() - end the run when there is nothing left to do
+ */
+
+static void _sim_check_exit()
+{
+    uint64_t now = Motate::Sim::now();
+
+    if ((sim_max_ns != 0) && (now >= sim_max_ns)) {
+        _sim_report();
+        fprintf(stderr, "sim: --max-seconds reached\n");
+        exit(3);
+    }
+    if (!Motate::SimStdio::atEndOfInput() || mp_has_runnable_buffer() || st_runtime_isbusy()) {
+        sim_idle_since_ns = 0;
+        return;
+    }
+    if (sim_idle_since_ns == 0) {
+        sim_idle_since_ns = now;
+        return;
+    }
+    if (now - sim_idle_since_ns >= SIM_IDLE_EXIT_NS) {
+        if (sim_bench_active()) {
+            uint64_t idle_since_ns = sim_idle_since_ns;
+            sim_idle_since_ns = 0;
+            if (sim_bench_next_program(idle_since_ns)) {
+                return;
+            }
+            sim_bench_report();
+            exit(0);
+        }
+        _sim_report();
+        exit(0);
+    }
+}
+
+/*
+ * hardware_init() - lowest level hardware init
+ */
+
+void hardware_init()
+{
+    board_hardware_init();
+}
+
+/*
+ * hardware_periodic() - callback from the controller loop - TIME CRITICAL.
+ *
+ *  On the sim this is where virtual time passes for the main loop.
+ */
+
+stat_t hardware_periodic()
+{
+    Motate::Sim::advance(sim_loop_ns);
+    _sim_check_exit();
+    return STAT_OK;
+}
+
+/*
+ * hw_hard_reset() - reset system now
+ * hw_flash_loader() - enter flash loader to reflash board
+ */
+
+void hw_hard_reset(void)
+{
+    Motate::System::reset(/*boootloader: */ false); // arg=0 resets the system
+}
+
+void hw_flash_loader(void)
+{
+    Motate::System::reset(/*boootloader: */ true);  // arg=1 erases FLASH and enters FLASH loader
+}
+
+/*
+ * _get_id() - get a human readable signature
+ *
+ *	Produce a unique deviceID based on the factory calibration data.
+ *	Truncate to SYS_ID_DIGITS length
+ */
+
+void _get_id(char *id)
+{
+    strncpy(id, Motate::UUID, SYS_ID_LEN - 1);     // id is SYS_ID_LEN long (see hw_get_id())
+    id[SYS_ID_LEN - 1] = 0;
+}
+
+/***** END OF SYSTEM FUNCTIONS *****/
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * hw_get_fbs() - get firmware build string
+ */
+
+stat_t hw_get_fbs(nvObj_t *nv)
+{
+    nv->valuetype = TYPE_STRING;
+    ritorno(nv_copy_string(nv, G2CORE_FIRMWARE_BUILD_STRING));
+    return (STAT_OK);
+}
+
+/*
+ * hw_get_fbc() - get configuration settings file
+ */
+
+stat_t hw_get_fbc(nvObj_t *nv)
+{
+    nv->valuetype = TYPE_STRING;
+    #ifdef SETTINGS_FILE
+    #define settings_file_string1(s) #s
+    #define settings_file_string2(s) settings_file_string1(s)
+    ritorno(nv_copy_string(nv, settings_file_string2(SETTINGS_FILE)));
+    #undef settings_file_string1
+    #undef settings_file_string2
+    #else
+    ritorno(nv_copy_string(nv, "<default-settings>"));
+    #endif
+
+    return (STAT_OK);
+}
+
+/*
+ * hw_get_id() - get device ID (signature)
+ */
+
+stat_t hw_get_id(nvObj_t *nv)
+{
+    char tmp[SYS_ID_LEN];
+    _get_id(tmp);
+    nv->valuetype = TYPE_STRING;
+    ritorno(nv_copy_string(nv, tmp));
+    return (STAT_OK);
+}
+
+/*
+ * hw_flash() - invoke FLASH loader from command input
+ */
+stat_t hw_flash(nvObj_t *nv)
+{
+    hw_flash_loader();
+    return(STAT_OK);
+}
+
+/*
+ * hw_set_hv() - set hardware version number
+ */
+stat_t hw_set_hv(nvObj_t *nv)
+{
+    return (STAT_OK);
+}
+
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_fb[] =  "[fb]  firmware build %18.2f\n";
+static const char fmt_fbs[] = "[fbs] firmware build \"%s\"\n";
+static const char fmt_fbc[] = "[fbc] firmware config \"%s\"\n";
+static const char fmt_fv[] =  "[fv]  firmware version%16.2f\n";
+static const char fmt_cv[] =  "[cv]  configuration version%11.2f\n";
+static const char fmt_hp[] =  "[hp]  hardware platform%15.2f\n";
+static const char fmt_hv[] =  "[hv]  hardware version%16.2f\n";
+static const char fmt_id[] =  "[id]  g2core ID%21s\n";
+
+void hw_print_fb(nvObj_t *nv)  { text_print(nv, fmt_fb);}   // TYPE_FLOAT
+void hw_print_fbs(nvObj_t *nv) { text_print(nv, fmt_fbs);}  // TYPE_STRING
+void hw_print_fbc(nvObj_t *nv) { text_print(nv, fmt_fbc);}  // TYPE_STRING
+void hw_print_fv(nvObj_t *nv)  { text_print(nv, fmt_fv);}   // TYPE_FLOAT
+void hw_print_cv(nvObj_t *nv)  { text_print(nv, fmt_cv);}   // TYPE_FLOAT
+void hw_print_hp(nvObj_t *nv)  { text_print(nv, fmt_hp);}   // TYPE_FLOAT
+void hw_print_hv(nvObj_t *nv)  { text_print(nv, fmt_hv);}   // TYPE_FLOAT
+void hw_print_id(nvObj_t *nv)  { text_print(nv, fmt_id);}   // TYPE_STRING
+
+#endif //__TEXT_MODE
@@ -0,0 +1,132 @@
+/*
+ * MotateBuffer.h - Motate ring buffers for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MOTATEBUFFER_H_ONCE
+#define MOTATEBUFFER_H_ONCE
+
+#include <stdint.h>
+#include <string.h>
+
+namespace Motate {
+
+    /**** RXBuffer - ring buffer filled from a device ****
+     *
+     * On hardware the device DMAs into _data and the buffer only tracks offsets. On the sim
+     * the "transfer" is a pull from the owner's readByte() into the free part of the ring,
+     * done whenever the write offset is asked for. The interface is what xio.cpp's
+     * LineRXBuffer expects.
+     *
+     * owner_type is a pointer to a device providing:
+     *   int16_t readByte();    // next byte, or -1 if there is nothing to read right now
+     */
+
+    template <uint16_t _size, typename owner_type, typename base_type = char>
+    struct RXBuffer {
+        static_assert(((_size-1)&_size)==0, "RXBuffer size must be 2^N");
+
+        owner_type _owner;
+        base_type _data[_size];
+
+        uint16_t _read_offset;                  // start of data not yet consumed
+        uint16_t _write_offset;                 // next location to be filled
+        uint16_t _last_known_write_offset;      // as last seen by _getWriteOffset()
+
+        RXBuffer(owner_type owner) : _owner {owner} {};
+
+        void init() {
+            memset(_data, 0, sizeof(_data));
+            _read_offset = 0;
+            _write_offset = 0;
+            _last_known_write_offset = 0;
+        };
+
+        uint16_t _getNextOffset(const uint16_t offset) { return ((offset + 1) & (_size-1)); };
+
+        // Pull whatever the device has into the free part of the ring
+        void _restartTransfer() {
+            while (_getNextOffset(_write_offset) != _read_offset) {
+                int16_t c = _owner->readByte();
+                if (c < 0) {
+                    break;
+                }
+                _data[_write_offset] = (base_type)c;
+                _write_offset = _getNextOffset(_write_offset);
+            }
+        };
+
+        uint16_t _getWriteOffset() {
+            _restartTransfer();
+            _last_known_write_offset = _write_offset;
+            return _write_offset;
+        };
+
+        bool _canBeRead(const uint16_t offset) { return (offset != _getWriteOffset()); };
+
+        bool isEmpty() { return (_read_offset == _getWriteOffset()); };
+
+        int16_t read() {
+            if (isEmpty()) {
+                return -1;
+            }
+            base_type c = _data[_read_offset];
+            _read_offset = _getNextOffset(_read_offset);
+            return c;
+        };
+
+        void flush() {
+            _read_offset = _getWriteOffset();
+        };
+    };
+
+    /**** TXBuffer - write-through to the device ****
+     *
+     * owner_type is a pointer to a device providing:
+     *   int16_t write(const char *buffer, int16_t length);
+     *   void flush();
+     */
+
+    template <uint16_t _size, typename owner_type, typename base_type = char>
+    struct TXBuffer {
+        owner_type _owner;
+
+        TXBuffer(owner_type owner) : _owner {owner} {};
+
+        void init() {};
+
+        int16_t write(const base_type *buffer, int16_t length) {
+            return _owner->write(buffer, length);
+        };
+
+        void flush() {
+            _owner->flush();
+        };
+    };
+
+} // namespace Motate
+
+#endif // MOTATEBUFFER_H_ONCE
@@ -0,0 +1,233 @@
+/*
+ * MotatePins.h - Motate pins for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MOTATEPINS_H_ONCE
+#define MOTATEPINS_H_ONCE
+
+#include <stdint.h>
+#include <functional>
+
+#include "SimMotate.h"
+#include "MotateTimers.h"  // PWM pins are timer channels on the SAM parts, and users expect Timeout from here
+
+namespace Motate {
+
+    typedef const int16_t pin_number;
+
+    enum PinMode {
+        kUnchanged      = 0,
+        kOutput         = 1,
+        kInput          = 2,
+    };
+
+    enum PinOptions {
+        kNormal         = 0,
+        kTotem          = 0,
+        kPullUp         = 1<<1,
+        kWiredAnd       = 1<<2,
+        kDriveLowOnly   = 1<<2,
+        kWiredAndPull   = (1<<1)|(1<<2),
+        kDebounce       = 1<<4,
+        kStartHigh      = 1<<5,
+        kStartLow       = 1<<6,
+        kPWMPinInverted = 1<<7,
+    };
+
+    enum PinInterruptOptions {
+        kPinInterruptsOff          = 0,
+        kPinInterruptOnChange      = 1<<1,
+        kPinInterruptOnRisingEdge  = 1<<2,
+        kPinInterruptOnFallingEdge = 1<<3,
+        kPinInterruptOnLowLevel    = 1<<4,
+        kPinInterruptOnHighLevel   = 1<<5,
+
+        kPinInterruptPriorityHighest = 1<<10,
+        kPinInterruptPriorityHigh    = 1<<11,
+        kPinInterruptPriorityMedium  = 1<<12,
+        kPinInterruptPriorityLow     = 1<<13,
+        kPinInterruptPriorityLowest  = 1<<14,
+    };
+
+    /**** Pin - a GPIO on the virtual board ****
+     *
+     * Pins hold their own state. Pin number -1 is the NullPin, which compiles out
+     * in the same way as on hardware (isNull() is a compile-time constant).
+     */
+
+    template <int16_t pinNum>
+    struct Pin {
+        bool _value;
+        uint32_t _options;
+
+        static constexpr bool isNull() { return pinNum < 0; };
+
+        // Virtual ports of 32 pins: pin number = (portLetter - 'A') * 32 + bit. See Port32 below
+        static constexpr uint8_t portLetter = (pinNum < 0) ? 0 : ('A' + (pinNum / 32));
+        static constexpr uint32_t mask = (pinNum < 0) ? 0 : (1u << (pinNum % 32));
+
+        Pin() : _value {false}, _options {kNormal} {};
+        Pin(const PinMode type, const uint32_t options = kNormal) : _value {(options & (kStartHigh|kPullUp)) != 0}, _options {options} {};
+
+        void setMode(const PinMode type) {};
+        void setOptions(const uint32_t options, const bool fromConstructor = false) { _options = options; };
+
+        void set() { _value = true; };
+        void clear() { _value = false; };
+        void write(const bool value) { _value = value; };
+        void toggle() { _value = !_value; };
+        bool get() { return _value; };
+        bool getInputValue() { return _value; };
+        bool getOutputValue() { return _value; };
+
+        operator bool() { return _value; };
+        Pin &operator=(const bool value) { write(value); return *this; };
+
+        // The simulator (or a test harness) drives inputs with this
+        void simulateInput(const bool value) { _value = value; };
+    };
+
+    typedef Pin<-1> NullPin;
+
+    /**** Port32 - a virtual port, written a mask at a time like the SAM PIO set and clear registers ****/
+
+    template <uint8_t portLetter>
+    struct Port32 {
+        static uint32_t _value;
+
+        void set(const uint32_t mask) { _value |= mask; };
+        void clear(const uint32_t mask) { _value &= ~mask; };
+        uint32_t getOutputValue() { return _value; };
+    };
+
+    template <uint8_t portLetter>
+    uint32_t Port32<portLetter>::_value = 0;
+
+    template <int16_t pinNum>
+    struct InputPin : Pin<pinNum> {
+        InputPin() : Pin<pinNum>(kInput) {};
+        InputPin(const uint32_t options) : Pin<pinNum>(kInput, options) {};
+    };
+
+    template <int16_t pinNum>
+    struct OutputPin : Pin<pinNum> {
+        OutputPin() : Pin<pinNum>(kOutput) {};
+        OutputPin(const uint32_t options) : Pin<pinNum>(kOutput, options) {};
+
+        OutputPin &operator=(const bool value) { this->write(value); return *this; };
+    };
+
+    template <int16_t pinNum>
+    struct IRQPin : Pin<pinNum> {
+        std::function<void(void)> _interrupt_handler;
+
+        IRQPin(const uint32_t options, const std::function<void(void)> &&interrupt,
+               const uint32_t interrupt_settings = kPinInterruptOnChange|kPinInterruptPriorityMedium)
+            : Pin<pinNum>(kInput, options), _interrupt_handler {interrupt} {};
+
+        void setInterrupts(const uint32_t interrupts) {};
+
+        // Drive the input and fire the pin change interrupt if the value changed
+        void simulateInput(const bool value) {
+            if (value != this->_value) {
+                this->_value = value;
+                if (_interrupt_handler) {
+                    _interrupt_handler();
+                }
+            }
+        };
+    };
+
+    template <int16_t pinNum>
+    struct PWMOutputPin : Pin<pinNum> {
+        float _duty;
+        uint32_t _frequency;
+
+        PWMOutputPin() : Pin<pinNum>(kOutput), _duty {0.0}, _frequency {0} {};
+        PWMOutputPin(const uint32_t options, const uint32_t freq = 0) : Pin<pinNum>(kOutput, options), _duty {0.0}, _frequency {freq} {};
+
+        void setFrequency(const uint32_t freq) { _frequency = freq; };
+        void setInterrupts(const uint32_t interrupts) {};
+        void setSyncMode(const uint32_t mode, const uint8_t channel) {};
+
+        void write(const float duty) { _duty = duty; this->_value = (duty > 0.0); };
+        float get() { return _duty; };
+        void toggle() { write(_duty > 0.0 ? 0.0 : 1.0); };
+
+        operator float() { return _duty; };
+        PWMOutputPin &operator=(const float duty) { write(duty); return *this; };
+    };
+
+    // Digital outputs that can be driven with a PWM duty value, but only switch on/off
+    template <int16_t pinNum>
+    struct PWMLikeOutputPin : OutputPin<pinNum> {
+        PWMLikeOutputPin() : OutputPin<pinNum>() {};
+        PWMLikeOutputPin(const uint32_t options, const uint32_t freq = 0) : OutputPin<pinNum>(options) {};
+
+        void setFrequency(const uint32_t freq) {};
+        void write(const float duty) { this->_value = (duty >= 0.5); };
+        operator float() { return this->_value ? 1.0 : 0.0; };
+        PWMLikeOutputPin &operator=(const float duty) { write(duty); return *this; };
+    };
+
+    /**** ADC ****/
+
+    struct ADC_Module {
+        static void startSampling() {};
+    };
+
+    template <int16_t pinNum>
+    struct ADCPin : Pin<pinNum> {
+        uint16_t _raw;
+
+        ADCPin() : Pin<pinNum>(kInput), _raw {0} {};
+        ADCPin(const uint32_t options) : Pin<pinNum>(kInput, options), _raw {0} {};
+
+        void setInterrupts(const uint32_t interrupts) {};
+        uint16_t getRaw() { return _raw; };
+        uint16_t getValue() { return _raw; };
+        int32_t getTop() { return 4095; };
+
+        // The simulator (or a test harness) drives conversions with this
+        void simulateSample(const uint16_t raw) {
+            _raw = raw;
+            interrupt();
+        };
+
+        static void interrupt();
+    };
+
+    // Pins without a specialized ADC interrupt do nothing with the sample
+    template <int16_t pinNum>
+    void ADCPin<pinNum>::interrupt() {};
+
+} // namespace Motate
+
+// Board pin assignments (see board/sim/motate_pin_assignments.h)
+#include "motate_pin_assignments.h"
+
+#endif // MOTATEPINS_H_ONCE
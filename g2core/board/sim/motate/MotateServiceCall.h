@@ -0,0 +1,61 @@
+/*
+ * MotateServiceCall.h - Motate software interrupts for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MOTATESERVICECALL_H_ONCE
+#define MOTATESERVICECALL_H_ONCE
+
+#include "MotateTimers.h"
+
+namespace Motate {
+
+    /**** ServiceCall - a software triggered interrupt ****
+     *
+     * On the SAM parts these are otherwise unused peripheral IRQs that are fired by
+     * writing the NVIC pending register. Here they are sim interrupt sources with
+     * no frequency, so they only run when setInterruptPending() is called.
+     */
+
+    template <uint8_t number>
+    struct ServiceCall {
+        Sim::InterruptSource _source;
+
+        ServiceCall() {
+            Sim::registerSource(&_source, "service_call", number, &ServiceCall::interrupt, 0);
+        };
+
+        void setInterrupts(const uint32_t interrupts) { Sim::setLevel(&_source, interrupts); };
+        void setInterruptPending() { Sim::setPending(&_source); };
+        uint32_t getInterruptCause() { return kInterruptOnSoftwareTrigger; };
+
+        // Must be specialized by the user of the service call (see stepper.cpp)
+        static void interrupt();
+    };
+
+} // namespace Motate
+
+#endif // MOTATESERVICECALL_H_ONCE
@@ -0,0 +1,149 @@
+/*
+ * MotateTimers.h - Motate timers and SysTick for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MOTATETIMERS_H_ONCE
+#define MOTATETIMERS_H_ONCE
+
+#include <stdint.h>
+#include <functional>
+
+#include "SimMotate.h"
+
+namespace Motate {
+
+    enum TimerMode {
+        kTimerUp            = 0,
+        kTimerUpToMatch     = 1,
+        kTimerUpDown        = 2,
+        kTimerUpDownToMatch = 3,
+    };
+
+    enum TimerSyncMode {
+        kTimerSyncManually = 0,
+        kTimerSyncDMA      = 1,
+    };
+
+    // Interrupt options are plain flags so they can be or'ed with the pin interrupt options
+    enum InterruptOptions {
+        kInterruptsOff              = 0,
+
+        kInterruptOnMatch           = 1<<1,
+        kInterruptOnOverflow        = 1<<2,
+        kInterruptOnSoftwareTrigger = 1<<3,
+
+        kInterruptPriorityHighest   = 1<<5,
+        kInterruptPriorityHigh      = 1<<6,
+        kInterruptPriorityMedium    = 1<<7,
+        kInterruptPriorityLow       = 1<<8,
+        kInterruptPriorityLowest    = 1<<9,
+    };
+
+    /**** TimerChannel - a hardware timer on the virtual clock ****/
+
+    template <uint8_t timerNum, uint8_t channelNum>
+    struct TimerChannel {
+        Sim::InterruptSource _source;
+
+        TimerChannel(const TimerMode mode, const uint32_t freq) {
+            Sim::registerSource(&_source, "timer", timerNum, &TimerChannel::interrupt, freq);
+        };
+
+        void setFrequency(const uint32_t freq) { Sim::setFrequency(&_source, freq); };
+        uint32_t getFrequency() { return _source.frequency; };
+
+        void setInterrupts(const uint32_t interrupts) { Sim::setLevel(&_source, interrupts); };
+        void setInterruptPending() { Sim::setPending(&_source); };
+        uint32_t getInterruptCause() { return kInterruptOnOverflow; };
+
+        void start() { Sim::startPeriodic(&_source); };
+        void stop() { Sim::stopPeriodic(&_source); };
+        bool isRunning() { return _source.running; };
+
+        // Must be specialized by the user of the timer (see stepper.cpp)
+        static void interrupt();
+    };
+
+    /**** SysTick ****/
+
+    struct SysTickEvent {
+        const std::function<void(void)> callback;
+        SysTickEvent *next;
+    };
+
+    struct SysTickTimer_t {
+        volatile uint32_t _ticks;
+        SysTickEvent *_first_event;
+        Sim::InterruptSource _source;
+
+        SysTickTimer_t();
+
+        uint32_t getValue() {
+            if (!Sim::mainLoopRunning()) {
+                Sim::advanceOnRead();
+            }
+            return _ticks;
+        };
+
+        void registerEvent(SysTickEvent *new_event);
+        void unregisterEvent(SysTickEvent *event);
+
+        static void interrupt();
+    };
+
+    extern SysTickTimer_t SysTickTimer;
+
+    void delay(uint32_t milliseconds);
+
+    /**** Timeout - a one-shot millisecond timeout on SysTick ****/
+
+    struct Timeout {
+        uint32_t start_, delay_;
+
+        Timeout() : start_ {0}, delay_ {0} {};
+
+        bool isSet() { return (start_ > 0); };
+        bool isPast() {
+            if (!isSet()) {
+                return false;
+            }
+            return ((SysTickTimer.getValue() - start_) > delay_);
+        };
+        void set(uint32_t delay) {
+            start_ = SysTickTimer.getValue();
+            if (start_ == 0) { start_ = 1; }
+            delay_ = delay;
+        };
+        void clear() {
+            start_ = 0;
+            delay_ = 0;
+        };
+    };
+
+} // namespace Motate
+
+#endif // MOTATETIMERS_H_ONCE
@@ -0,0 +1,92 @@
+/*
+ * MotateUART.h - Motate UART over host stdio
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MOTATEUART_H_ONCE
+#define MOTATEUART_H_ONCE
+
+#include <stdint.h>
+#include <functional>
+
+#include "MotatePins.h"
+
+namespace Motate {
+
+    enum class UARTMode {
+        NoParity             = 0,
+        RTSCTSFlowControl    = 1<<4,
+        XonXoffFlowControl   = 1<<5,
+    };
+
+    /**** Host stdio channel ****
+     *
+     * The sim's only serial channel. Input comes from stdin (or a file given on the
+     * command line), output goes to stdout. Reads never block - if nothing is ready the
+     * main loop simply goes round again and the virtual clock advances. Run the sim under
+     * socat to put it on a pty, e.g.:
+     *
+     *   socat PTY,link=/tmp/g2sim,raw,echo=0 EXEC:./bin/sim/g2core.elf
+     */
+
+    struct SimStdio {
+        static bool open(const char *input_path);   // nullptr for stdin
+        static void openBuffer(const char *data, uint32_t length);  // read from memory (not copied)
+        static void setOutputEnabled(bool enabled); // false discards everything written
+        static int16_t readByte();
+        static int16_t write(const char *buffer, int16_t length);
+        static void flush();
+        static bool atEndOfInput();                 // input is closed and fully consumed
+        static uint64_t bytesRead();
+    };
+
+    template <pin_number rxPinNumber, pin_number txPinNumber, pin_number rtsPinNumber = -1, pin_number ctsPinNumber = -1>
+    struct UART {
+        std::function<void(bool)> _connection_callback;
+        bool _connected;
+
+        UART(const uint32_t baud = 115200, const UARTMode options = UARTMode::NoParity) : _connected {false} {};
+
+        void init() {};
+
+        // stdio is "connected" from the start. Report it as soon as someone listens.
+        void setConnectionCallback(std::function<void(bool)> &&callback) {
+            _connection_callback = std::move(callback);
+            if (!_connected) {
+                _connected = true;
+                _connection_callback(true);
+            }
+        };
+
+        int16_t readByte() { return SimStdio::readByte(); };
+        int16_t write(const char *buffer, int16_t length) { return SimStdio::write(buffer, length); };
+        void flush() { SimStdio::flush(); };
+        void flushRead() {};
+    };
+
+} // namespace Motate
+
+#endif // MOTATEUART_H_ONCE
@@ -0,0 +1,379 @@
+/*
+ * SimMotate.cpp - virtual clock and interrupt controller for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SimMotate.h"
+#include "MotateTimers.h"
+#include "MotateUART.h"
+#include "MotatePower.h"
+#include "MotateUniqueID.h"
+
+namespace Motate {
+namespace Sim {
+
+    static InterruptSource *_first_source = nullptr;
+    static uint64_t _now_ns = 0;
+    static uint8_t _current_level = kLevelMainLoop;
+    static uint32_t _irq_disable_depth = 0;
+    static bool _main_loop_running = false;
+    static uint64_t _preempted_ns[kLevelHighest+1];
+
+    static void _runPending(const uint8_t above_level);
+
+    void registerSource(InterruptSource *src, const char *name, int16_t number, isr_t handler, uint32_t frequency)
+    {
+        memset(src, 0, sizeof(InterruptSource));
+        src->name = name;
+        src->number = number;
+        src->handler = handler;
+        src->level = kLevelMedium;
+        src->frequency = frequency;
+        src->next = _first_source;
+        _first_source = src;
+    }
+
+    InterruptSource *firstSource() { return _first_source; }
+
+    void setLevel(InterruptSource *src, uint32_t interrupt_options)
+    {
+        src->enabled = (interrupt_options != kInterruptsOff);
+        if      (interrupt_options & kInterruptPriorityHighest) { src->level = kLevelHighest; }
+        else if (interrupt_options & kInterruptPriorityHigh)    { src->level = kLevelHigh; }
+        else if (interrupt_options & kInterruptPriorityMedium)  { src->level = kLevelMedium; }
+        else if (interrupt_options & kInterruptPriorityLow)     { src->level = kLevelLow; }
+        else if (interrupt_options & kInterruptPriorityLowest)  { src->level = kLevelLowest; }
+    }
+
+    /*
+     * _runPending() - run pending ISRs above a priority level, highest first
+     *
+     *  A handler that pends a higher priority source is preempted right there (the nested
+     *  call), and anything of lower priority it pends runs after it returns (the loop).
+     */
+    static void _runPending(const uint8_t above_level)
+    {
+        while (_irq_disable_depth == 0) {
+            InterruptSource *best = nullptr;
+            for (InterruptSource *src = _first_source; src != nullptr; src = src->next) {
+                if (src->pending && src->enabled && (src->level > above_level) &&
+                    ((best == nullptr) || (src->level > best->level))) {
+                    best = src;
+                }
+            }
+            if (best == nullptr) {
+                return;
+            }
+            best->pending = false;
+            best->call_count++;
+
+            uint8_t saved_level = _current_level;
+            uint64_t start_ns = hostNs();
+            _current_level = best->level;
+            best->handler();
+            _current_level = saved_level;
+            uint64_t elapsed_ns = hostNs() - start_ns;
+            best->host_ns += elapsed_ns;
+            _preempted_ns[saved_level] += elapsed_ns;
+        }
+    }
+
+    void setPending(InterruptSource *src)
+    {
+        src->pending = true;
+        _runPending(_current_level);
+    }
+
+    static void _scheduleNext(InterruptSource *src)
+    {
+        src->next_fire_ns = src->start_ns + ((src->fire_count + 1) * 1000000000ULL) / src->frequency;
+    }
+
+    void startPeriodic(InterruptSource *src)
+    {
+        if (src->running || (src->frequency == 0)) {
+            return;
+        }
+        src->running = true;
+        src->start_ns = _now_ns;
+        src->fire_count = 0;
+        _scheduleNext(src);
+    }
+
+    void stopPeriodic(InterruptSource *src)
+    {
+        src->running = false;
+    }
+
+    void setFrequency(InterruptSource *src, uint32_t frequency)
+    {
+        src->frequency = frequency;
+        if (src->running) {
+            src->running = false;
+            startPeriodic(src);
+        }
+    }
+
+    uint64_t now() { return _now_ns; }
+
+    /*
+     * advance() - run the virtual clock forward, firing periodic sources in time order
+     */
+    void advance(uint64_t ns)
+    {
+        const uint64_t end_ns = _now_ns + ns;
+        while (true) {
+            InterruptSource *soonest = nullptr;
+            for (InterruptSource *src = _first_source; src != nullptr; src = src->next) {
+                if (src->running && (src->next_fire_ns <= end_ns) &&
+                    ((soonest == nullptr) || (src->next_fire_ns < soonest->next_fire_ns))) {
+                    soonest = src;
+                }
+            }
+            if (soonest == nullptr) {
+                break;
+            }
+            _now_ns = soonest->next_fire_ns;
+            soonest->fire_count++;
+            _scheduleNext(soonest);
+            setPending(soonest);
+        }
+        _now_ns = end_ns;
+    }
+
+    void advanceOnRead() { advance(1000000); }     // busy-waits on SysTick before the loop starts
+
+    uint64_t hostNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+    }
+
+    uint8_t currentLevel() { return _current_level; }
+    uint64_t preemptedNs(uint8_t level) { return _preempted_ns[level]; }
+
+    void setMainLoopRunning(bool running) { _main_loop_running = running; }
+    bool mainLoopRunning() { return _main_loop_running; }
+
+    void disableIRQ() { _irq_disable_depth++; }
+
+    void enableIRQ()
+    {
+        if ((_irq_disable_depth > 0) && (--_irq_disable_depth == 0)) {
+            _runPending(_current_level);
+        }
+    }
+
+    void breakpoint(const char *file, int line)
+    {
+        fprintf(stderr, "sim: breakpoint at %s:%d (t=%.6fs)\n", file, line, (double)_now_ns / 1e9);
+#ifdef IN_DEBUGGER
+        __builtin_trap();
+#endif
+    }
+
+} // namespace Sim
+
+/**** SysTick ****/
+
+SysTickTimer_t SysTickTimer;
+
+SysTickTimer_t::SysTickTimer_t() : _ticks {0}, _first_event {nullptr}
+{
+    Sim::registerSource(&_source, "systick", -1, &SysTickTimer_t::interrupt, 1000);
+    Sim::setLevel(&_source, kInterruptPriorityHigh);
+    Sim::startPeriodic(&_source);
+}
+
+void SysTickTimer_t::registerEvent(SysTickEvent *new_event)
+{
+    if (_first_event == nullptr) {
+        _first_event = new_event;
+        return;
+    }
+    SysTickEvent *event = _first_event;
+    while (event->next != nullptr) {
+        if (event == new_event) { return; }
+        event = event->next;
+    }
+    if (event != new_event) {
+        event->next = new_event;
+    }
+}
+
+void SysTickTimer_t::unregisterEvent(SysTickEvent *old_event)
+{
+    if (_first_event == old_event) {
+        _first_event = old_event->next;
+        return;
+    }
+    for (SysTickEvent *event = _first_event; event != nullptr; event = event->next) {
+        if (event->next == old_event) {
+            event->next = old_event->next;
+            return;
+        }
+    }
+}
+
+void SysTickTimer_t::interrupt()
+{
+    SysTickTimer._ticks++;
+    for (SysTickEvent *event = SysTickTimer._first_event; event != nullptr; event = event->next) {
+        event->callback();
+    }
+}
+
+void delay(uint32_t milliseconds)
+{
+    Sim::advance((uint64_t)milliseconds * 1000000ULL);
+}
+
+/**** System ****/
+
+const char *UUID = "sim-00000000";
+
+namespace System {
+    void reset(bool bootloader)
+    {
+        SimStdio::flush();
+        fprintf(stderr, "sim: %s requested, exiting\n", bootloader ? "flash loader" : "reset");
+        exit(bootloader ? 2 : 0);
+    }
+} // namespace System
+
+/**** stdio channel ****/
+
+static int _input_fd = STDIN_FILENO;
+static bool _input_eof = false;
+static char _input_buf[4096];
+static uint32_t _input_len = 0;
+static uint32_t _input_pos = 0;
+static uint64_t _input_total = 0;
+static const char *_input_data = nullptr;   // in-memory input, if set
+static uint32_t _input_data_len = 0;
+static bool _output_enabled = true;
+
+bool SimStdio::open(const char *input_path)
+{
+    if (input_path == nullptr) {
+        _input_fd = STDIN_FILENO;
+        return true;
+    }
+    _input_fd = ::open(input_path, O_RDONLY);
+    return (_input_fd >= 0);
+}
+
+void SimStdio::openBuffer(const char *data, uint32_t length)
+{
+    _input_data = data;
+    _input_data_len = length;
+    _input_eof = false;
+    _input_pos = 0;
+    _input_len = 0;
+}
+
+int16_t SimStdio::readByte()
+{
+    if (_input_data != nullptr) {
+        if (_input_pos == _input_data_len) {
+            _input_eof = true;
+            return -1;
+        }
+        _input_total++;
+        return (uint8_t)_input_data[_input_pos++];
+    }
+    if (_input_pos == _input_len) {
+        if (_input_eof) {
+            return -1;
+        }
+        struct pollfd pfd = {_input_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 0) <= 0) {
+            return -1;
+        }
+        ssize_t got = read(_input_fd, _input_buf, sizeof(_input_buf));
+        if (got <= 0) {
+            _input_eof = true;
+            return -1;
+        }
+        _input_len = got;
+        _input_pos = 0;
+        _input_total += got;
+    }
+    return (uint8_t)_input_buf[_input_pos++];
+}
+
+int16_t SimStdio::write(const char *buffer, int16_t length)
+{
+    if (!_output_enabled) {
+        return length;
+    }
+    return fwrite(buffer, 1, length, stdout);
+}
+
+void SimStdio::setOutputEnabled(bool enabled) { _output_enabled = enabled; }
+
+void SimStdio::flush() { fflush(stdout); }
+
+bool SimStdio::atEndOfInput()
+{
+    if (_input_data != nullptr) {
+        return (_input_pos == _input_data_len);
+    }
+    return (_input_eof && (_input_pos == _input_len));
+}
+
+uint64_t SimStdio::bytesRead() { return _input_total; }
+
+} // namespace Motate
+
+/**** main ****
+ *
+ * On hardware the Motate main.cpp calls setup() and loop(). This is the host equivalent.
+ */
+
+extern void setup(void);
+extern void loop(void);
+extern void sim_parse_args(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    sim_parse_args(argc, argv);
+
+    Motate::Sim::setMainLoopRunning(false);     // let setup()'s SysTick busy-wait make progress
+    setup();
+    Motate::Sim::setMainLoopRunning(true);
+    loop();
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * SimMotate.h - virtual clock and interrupt controller for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SIMMOTATE_H_ONCE
+#define SIMMOTATE_H_ONCE
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**** HOST SIMULATOR CORE ****
+ *
+ * The sim board replaces the pieces of Motate that touch silicon with host stand-ins.
+ * Everything above Motate - the controller, canonical machine, planner, exec and loader -
+ * is compiled unmodified. What this file provides is the "hardware":
+ *
+ *  - A virtual clock. Time only moves when the simulator advances it, so runs are
+ *    deterministic and independent of how fast the host happens to be.
+ *
+ *  - A tiny interrupt controller. Timers and service calls register an InterruptSource.
+ *    A pending source runs as soon as it is the highest priority pending source and
+ *    higher than whatever is running now - exactly like NVIC preemption and tail-chaining.
+ *    Level 0 is the main loop.
+ *
+ *  - Periodic sources (the DDA, dwell and SysTick timers) fire on the virtual clock.
+ *    advance() walks time forward to each firing in order and runs the ISR there.
+ *
+ * The main loop is charged a fixed amount of virtual time per pass (see sim_loop_ns in
+ * board/sim/hardware.cpp), which is a reasonable stand-in for a Cortex-M main loop pass.
+ */
+
+namespace Motate {
+namespace Sim {
+
+    typedef void (*isr_t)(void);
+
+    // Priority levels used by the sim NVIC. Larger numbers preempt smaller ones.
+    enum {
+        kLevelMainLoop = 0,
+        kLevelLowest   = 1,
+        kLevelLow      = 2,
+        kLevelMedium   = 3,
+        kLevelHigh     = 4,
+        kLevelHighest  = 5
+    };
+
+    struct InterruptSource {
+        const char *name;                   // for reports
+        int16_t number;                     // timer or service call number, -1 if none
+        isr_t handler;                      // the ISR
+        uint8_t level;                      // see levels above
+        bool enabled;                       // interrupts are configured for this source
+        volatile bool pending;              // set to request the ISR
+
+        // periodic sources
+        uint32_t frequency;                 // Hz, 0 for software-only sources
+        bool running;                       // periodic source is counting
+        uint64_t start_ns;                  // time base of the current run
+        uint64_t fire_count;                // firings in the current run
+        uint64_t next_fire_ns;              // absolute time of the next firing
+
+        // statistics
+        uint64_t call_count;                // times the ISR has run
+        uint64_t host_ns;                   // host time spent in the ISR (including anything it was preempted by)
+
+        InterruptSource *next;              // registration list
+    };
+
+    void registerSource(InterruptSource *src, const char *name, int16_t number, isr_t handler, uint32_t frequency);
+    void setLevel(InterruptSource *src, uint32_t interrupt_options);
+    void setPending(InterruptSource *src);
+    void startPeriodic(InterruptSource *src);
+    void stopPeriodic(InterruptSource *src);
+    void setFrequency(InterruptSource *src, uint32_t frequency);
+    InterruptSource *firstSource();
+
+    uint64_t now();                         // virtual time in nanoseconds
+    void advance(uint64_t ns);              // move the virtual clock forward, firing timers on the way
+    void advanceOnRead();                   // used by SysTick reads in busy-wait loops before the main loop starts
+    void setMainLoopRunning(bool running);
+    bool mainLoopRunning();
+
+    // Host clock for profiling. Time spent in ISRs is accounted to the level they preempted,
+    // so code running at a level can subtract what was not its own (see sim_bench.cpp).
+    uint64_t hostNs();                      // host monotonic clock in nanoseconds
+    uint8_t currentLevel();                 // level of the code running now
+    uint64_t preemptedNs(uint8_t level);    // total host time of ISRs that preempted this level
+
+    void disableIRQ();
+    void enableIRQ();
+
+    void breakpoint(const char *file, int line);
+
+} // namespace Sim
+} // namespace Motate
+
+/**** CMSIS intrinsics used by g2core ****/
+
+#define __NOP()          do {} while (0)
+#define __disable_irq()  Motate::Sim::disableIRQ()
+#define __enable_irq()   Motate::Sim::enableIRQ()
+#define __BKPT(value)    Motate::Sim::breakpoint(__FILE__, __LINE__)
+
+#endif // SIMMOTATE_H_ONCE
@@ -0,0 +1,28 @@
+# ----------------------------------------------------------------------------
+# This file is part of the Synthetos g2core project
+#
+# Platform settings for the host simulator (BASE_BOARD g2core-sim).
+#
+# Replaces the arm-none-eabi toolchain and chip settings of the SAM platforms with
+# the host compiler. The Motate headers come from board/sim/motate, which is on
+# SOURCE_DIRS ahead of anything in MOTATE_PATH.
+
+CROSS_COMPILE ?=
+CHIP = host
+export CHIP
+CHIP_LOWERCASE = host
+
+CC      = $(CROSS_COMPILE)gcc
+CXX     = $(CROSS_COMPILE)g++
+LD      = $(CROSS_COMPILE)g++
+AR      = $(CROSS_COMPILE)ar
+OBJCOPY = true
+SIZE    = size
+
+DEVICE_INCLUDE_DIRS += ${BOARD_PATH}/motate
+
+CPU_DEV =
+DEVICE_LINKER_SCRIPT =
+DEVICE_CFLAGS   += -m64 -fno-strict-aliasing
+DEVICE_CXXFLAGS += -std=gnu++14 -fno-rtti -fno-exceptions
+DEVICE_LDFLAGS  += -lm
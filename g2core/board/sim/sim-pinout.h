@@ -0,0 +1,224 @@
+/*
+ * sim-pinout.h - board pinout for the g2core host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Robert Giseburt
+ * Copyright (c) 2016 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef sim_pinout_h
+#define sim_pinout_h
+
+#include <MotatePins.h>
+
+// The sim has no physical pins. Motors are SimSteppers (see board_stepper.h) that do
+// not use pins at all, so every pin here is a NullPin - except the step pins, which are on
+// virtual ports A and B (pin number = port * 32 + bit) so the packed DDA kernel has a pin
+// map to build its port masks from. Tests that want to drive an input can give it a
+// number (any non-negative value) and use Pin<>::simulateInput().
+
+#define INPUT1_AVAILABLE 0
+#define INPUT2_AVAILABLE 0
+#define INPUT3_AVAILABLE 0
+#define INPUT4_AVAILABLE 0
+#define INPUT5_AVAILABLE 0
+#define INPUT6_AVAILABLE 0
+#define INPUT7_AVAILABLE 0
+#define INPUT8_AVAILABLE 0
+#define INPUT9_AVAILABLE 0
+#define INPUT10_AVAILABLE 0
+#define INPUT11_AVAILABLE 0
+#define INPUT12_AVAILABLE 0
+#define INPUT13_AVAILABLE 0
+
+#define ADC0_AVAILABLE 0
+#define ADC1_AVAILABLE 0
+#define ADC2_AVAILABLE 0
+#define ADC3_AVAILABLE 0
+
+#define XIO_HAS_USB 0
+#define XIO_HAS_UART 1      // the UART is the host's stdin/stdout
+#define XIO_HAS_SPI 0
+#define XIO_HAS_I2C 0
+
+#define TEMPERATURE_OUTPUT_ON 0
+
+#define OUTPUT1_PWM 0
+#define OUTPUT2_PWM 0
+#define OUTPUT3_PWM 0
+#define OUTPUT4_PWM 0
+#define OUTPUT5_PWM 0
+#define OUTPUT6_PWM 0
+#define OUTPUT7_PWM 0
+#define OUTPUT8_PWM 0
+#define OUTPUT9_PWM 0
+#define OUTPUT10_PWM 0
+#define OUTPUT11_PWM 0
+#define OUTPUT12_PWM 0
+#define OUTPUT13_PWM 0
+
+namespace Motate {
+
+pin_number kSerial_RXPinNumber              = -1;
+pin_number kSerial_TXPinNumber              = -1;
+pin_number kSerial0_RX                      = -1;
+pin_number kSerial0_TX                      = -1;
+pin_number kI2C_SDAPinNumber                = -1;
+pin_number kI2C_SCLPinNumber                = -1;
+pin_number kI2C0_SDAPinNumber               = -1;
+pin_number kI2C0_SCLPinNumber               = -1;
+pin_number kSPI_SCKPinNumber                = -1;
+pin_number kSPI_MISOPinNumber               = -1;
+pin_number kSPI_MOSIPinNumber               = -1;
+pin_number kSPI0_SCKPinNumber               = -1;
+pin_number kSPI0_MISOPinNumber              = -1;
+pin_number kSPI0_MOSIPinNumber              = -1;
+pin_number kDebug1_PinNumber                = -1;
+pin_number kDebug2_PinNumber                = -1;
+pin_number kDebug3_PinNumber                = -1;
+pin_number kDebug4_PinNumber                = -1;
+pin_number kKinen_SyncPinNumber             = -1;
+pin_number kSocket1_SPISlaveSelectPinNumber = -1;
+pin_number kSocket1_InterruptPinNumber      = -1;
+pin_number kSocket1_StepPinNumber           = 2;
+pin_number kSocket1_DirPinNumber            = -1;
+pin_number kSocket1_EnablePinNumber         = -1;
+pin_number kSocket1_Microstep_0PinNumber    = -1;
+pin_number kSocket1_Microstep_1PinNumber    = -1;
+pin_number kSocket1_Microstep_2PinNumber    = -1;
+pin_number kSocket1_VrefPinNumber           = -1;
+pin_number kSocket2_SPISlaveSelectPinNumber = -1;
+pin_number kSocket2_InterruptPinNumber      = -1;
+pin_number kSocket2_StepPinNumber           = 5;
+pin_number kSocket2_DirPinNumber            = -1;
+pin_number kSocket2_EnablePinNumber         = -1;
+pin_number kSocket2_Microstep_0PinNumber    = -1;
+pin_number kSocket2_Microstep_1PinNumber    = -1;
+pin_number kSocket2_Microstep_2PinNumber    = -1;
+pin_number kSocket2_VrefPinNumber           = -1;
+pin_number kSocket3_SPISlaveSelectPinNumber = -1;
+pin_number kSocket3_InterruptPinNumber      = -1;
+pin_number kSocket3_StepPinNumber           = 8;
+pin_number kSocket3_DirPinNumber            = -1;
+pin_number kSocket3_EnablePinNumber         = -1;
+pin_number kSocket3_Microstep_0PinNumber    = -1;
+pin_number kSocket3_Microstep_1PinNumber    = -1;
+pin_number kSocket3_Microstep_2PinNumber    = -1;
+pin_number kSocket3_VrefPinNumber           = -1;
+pin_number kSocket4_SPISlaveSelectPinNumber = -1;
+pin_number kSocket4_InterruptPinNumber      = -1;
+pin_number kSocket4_StepPinNumber           = 33;
+pin_number kSocket4_DirPinNumber            = -1;
+pin_number kSocket4_EnablePinNumber         = -1;
+pin_number kSocket4_Microstep_0PinNumber    = -1;
+pin_number kSocket4_Microstep_1PinNumber    = -1;
+pin_number kSocket4_Microstep_2PinNumber    = -1;
+pin_number kSocket4_VrefPinNumber           = -1;
+pin_number kSocket5_SPISlaveSelectPinNumber = -1;
+pin_number kSocket5_InterruptPinNumber      = -1;
+pin_number kSocket5_StepPinNumber           = 36;
+pin_number kSocket5_DirPinNumber            = -1;
+pin_number kSocket5_EnablePinNumber         = -1;
+pin_number kSocket5_Microstep_0PinNumber    = -1;
+pin_number kSocket5_Microstep_1PinNumber    = -1;
+pin_number kSocket5_Microstep_2PinNumber    = -1;
+pin_number kSocket5_VrefPinNumber           = -1;
+pin_number kSocket6_SPISlaveSelectPinNumber = -1;
+pin_number kSocket6_InterruptPinNumber      = -1;
+pin_number kSocket6_StepPinNumber           = 39;
+pin_number kSocket6_DirPinNumber            = -1;
+pin_number kSocket6_EnablePinNumber         = -1;
+pin_number kSocket6_Microstep_0PinNumber    = -1;
+pin_number kSocket6_Microstep_1PinNumber    = -1;
+pin_number kSocket6_Microstep_2PinNumber    = -1;
+pin_number kSocket6_VrefPinNumber           = -1;
+pin_number kInput1_PinNumber                = -1;
+pin_number kInput2_PinNumber                = -1;
+pin_number kInput3_PinNumber                = -1;
+pin_number kInput4_PinNumber                = -1;
+pin_number kInput5_PinNumber                = -1;
+pin_number kInput6_PinNumber                = -1;
+pin_number kInput7_PinNumber                = -1;
+pin_number kInput8_PinNumber                = -1;
+pin_number kInput9_PinNumber                = -1;
+pin_number kInput10_PinNumber               = -1;
+pin_number kInput11_PinNumber               = -1;
+pin_number kInput12_PinNumber               = -1;
+pin_number kSpindle_EnablePinNumber         = -1;
+pin_number kSpindle_DirPinNumber            = -1;
+pin_number kSpindle_PwmPinNumber            = -1;
+pin_number kSpindle_Pwm2PinNumber           = -1;
+pin_number kCoolant_EnablePinNumber         = -1;
+pin_number kSD_CardDetectPinNumber          = -1;
+pin_number kInterlock_InPinNumber           = -1;
+pin_number kOutputSAFE_PinNumber            = -1;
+pin_number kLED_USBRXPinNumber              = -1;
+pin_number kLED_USBTXPinNumber              = -1;
+pin_number kOutput1_PinNumber               = -1;
+pin_number kOutput2_PinNumber               = -1;
+pin_number kOutput3_PinNumber               = -1;
+pin_number kOutput4_PinNumber               = -1;
+pin_number kOutput5_PinNumber               = -1;
+pin_number kOutput6_PinNumber               = -1;
+pin_number kOutput7_PinNumber               = -1;
+pin_number kOutput8_PinNumber               = -1;
+pin_number kOutput9_PinNumber               = -1;
+pin_number kOutput10_PinNumber              = -1;
+pin_number kOutput11_PinNumber              = -1;
+pin_number kOutput12_PinNumber              = -1;
+pin_number kOutput13_PinNumber              = -1;
+pin_number kOutput14_PinNumber              = -1;
+pin_number kOutput15_PinNumber              = -1;
+pin_number kOutput16_PinNumber              = -1;
+pin_number kADC0_PinNumber                  = -1;
+pin_number kADC1_PinNumber                  = -1;
+pin_number kADC2_PinNumber                  = -1;
+pin_number kADC3_PinNumber                  = -1;
+pin_number kADC4_PinNumber                  = -1;
+pin_number kADC5_PinNumber                  = -1;
+pin_number kADC6_PinNumber                  = -1;
+pin_number kADC7_PinNumber                  = -1;
+pin_number kADC8_PinNumber                  = -1;
+pin_number kADC9_PinNumber                  = -1;
+pin_number kADC10_PinNumber                 = -1;
+pin_number kADC11_PinNumber                 = -1;
+pin_number kADC12_PinNumber                 = -1;
+pin_number kADC13_PinNumber                 = -1;
+pin_number kADC14_PinNumber                 = -1;
+pin_number kGRBL_ResetPinNumber             = -1;
+pin_number kGRBL_FeedHoldPinNumber          = -1;
+pin_number kGRBL_CycleStartPinNumber        = -1;
+pin_number kGRBL_CommonEnablePinNumber      = -1;
+pin_number kSerial_RTSPinNumber             = -1;
+pin_number kSerial_CTSPinNumber             = -1;
+pin_number kInput13_PinNumber               = -1;
+
+/** NOTE: When adding pin definitions here, they must be
+ *        added to ALL board pin assignment files, even if
+ *        they are defined as -1.
+ **/
+
+}  // namespace Motate
+
+#endif
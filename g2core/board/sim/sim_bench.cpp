@@ -0,0 +1,1535 @@
+/*
+ * sim_bench.cpp - planner throughput benchmark for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "g2core.h"  // #1
+#include "config.h"  // #2
+#include "hardware.h"
+#include "planner.h"
+#include "stepper.h"
+#include "encoder.h"
+#include "kinematics.h"
+#include "mesh.h"
+#include "util.h"
+#include "sim_bench.h"
+
+#include "SimMotate.h"
+#include "MotateUART.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**** Benchmark notes ****
+ *
+ *  The planner probes (see planner.h) time each call with the host clock. Time spent in
+ *  ISRs that preempted the probed code is taken out, as is the cost of reading the clock,
+ *  so a probe measures only its own work. The virtual clock is not involved - machine time
+ *  is reported separately and is a property of the program, not of the build.
+ *
+ *  Reported rates:
+ *    blocks_per_sec    ALINE and ARC blocks retired / host time in _plan_block() and mp_calculate_ramps()
+ *    segments_per_sec  segments run / host time in mp_exec_aline()
+ *    exec_duty_pct     host time in mp_exec_aline() / machine time, the load the exec
+ *                      interrupt puts on the host (a board's load scales with its speed)
+ *    dda               host time per DDA interrupt (segment loads included, clock reads
+ *                      taken out) and the DDA frequency that would keep the host busy all
+ *                      the time. To compare the DDA kernels (see stepper.h) build once
+ *                      with DDA_KERNEL=1 and run the same programs on both. The latency
+ *                      profile's clock reads (see profile.h) are in it - build with
+ *                      PF_ENABLE=0 to time the kernel alone.
+ *
+ *  Histograms count bf->meet_iterations and bf->iterations of every ALINE and ARC block as it is
+ *  freed, i.e. after all replanning. meet_iterations of -1 means the meet velocity was
+ *  found without iterating.
+ *
+ *  "backplan" counts the back-planning passes, the blocks primed for them and the blocks
+ *  they walked. visits_per_block is the back-planning cost of one new block; the
+ *  visits_per_pass histogram shows how far back the passes reached. ns_per_visit is the
+ *  plan_block time over the blocks walked (and primed), so it is the cost of touching one
+ *  buffer - compare it on a program that keeps the queue full and walks all of it.
+ *
+ *  "coalesced" counts lines merged into the block before them ($lct, see mp_aline()) and
+ *  merge_ratio is lines per block. moves_per_sec is blocks_per_sec counting every merged
+ *  line as a block, i.e. the rate at which input moves get through the planner. To compare,
+ *  run once with --setup '$lct=0.002' (any settings, sent ahead of each program) and once without.
+ *
+ *  "arcs" counts the blocks that were whole arcs (see mp_arc()). "queue" samples the planner
+ *  as each block is freed: buffers_mean is the buffers in use and lookahead_ms_mean the
+ *  motion time they hold. To compare arc blocks with arcs expanded into lines, build once
+ *  with ARC_BLOCKS=0 (see sim.mk) and run the same arc-heavy programs on both.
+ *
+ *  "blends" counts corners replaced by a blend arc (G64 P, see mp_aline()). The blend arcs
+ *  are counted in "arcs" too. Compare a run with --setup 'G64 P0.05' against one without.
+ *
+ *  "steps" checks step generation. motors is the net step pulses each motor was given while
+ *  the program ran, and error_max the worst distance, in steps, of a motor's encoder count
+ *  from its target when the program ended. Both prep paths (see STEP_PREP in stepper.h)
+ *  should give the same pulses and an error under one step - build once with STEP_PREP=1
+ *  (see sim.mk) and compare the motors arrays of the same programs. faults counts pulses
+ *  the step DMA's checker rejected (see board_stepper.cpp). It is only nonzero with step
+ *  bitmaps - build with DDA_KERNEL=2, where "dda" counts segment boundaries, not ticks.
+ *
+ *  "memory" sizes the planner pool as built for the host (pointers are 8 bytes here, so
+ *  ARM builds are smaller). For a scaling run build with PLANNER_BUFFERS=N (see sim.mk)
+ *  for each queue depth and compare the results.
+ */
+
+#define BENCH_MAX_PROGRAMS      64
+#define BENCH_ITERATIONS_BINS   32              // iterations at or above the last bin are counted there
+#define BENCH_VISITS_BINS       64              // back-planning visits at or above the last bin are counted there
+#define BENCH_PREAMBLE          "{clear:n}\n"   // each program starts from a cleared alarm state
+
+typedef struct simBenchProbe {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+
+    uint64_t start_ns;                  // host time at MP_PROFILE_START()
+    uint64_t start_preempted_ns;        // ISR time at MP_PROFILE_START()
+    uint8_t level;                      // sim interrupt level the probe started at
+} simBenchProbe_t;
+
+typedef struct simBenchResult {
+    const char *name;                   // file name without directory
+    char *text;                         // gcode to stream
+    uint32_t length;
+    uint32_t lines;
+
+    uint64_t blocks;                    // ALINE and ARC blocks retired
+    uint64_t arcs;                      // ARC blocks retired
+    uint64_t queue_buffers;             // sum of buffers in use as each block was retired
+    uint64_t queue_ms;                  // sum of motion time queued as each block was retired
+    uint64_t coalesced;                 // lines merged into the block before them
+    uint64_t blends;                    // corners replaced by a blend arc
+    uint64_t virtual_ns;                // machine time to run the program
+    uint64_t host_ns;                   // wall time to simulate it
+    uint64_t virtual_start_ns;
+    uint64_t host_start_ns;
+    uint64_t dda_ticks;                 // DDA interrupts while the program ran
+    uint64_t dda_ns;                    // host time in them
+    int64_t motor_steps[MOTORS];        // net step pulses given to each motor
+    double step_error;                  // worst |encoder - target steps| at the end of the program
+    uint64_t step_faults;               // pulses the step DMA checker rejected
+
+    simBenchProbe_t probe[MP_PROFILE_PROBES];
+    uint64_t meet_iterations[256];      // indexed by the uint8_t value (255 is -1)
+    uint64_t iterations[BENCH_ITERATIONS_BINS];
+
+    uint64_t backplan_passes;
+    uint64_t backplan_blocks;           // blocks primed for those passes
+    uint64_t backplan_visits;           // blocks walked by those passes
+    uint64_t backplan_max_visits;
+    uint64_t visits_per_pass[BENCH_VISITS_BINS];
+} simBenchResult_t;
+
+static struct simBenchSingleton {
+    bool active;
+    const char *json_path;
+    const char *setup;                  // settings sent ahead of each program, or NULL
+    uint64_t overhead_ns;               // cost of the clock reads in one probe
+    uint8_t count;                      // programs loaded
+    int16_t current;                    // program running now, -1 before the first
+    simBenchResult_t *result[BENCH_MAX_PROGRAMS];
+} sb;
+
+static const char *probe_names[MP_PROFILE_PROBES] = { "plan_block", "calculate_ramps", "exec_aline" };
+
+/*
+ * sim_bench_init() - enter benchmark mode
+ */
+
+void sim_bench_init(const char *json_path, const char *setup)
+{
+    memset(&sb, 0, sizeof(sb));
+    sb.active = true;
+    sb.json_path = json_path;
+    sb.setup = setup;
+    sb.current = -1;
+    Motate::SimStdio::setOutputEnabled(false);
+
+    // The cheapest back-to-back clock read is what every probe pays on top of the real work
+    sb.overhead_ns = UINT64_MAX;
+    for (uint16_t i = 0; i < 1000; i++) {
+        uint64_t t0 = Motate::Sim::hostNs();
+        uint64_t t1 = Motate::Sim::hostNs();
+        if ((t1 - t0) < sb.overhead_ns) {
+            sb.overhead_ns = t1 - t0;
+        }
+    }
+}
+
+bool sim_bench_active() { return (sb.active); }
+
+/*
+ * _extract_literals() - collect the live string literals of a C header
+ *
+ *  The Resources/gcode files hold programs as string literals, sometimes several, and
+ *  sometimes with alternatives commented out. Only what the compiler would see is kept.
+ */
+
+static uint32_t _extract_literals(const char *src, uint32_t length, char *dst)
+{
+    uint32_t out = 0;
+    uint32_t i = 0;
+
+    while (i < length) {
+        if ((src[i] == '/') && (i+1 < length) && (src[i+1] == '/')) {           // line comment
+            while ((i < length) && (src[i] != '\n')) { i++; }
+        } else if ((src[i] == '/') && (i+1 < length) && (src[i+1] == '*')) {    // block comment
+            i += 2;
+            while ((i+1 < length) && !((src[i] == '*') && (src[i+1] == '/'))) { i++; }
+            i += 2;
+        } else if (src[i] == '\'') {                                            // character literal
+            i++;
+            while ((i < length) && (src[i] != '\'')) { i += (src[i] == '\\') ? 2 : 1; }
+            i++;
+        } else if (src[i] == '"') {                                             // string literal
+            i++;
+            while ((i < length) && (src[i] != '"')) {
+                if ((src[i] == '\\') && (i+1 < length)) {
+                    i++;
+                    switch (src[i]) {
+                        case 'n':  { dst[out++] = '\n'; break; }
+                        case 'r':  { dst[out++] = '\r'; break; }
+                        case 't':  { dst[out++] = '\t'; break; }
+                        case '\n': { break; }                                   // line continuation
+                        default:   { dst[out++] = src[i]; }
+                    }
+                } else {
+                    dst[out++] = src[i];
+                }
+                i++;
+            }
+            i++;
+        } else {
+            i++;
+        }
+    }
+    return (out);
+}
+
+/*
+ * sim_bench_add_program() - load a program file (plain gcode or a Resources/gcode header)
+ */
+
+void sim_bench_add_program(const char *path)
+{
+    if (sb.count == BENCH_MAX_PROGRAMS) {
+        fprintf(stderr, "sim: too many programs, %s ignored\n", path);
+        return;
+    }
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "sim: cannot open %s\n", path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    uint32_t size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *raw = (char *)malloc(size + 1);
+    size = fread(raw, 1, size, f);
+    fclose(f);
+
+    simBenchResult_t *r = (simBenchResult_t *)calloc(1, sizeof(simBenchResult_t));
+    const char *slash = strrchr(path, '/');
+    r->name = (slash == NULL) ? path : slash+1;
+
+    // preamble + setup + program + a final newline in case the program doesn't end with one
+    uint32_t preamble = strlen(BENCH_PREAMBLE) + ((sb.setup == NULL) ? 0 : strlen(sb.setup) + 1);
+    r->text = (char *)malloc(preamble + size + 2);
+    strcpy(r->text, BENCH_PREAMBLE);
+    if (sb.setup != NULL) {
+        strcat(r->text, sb.setup);
+        strcat(r->text, "\n");
+    }
+    uint32_t path_len = strlen(path);
+    if ((path_len > 2) && (strcmp(&path[path_len-2], ".h") == 0)) {
+        r->length = preamble + _extract_literals(raw, size, &r->text[preamble]);
+    } else {
+        memcpy(&r->text[preamble], raw, size);
+        r->length = preamble + size;
+    }
+    r->text[r->length++] = '\n';
+    r->text[r->length] = 0;
+    free(raw);
+
+    bool blank = true;
+    for (uint32_t i = preamble; i < r->length; i++) {
+        if (r->text[i] == '\n') {
+            r->lines += blank ? 0 : 1;
+            blank = true;
+        } else if (!isspace(r->text[i])) {
+            blank = false;
+        }
+    }
+    sb.result[sb.count++] = r;
+}
+
+/*
+ * sim_bench_next_program() - close out the running program and start the next one
+ *
+ *  Called when the previous program's input is exhausted and the machine is idle,
+ *  with end_ns the virtual time it went idle, and once before setup() to load the
+ *  first program.
+ */
+
+static Motate::Sim::InterruptSource *_dda_source()
+{
+    for (Motate::Sim::InterruptSource *src = Motate::Sim::firstSource(); src != nullptr; src = src->next) {
+        if (src->handler == &dda_timer_type::interrupt) {
+            return (src);
+        }
+    }
+    return (nullptr);
+}
+
+bool sim_bench_next_program(uint64_t end_ns)
+{
+    Motate::Sim::InterruptSource *dda = _dda_source();
+    if (sb.current >= 0) {
+        simBenchResult_t *r = sb.result[sb.current];
+        r->virtual_ns = end_ns - r->virtual_start_ns;
+        r->host_ns = Motate::Sim::hostNs() - r->host_start_ns;
+        if (dda != nullptr) {
+            r->dda_ticks = dda->call_count - r->dda_ticks;
+            r->dda_ns = dda->host_ns - r->dda_ns;
+        }
+        sim_count_packed_steps();
+        for (uint8_t m = 0; m < MOTORS; m++) {
+            r->motor_steps[m] = ((SimStepper *)Motors[m])->position - r->motor_steps[m];
+            double error = fabs((double)(en.en[m].encoder_steps + en.en[m].steps_run) - mr.target_steps[m]);
+            r->step_error = max(r->step_error, error);
+        }
+        r->step_faults = sim_step_dma.faults - r->step_faults;
+    }
+    if (++sb.current >= sb.count) {
+        return (false);
+    }
+    simBenchResult_t *r = sb.result[sb.current];
+    r->virtual_start_ns = Motate::Sim::now();
+    r->host_start_ns = Motate::Sim::hostNs();
+    if (dda != nullptr) {
+        r->dda_ticks = dda->call_count;             // start values until the program ends
+        r->dda_ns = dda->host_ns;
+    }
+    sim_count_packed_steps();
+    for (uint8_t m = 0; m < MOTORS; m++) {
+        r->motor_steps[m] = ((SimStepper *)Motors[m])->position;    // start values until the program ends
+    }
+    r->step_faults = sim_step_dma.faults;
+    Motate::SimStdio::openBuffer(r->text, r->length);
+    return (true);
+}
+
+/*
+ * sim_profile_start() - MP_PROFILE_START()
+ * sim_profile_end()   - MP_PROFILE_END()
+ * sim_profile_block() - MP_PROFILE_BLOCK()
+ * sim_profile_backplan() - MP_PROFILE_BACKPLAN()
+ * sim_profile_coalesce() - MP_PROFILE_COALESCE()
+ * sim_profile_blend()    - MP_PROFILE_BLEND()
+ */
+
+static simBenchResult_t *_running()
+{
+    if (!sb.active || (sb.current < 0) || (sb.current >= sb.count)) {
+        return (NULL);
+    }
+    return (sb.result[sb.current]);
+}
+
+void sim_profile_start(uint8_t probe)
+{
+    simBenchResult_t *r = _running();
+    if (r == NULL) {
+        return;
+    }
+    simBenchProbe_t *p = &r->probe[probe];
+    p->level = Motate::Sim::currentLevel();
+    p->start_preempted_ns = Motate::Sim::preemptedNs(p->level);
+    p->start_ns = Motate::Sim::hostNs();
+}
+
+void sim_profile_end(uint8_t probe)
+{
+    uint64_t end_ns = Motate::Sim::hostNs();
+    simBenchResult_t *r = _running();
+    if (r == NULL) {
+        return;
+    }
+    simBenchProbe_t *p = &r->probe[probe];
+    uint64_t elapsed_ns = end_ns - p->start_ns - (Motate::Sim::preemptedNs(p->level) - p->start_preempted_ns);
+    elapsed_ns = (elapsed_ns > sb.overhead_ns) ? (elapsed_ns - sb.overhead_ns) : 0;
+
+    p->calls++;
+    p->total_ns += elapsed_ns;
+    if (elapsed_ns > p->max_ns) {
+        p->max_ns = elapsed_ns;
+    }
+}
+
+void sim_profile_block(const struct mpBuffer *bf)
+{
+    simBenchResult_t *r = _running();
+    if ((r == NULL) || !mp_is_aline_type(bf->block_type)) {
+        return;
+    }
+    r->blocks++;
+    if (bf->block_type == BLOCK_TYPE_ARC) {
+        r->arcs++;
+    }
+    r->queue_buffers += PLANNER_BUFFER_POOL_SIZE - mp_get_planner_buffers();
+    r->queue_ms += mp_get_planner_queued_ms();
+    r->meet_iterations[bf->meet_iterations]++;
+    r->iterations[(bf->iterations < 0) ? 0 : min(bf->iterations, BENCH_ITERATIONS_BINS-1)]++;
+}
+
+void sim_profile_backplan(uint16_t blocks, uint16_t visited)
+{
+    simBenchResult_t *r = _running();
+    if (r == NULL) {
+        return;
+    }
+    r->backplan_passes++;
+    r->backplan_blocks += blocks;
+    r->backplan_visits += visited;
+    r->backplan_max_visits = max(r->backplan_max_visits, (uint64_t)visited);
+    r->visits_per_pass[min(visited, (uint16_t)(BENCH_VISITS_BINS-1))]++;
+}
+
+void sim_profile_coalesce()
+{
+    simBenchResult_t *r = _running();
+    if (r == NULL) {
+        return;
+    }
+    r->coalesced++;
+}
+
+void sim_profile_blend()
+{
+    simBenchResult_t *r = _running();
+    if (r == NULL) {
+        return;
+    }
+    r->blends++;
+}
+
+/*
+ * sim_bench_report() - write the results as JSON
+ */
+
+static void _accumulate(simBenchResult_t *total, const simBenchResult_t *r)
+{
+    total->lines += r->lines;
+    total->blocks += r->blocks;
+    total->arcs += r->arcs;
+    total->queue_buffers += r->queue_buffers;
+    total->queue_ms += r->queue_ms;
+    total->coalesced += r->coalesced;
+    total->blends += r->blends;
+    total->virtual_ns += r->virtual_ns;
+    total->host_ns += r->host_ns;
+    total->dda_ticks += r->dda_ticks;
+    total->dda_ns += r->dda_ns;
+    for (uint8_t m = 0; m < MOTORS; m++) {
+        total->motor_steps[m] += r->motor_steps[m];
+    }
+    total->step_error = max(total->step_error, r->step_error);
+    total->step_faults += r->step_faults;
+    for (uint8_t i = 0; i < MP_PROFILE_PROBES; i++) {
+        total->probe[i].calls += r->probe[i].calls;
+        total->probe[i].total_ns += r->probe[i].total_ns;
+        total->probe[i].max_ns = max(total->probe[i].max_ns, r->probe[i].max_ns);
+    }
+    for (uint16_t i = 0; i < 256; i++) {
+        total->meet_iterations[i] += r->meet_iterations[i];
+    }
+    for (uint8_t i = 0; i < BENCH_ITERATIONS_BINS; i++) {
+        total->iterations[i] += r->iterations[i];
+    }
+    total->backplan_passes += r->backplan_passes;
+    total->backplan_blocks += r->backplan_blocks;
+    total->backplan_visits += r->backplan_visits;
+    total->backplan_max_visits = max(total->backplan_max_visits, r->backplan_max_visits);
+    for (uint8_t i = 0; i < BENCH_VISITS_BINS; i++) {
+        total->visits_per_pass[i] += r->visits_per_pass[i];
+    }
+}
+
+static double _rate(uint64_t count, uint64_t ns)
+{
+    return ((ns == 0) ? 0.0 : ((double)count * 1e9 / (double)ns));
+}
+
+static void _print_result(FILE *out, const simBenchResult_t *r, const char *indent)
+{
+    const simBenchProbe_t *p = r->probe;
+    uint64_t segments = p[MP_PROFILE_EXEC_ALINE].calls;
+
+    fprintf(out, "%s\"lines\": %lu,\n", indent, (unsigned long)r->lines);
+    fprintf(out, "%s\"blocks\": %llu,\n", indent, (unsigned long long)r->blocks);
+    fprintf(out, "%s\"coalesced\": %llu,\n", indent, (unsigned long long)r->coalesced);
+    fprintf(out, "%s\"merge_ratio\": %.3f,\n", indent,
+            (r->blocks == 0) ? 0.0 : ((double)(r->blocks + r->coalesced) / r->blocks));
+    fprintf(out, "%s\"arcs\": %llu,\n", indent, (unsigned long long)r->arcs);
+    fprintf(out, "%s\"blends\": %llu,\n", indent, (unsigned long long)r->blends);
+    fprintf(out, "%s\"queue\": {\"buffers_mean\": %.2f, \"lookahead_ms_mean\": %.1f},\n", indent,
+            (r->blocks == 0) ? 0.0 : ((double)r->queue_buffers / r->blocks),
+            (r->blocks == 0) ? 0.0 : ((double)r->queue_ms / r->blocks));
+    fprintf(out, "%s\"segments\": %llu,\n", indent, (unsigned long long)segments);
+    fprintf(out, "%s\"machine_time_s\": %.6f,\n", indent, (double)r->virtual_ns / 1e9);
+    fprintf(out, "%s\"host_time_s\": %.6f,\n", indent, (double)r->host_ns / 1e9);
+    fprintf(out, "%s\"blocks_per_sec\": %.1f,\n", indent,
+            _rate(r->blocks, p[MP_PROFILE_PLAN_BLOCK].total_ns + p[MP_PROFILE_CALCULATE_RAMPS].total_ns));
+    fprintf(out, "%s\"moves_per_sec\": %.1f,\n", indent,
+            _rate(r->blocks + r->coalesced, p[MP_PROFILE_PLAN_BLOCK].total_ns + p[MP_PROFILE_CALCULATE_RAMPS].total_ns));
+    fprintf(out, "%s\"segments_per_sec\": %.1f,\n", indent, _rate(segments, p[MP_PROFILE_EXEC_ALINE].total_ns));
+    fprintf(out, "%s\"exec_duty_pct\": %.4f,\n", indent,
+            (r->virtual_ns == 0) ? 0.0 : (100.0 * p[MP_PROFILE_EXEC_ALINE].total_ns / r->virtual_ns));
+    double dda_ns_per_tick = (r->dda_ticks == 0) ? 0.0 :
+        max(0.0, ((double)r->dda_ns / r->dda_ticks) - (double)sb.overhead_ns);
+    fprintf(out, "%s\"dda\": {\"ticks\": %llu, \"ns_per_tick\": %.2f, \"max_khz\": %.0f},\n", indent,
+            (unsigned long long)r->dda_ticks, dda_ns_per_tick, (dda_ns_per_tick == 0.0) ? 0.0 : (1e6 / dda_ns_per_tick));
+    fprintf(out, "%s\"steps\": {\"motors\": [", indent);
+    for (uint8_t m = 0; m < MOTORS; m++) {
+        fprintf(out, "%s%lld", (m == 0) ? "" : ", ", (long long)r->motor_steps[m]);
+    }
+    fprintf(out, "], \"error_max\": %.6f, \"faults\": %llu},\n", r->step_error, (unsigned long long)r->step_faults);
+
+    for (uint8_t i = 0; i < MP_PROFILE_PROBES; i++) {
+        fprintf(out, "%s\"%s\": {\"calls\": %llu, \"ns_per_call\": %.1f, \"max_ns\": %llu},\n", indent, probe_names[i],
+                (unsigned long long)p[i].calls, (p[i].calls == 0) ? 0.0 : ((double)p[i].total_ns / p[i].calls),
+                (unsigned long long)p[i].max_ns);
+    }
+
+    const char *sep = "";
+    fprintf(out, "%s\"meet_iterations\": {", indent);
+    for (uint16_t i = 0; i < 256; i++) {
+        if (r->meet_iterations[i] != 0) {
+            fprintf(out, "%s\"%d\": %llu", sep, (int8_t)i, (unsigned long long)r->meet_iterations[i]);
+            sep = ", ";
+        }
+    }
+    fprintf(out, "},\n");
+
+    sep = "";
+    fprintf(out, "%s\"iterations\": {", indent);
+    for (uint8_t i = 0; i < BENCH_ITERATIONS_BINS; i++) {
+        if (r->iterations[i] != 0) {
+            fprintf(out, "%s\"%d%s\": %llu", sep, i, (i == BENCH_ITERATIONS_BINS-1) ? "+" : "",
+                    (unsigned long long)r->iterations[i]);
+            sep = ", ";
+        }
+    }
+    fprintf(out, "},\n");
+
+    uint64_t touched = r->backplan_visits + r->backplan_blocks;
+    fprintf(out, "%s\"backplan\": {\"passes\": %llu, \"blocks\": %llu, \"visits\": %llu, "
+                 "\"visits_per_block\": %.2f, \"max_visits\": %llu, \"ns_per_visit\": %.2f,\n", indent,
+            (unsigned long long)r->backplan_passes, (unsigned long long)r->backplan_blocks,
+            (unsigned long long)r->backplan_visits,
+            (r->backplan_blocks == 0) ? 0.0 : ((double)r->backplan_visits / r->backplan_blocks),
+            (unsigned long long)r->backplan_max_visits,
+            (touched == 0) ? 0.0 : ((double)p[MP_PROFILE_PLAN_BLOCK].total_ns / touched));
+    sep = "";
+    fprintf(out, "%s    \"visits_per_pass\": {", indent);
+    for (uint8_t i = 0; i < BENCH_VISITS_BINS; i++) {
+        if (r->visits_per_pass[i] != 0) {
+            fprintf(out, "%s\"%d%s\": %llu", sep, i, (i == BENCH_VISITS_BINS-1) ? "+" : "",
+                    (unsigned long long)r->visits_per_pass[i]);
+            sep = ", ";
+        }
+    }
+    fprintf(out, "}}\n");
+}
+
+void sim_bench_report()
+{
+    FILE *out = stdout;
+    if (sb.json_path != NULL) {
+        if ((out = fopen(sb.json_path, "w")) == NULL) {
+            fprintf(stderr, "sim: cannot write %s\n", sb.json_path);
+            exit(1);
+        }
+    }
+    #define settings_file_string1(s) #s
+    #define settings_file_string2(s) settings_file_string1(s)
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"planner\",\n");
+    fprintf(out, "  \"firmware_build\": %.2f,\n", G2CORE_FIRMWARE_BUILD);
+    fprintf(out, "  \"firmware_build_string\": \"%s\",\n", G2CORE_FIRMWARE_BUILD_STRING);
+    fprintf(out, "  \"settings\": \"%s\",\n", settings_file_string2(SETTINGS_FILE));
+    fprintf(out, "  \"planner_buffers\": %d,\n", PLANNER_BUFFER_POOL_SIZE);
+    fprintf(out, "  \"memory\": {\"planning_bytes\": %d, \"gcode_state_bytes\": %d, \"axis_vector_bytes\": %d, "
+                 "\"bytes_per_block\": %d, \"pool_bytes\": %d},\n",
+            (int)sizeof(mpBuf_t), (int)sizeof(GCodeState_t), (int)(sizeof(mb.unit[0]) + sizeof(mb.axis_flags[0])),
+            (int)(sizeof(mpBufferPool_t) / PLANNER_BUFFER_POOL_SIZE), (int)sizeof(mpBufferPool_t));
+    fprintf(out, "  \"clock_overhead_ns\": %llu,\n", (unsigned long long)sb.overhead_ns);
+    #undef settings_file_string1
+    #undef settings_file_string2
+
+    simBenchResult_t *total = (simBenchResult_t *)calloc(1, sizeof(simBenchResult_t));
+    fprintf(out, "  \"programs\": [\n");
+    for (uint8_t i = 0; i < sb.count; i++) {
+        fprintf(out, "    {\n      \"name\": \"%s\",\n", sb.result[i]->name);
+        _print_result(out, sb.result[i], "      ");
+        fprintf(out, "    }%s\n", (i+1 < sb.count) ? "," : "");
+        _accumulate(total, sb.result[i]);
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"total\": {\n");
+    _print_result(out, total, "    ");
+    fprintf(out, "  }\n}\n");
+    free(total);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+}
+
+/**** Meet velocity solver comparison ****
+ *
+ *  Run with:  g2core.elf --meet-accuracy N [--seed S] [--json results.json]
+ *
+ *  Runs both meet velocity solvers over N randomized rate-limited cases (v_0, v_2, L, jerk)
+ *  and compares them with a double precision bisection of the same length equation.
+ *  Only asymmetric cases that have a meet velocity are used, as those are the ones the
+ *  solvers iterate on (the symmetric case is the same code in both). This does not start
+ *  the firmware.
+ *
+ *  Per solver:
+ *    v_rel_err_max/mean  |v_1 - reference| / reference
+ *    length_err_max_mm   |head + body + tail - L|, should be ~0
+ *    overlap_max_mm      worst (head + tail) - L at v_1, before the overlap fix-up
+ *    jerk_short_max_mm   worst shortfall of a head or tail against the length v_1 needs,
+ *                        i.e. how far the plan would exceed jerk
+ *
+ *  The last two are taken at the float just below v_1. When the meet is very close to
+ *  the higher velocity a one ulp change of v_1 is a big change of length, and that is a
+ *  limit of the representation rather than of either solver.
+ *    body_mean_mm        cruise planned into the gap the solver left (lower is better)
+ */
+
+#define MEET_V_MAX          20000.0     // mm/min - sim board G0 velocity
+#define MEET_L_MIN          0.001       // mm
+#define MEET_L_MAX          20.0        // mm
+#define MEET_JERK_MIN       50.0        // km/min^3 (the $xjm units)
+#define MEET_JERK_MAX       5000.0
+#define MEET_ITER_BINS      32
+#define MEET_TIMED_PASSES   5
+
+typedef struct simMeetCase {
+    float v_0;
+    float v_2;
+    float L;
+    float jerk;
+    double v_ref;
+} simMeetCase_t;
+
+typedef float (*simMeetSolver)(const float v_0, const float v_2, const float L, mpBuf_t *bf, mpBlockRuntimeBuf_t *block);
+
+typedef struct simMeetResult {
+    const char *name;
+    double v_rel_err_max;
+    double v_rel_err_sum;
+    double length_err_max;
+    double overlap_max;
+    double jerk_short_max;
+    double body_sum;
+    uint64_t host_ns;
+    uint32_t iterations[MEET_ITER_BINS];    // last bin is "31+"
+} simMeetResult_t;
+
+/*
+ * The standalone benches share these: output goes to stdout or the --json file, a zero
+ * sample count runs one sample, and a zero seed is replaced because xorshift sticks at 0.
+ */
+
+static FILE *_bench_open(const char *json_path)
+{
+    FILE *out = stdout;
+    if ((json_path != NULL) && ((out = fopen(json_path, "w")) == NULL)) {
+        fprintf(stderr, "sim: cannot write %s\n", json_path);
+        exit(1);
+    }
+    return (out);
+}
+
+static void _bench_header(FILE *out, const char *benchmark)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"%s\",\n", benchmark);
+}
+
+static void _bench_close(FILE *out)
+{
+    if (out != stdout) {
+        fclose(out);
+    }
+}
+
+static uint32_t _bench_samples(uint32_t samples)
+{
+    return ((samples == 0) ? 1 : samples);
+}
+
+static uint32_t _bench_seed(uint32_t seed)
+{
+    return ((seed == 0) ? 1 : seed);
+}
+
+static uint32_t _xorshift(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (*state = x);
+}
+
+static double _uniform(uint32_t *state, double lo, double hi)
+{
+    return (lo + (hi - lo) * ((double)_xorshift(state) / 4294967296.0));
+}
+
+static double _log_uniform(uint32_t *state, double lo, double hi)
+{
+    return (exp(_uniform(state, log(lo), log(hi))));
+}
+
+static void _meet_setup(mpBuf_t *bf, const float jerk)  // as _calculate_jerk() does
+{
+    const float q        = 2.40281141413;
+    bf->jerk             = jerk * JERK_MULTIPLIER;
+    bf->jerk_sq          = bf->jerk * bf->jerk;
+    bf->recip_jerk       = 1 / bf->jerk;
+    bf->sqrt_j           = sqrt(bf->jerk);
+    bf->q_recip_2_sqrt_j = q / (2 * bf->sqrt_j);
+}
+
+static double _meet_length(double v_0, double v_1, double jerk)     // mp_get_target_length() in double
+{
+    return (2.40281141413 / (2 * sqrt(jerk * JERK_MULTIPLIER)) * sqrt(fabs(v_1 - v_0)) * (v_1 + v_0));
+}
+
+static double _meet_reference(const simMeetCase_t *c)
+{
+    double lo = max(c->v_0, c->v_2);
+    double hi = 2 * lo + 1;
+    while ((_meet_length(c->v_0, hi, c->jerk) + _meet_length(c->v_2, hi, c->jerk)) < c->L) {
+        hi *= 2;
+    }
+    for (uint8_t i = 0; i < 100; i++) {
+        double mid = (lo + hi) / 2;
+        if ((_meet_length(c->v_0, mid, c->jerk) + _meet_length(c->v_2, mid, c->jerk)) < c->L) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return ((lo + hi) / 2);
+}
+
+static void _meet_run(simMeetResult_t *r, simMeetSolver solver, const simMeetCase_t *cases, uint32_t count)
+{
+    mpBuf_t bf;
+    mpBlockRuntimeBuf_t block;
+    memset(&bf, 0, sizeof(bf));
+
+    // timed passes, best of MEET_TIMED_PASSES less the jerk setup, which is not the solver's cost
+    volatile float sink = 0;
+    r->host_ns = UINT64_MAX;
+    for (uint8_t pass = 0; pass < MEET_TIMED_PASSES; pass++) {
+        uint64_t start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < count; i++) {
+            _meet_setup(&bf, cases[i].jerk);
+            sink += solver(cases[i].v_0, cases[i].v_2, cases[i].L, &bf, &block);
+        }
+        uint64_t solve_ns = Motate::Sim::hostNs() - start_ns;
+
+        start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < count; i++) {
+            _meet_setup(&bf, cases[i].jerk);
+            sink += bf.q_recip_2_sqrt_j;
+        }
+        uint64_t setup_ns = Motate::Sim::hostNs() - start_ns;
+        r->host_ns = min(r->host_ns, (solve_ns > setup_ns) ? (solve_ns - setup_ns) : 0);
+    }
+
+    // accuracy pass
+    for (uint32_t i = 0; i < count; i++) {
+        const simMeetCase_t *c = &cases[i];
+        _meet_setup(&bf, c->jerk);
+        float v_1_f = solver(c->v_0, c->v_2, c->L, &bf, &block);
+        double v_1 = v_1_f;
+        double v_1_below = max(nextafterf(v_1_f, 0), max(c->v_0, c->v_2));
+        double L = c->L;
+
+        double v_err = fabs(v_1 - c->v_ref) / c->v_ref;
+        r->v_rel_err_max = max(r->v_rel_err_max, v_err);
+        r->v_rel_err_sum += v_err;
+
+        double total = (double)block.head_length + block.body_length + block.tail_length;
+        r->length_err_max = max(r->length_err_max, fabs(total - L));
+        double head = _meet_length(c->v_0, v_1_below, c->jerk);
+        double tail = _meet_length(c->v_2, v_1_below, c->jerk);
+        r->overlap_max = max(r->overlap_max, head + tail - L);
+        r->jerk_short_max = max(r->jerk_short_max, head - block.head_length);
+        r->jerk_short_max = max(r->jerk_short_max, tail - block.tail_length);
+        r->body_sum += block.body_length;
+
+        uint8_t it = (bf.meet_iterations == (uint8_t)-1) ? 0 : bf.meet_iterations;
+        r->iterations[min(it, (uint8_t)(MEET_ITER_BINS-1))]++;
+    }
+}
+
+static void _meet_print(FILE *out, const simMeetResult_t *r, uint32_t count, bool last)
+{
+    fprintf(out, "    \"%s\": {\n", r->name);
+    fprintf(out, "      \"ns_per_call\": %.1f,\n", (double)r->host_ns / count);
+    fprintf(out, "      \"v_rel_err_max\": %.3e,\n", r->v_rel_err_max);
+    fprintf(out, "      \"v_rel_err_mean\": %.3e,\n", r->v_rel_err_sum / count);
+    fprintf(out, "      \"length_err_max_mm\": %.3e,\n", r->length_err_max);
+    fprintf(out, "      \"overlap_max_mm\": %.3e,\n", r->overlap_max);
+    fprintf(out, "      \"jerk_short_max_mm\": %.3e,\n", r->jerk_short_max);
+    fprintf(out, "      \"body_mean_mm\": %.3e,\n", r->body_sum / count);
+
+    const char *sep = "";
+    fprintf(out, "      \"iterations\": {");
+    for (uint8_t i = 0; i < MEET_ITER_BINS; i++) {
+        if (r->iterations[i] != 0) {
+            fprintf(out, "%s\"%d%s\": %lu", sep, i, (i == MEET_ITER_BINS-1) ? "+" : "", (unsigned long)r->iterations[i]);
+            sep = ", ";
+        }
+    }
+    fprintf(out, "}\n    }%s\n", last ? "" : ",");
+}
+
+void sim_bench_meet_accuracy(uint32_t samples, uint32_t seed, const char *json_path)
+{
+    FILE *out = _bench_open(json_path);
+    samples = _bench_samples(samples);
+    uint32_t state = _bench_seed(seed);
+
+    // Rate-limited cases only: the v_0 <-> v_2 ramp fits in L, and the meet is a plausible velocity
+    simMeetCase_t *cases = (simMeetCase_t *)malloc(samples * sizeof(simMeetCase_t));
+    uint32_t count = 0;
+    uint32_t rejected = 0;
+    while (count < samples) {
+        simMeetCase_t *c = &cases[count];
+        c->v_0 = _uniform(&state, 0, MEET_V_MAX);
+        c->v_2 = _uniform(&state, 0, MEET_V_MAX);
+        c->L = _log_uniform(&state, MEET_L_MIN, MEET_L_MAX);
+        c->jerk = _log_uniform(&state, MEET_JERK_MIN, MEET_JERK_MAX);
+        if ((_meet_length(min(c->v_0, c->v_2), max(c->v_0, c->v_2), c->jerk) >= c->L) ||
+            ((c->v_ref = _meet_reference(c)) > 2 * MEET_V_MAX)) {
+            rejected++;
+            continue;
+        }
+        count++;
+    }
+
+    simMeetResult_t result[2];
+    memset(result, 0, sizeof(result));
+    result[0].name = "newton";
+    result[1].name = "bracketed";
+    _meet_run(&result[0], mp_get_meet_velocity_newton, cases, count);
+    _meet_run(&result[1], mp_get_meet_velocity_bracketed, cases, count);
+
+    _bench_header(out, "meet_velocity");
+    fprintf(out, "  \"samples\": %lu,\n", (unsigned long)count);
+    fprintf(out, "  \"rejected\": %lu,\n", (unsigned long)rejected);
+    fprintf(out, "  \"seed\": %lu,\n", (unsigned long)seed);
+    fprintf(out, "  \"selected\": \"%s\",\n", (MEET_VELOCITY_SOLVER == MEET_SOLVER_NEWTON) ? "newton" : "bracketed");
+    fprintf(out, "  \"refinement_steps\": %d,\n", MEET_REFINEMENT_STEPS);
+    fprintf(out, "  \"solvers\": {\n");
+    _meet_print(out, &result[0], count, false);
+    _meet_print(out, &result[1], count, true);
+    fprintf(out, "  }\n}\n");
+
+    free(cases);
+    _bench_close(out);
+}
+
+/**** Segment interpolator comparison ****
+ *
+ *  Run with:  g2core.elf --segment-drift HOURS [--seed S] [--json results.json]
+ *
+ *  Runs both segment interpolators (mp_ramp_*_float() and mp_ramp_*_fixed()) over random
+ *  head and tail ramps until HOURS of motion have been simulated, and compares them with the
+ *  exact curve in double. Each ramp is a line along one axis starting at a random position
+ *  on a 400 mm machine, and its position is advanced the way _exec_aline_segment() does it:
+ *  Kahan summed segment lengths for float, section start plus ramp distance for fixed.
+ *  Ramps have 2 to FIXED_RAMP_SEGMENTS_MAX segments of NOM_SEGMENT_TIME, so the fixed
+ *  interpolator never hands one to float. This does not start the firmware.
+ *
+ *  Per interpolator:
+ *    ns_per_segment      cost of one init or next call, best of SEGMENT_TIMED_PASSES
+ *    v_err_max           worst |segment velocity - exact segment average velocity|, mm/min
+ *    position_err_max_mm worst distance of a segment end from the curve
+ *    end_err_max_mm      worst distance of a section end from its waypoint, before the
+ *                        exec snaps to the waypoint
+ *    drift_mm            sum of the signed section end errors over the job - what would be
+ *                        left if the waypoints did not correct it
+ *  "exact_ends" counts ramps where the fixed position reached R(n) = n^6 exactly.
+ */
+
+#define SEGMENT_V_MAX           20000.0     // mm/min - sim board G0 velocity
+#define SEGMENT_TRAVEL          400.0       // mm - ramps start anywhere in this
+#define SEGMENT_TIMED_PASSES    3
+
+typedef struct simRampCase {
+    float v_0;
+    float v_1;
+    float start;
+    uint32_t segments;
+} simRampCase_t;
+
+typedef struct simRampResult {
+    const char *name;
+    double v_err_max;
+    double position_err_max;
+    double end_err_max;
+    double drift;
+    uint64_t host_ns;
+} simRampResult_t;
+
+static double _ramp_reference(const simRampCase_t *c, double k)    // exact distance after k segments
+{
+    double u = k / c->segments;
+    double T = c->segments * (double)NOM_SEGMENT_TIME;
+    return (c->v_0 * T * u + (c->v_1 - c->v_0) * T / 2 * u*u*u*u * (5 - 6*u + 2*u*u));
+}
+
+static void _ramp_run(simRampResult_t *r, bool fixed, const simRampCase_t *cases, uint32_t count)
+{
+    mpSegmentRamp_t ramp;
+    const float segment_time = NOM_SEGMENT_TIME;
+
+    volatile float sink = 0;
+    r->host_ns = UINT64_MAX;
+    for (uint8_t pass = 0; pass < SEGMENT_TIMED_PASSES; pass++) {
+        uint64_t start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < count; i++) {
+            const simRampCase_t *c = &cases[i];
+            if (fixed) {
+                mp_ramp_init_fixed(&ramp, c->v_0, c->v_1, segment_time, c->segments);
+                for (uint32_t k = 1; k < c->segments; k++) {
+                    mp_ramp_next_fixed(&ramp);
+                }
+            } else {
+                mp_ramp_init_float(&ramp, c->v_0, c->v_1, (float)c->segments);
+                for (uint32_t k = 1; k < c->segments; k++) {
+                    mp_ramp_next_float(&ramp);
+                }
+            }
+            sink += ramp.velocity;
+        }
+        r->host_ns = min(r->host_ns, Motate::Sim::hostNs() - start_ns);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const simRampCase_t *c = &cases[i];
+        float position = c->start;
+        float comp = 0;
+        double previous = 0;
+        if (fixed) {
+            mp_ramp_init_fixed(&ramp, c->v_0, c->v_1, segment_time, c->segments);
+        } else {
+            mp_ramp_init_float(&ramp, c->v_0, c->v_1, (float)c->segments);
+        }
+        for (uint32_t k = 1; k <= c->segments; k++) {
+            if (k > 1) {
+                if (fixed) {
+                    mp_ramp_next_fixed(&ramp);
+                } else {
+                    mp_ramp_next_float(&ramp);
+                }
+            }
+            if (fixed) {
+                position = c->start + ramp.distance;
+            } else {
+                float to_add = (ramp.velocity * segment_time) - comp;
+                float target = position + to_add;
+                comp = (target - position) - to_add;
+                position = target;
+            }
+            double exact = _ramp_reference(c, k);
+            r->v_err_max = max(r->v_err_max, fabs(ramp.velocity - (exact - previous) / segment_time));
+            r->position_err_max = max(r->position_err_max, fabs(position - (c->start + exact)));
+            previous = exact;
+        }
+        double end_err = (double)position - (c->start + previous);
+        r->end_err_max = max(r->end_err_max, fabs(end_err));
+        r->drift += end_err;
+    }
+}
+
+static void _ramp_print(FILE *out, const simRampResult_t *r, uint64_t segments, bool last)
+{
+    fprintf(out, "    \"%s\": {\n", r->name);
+    fprintf(out, "      \"ns_per_segment\": %.2f,\n", (double)r->host_ns / segments);
+    fprintf(out, "      \"v_err_max\": %.3e,\n", r->v_err_max);
+    fprintf(out, "      \"position_err_max_mm\": %.3e,\n", r->position_err_max);
+    fprintf(out, "      \"end_err_max_mm\": %.3e,\n", r->end_err_max);
+    fprintf(out, "      \"drift_mm\": %.3e\n", r->drift);
+    fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+void sim_bench_segment_drift(float hours, uint32_t seed, const char *json_path)
+{
+    FILE *out = _bench_open(json_path);
+    uint32_t state = _bench_seed(seed);
+
+    // random ramps until the job is long enough
+    uint32_t size = 1024;
+    uint32_t count = 0;
+    uint64_t segments = 0;
+    uint32_t exact_ends = 0;
+    simRampCase_t *cases = (simRampCase_t *)malloc(size * sizeof(simRampCase_t));
+    while (segments * (double)NOM_SEGMENT_MS < hours * 3600000.0) {
+        if (count == size) {
+            size *= 2;
+            cases = (simRampCase_t *)realloc(cases, size * sizeof(simRampCase_t));
+        }
+        simRampCase_t *c = &cases[count++];
+        c->v_0 = _uniform(&state, 0, SEGMENT_V_MAX);
+        c->v_1 = _uniform(&state, 0, SEGMENT_V_MAX);
+        c->start = _uniform(&state, 0, SEGMENT_TRAVEL);
+        c->segments = 2 + (_xorshift(&state) % (FIXED_RAMP_SEGMENTS_MAX - 1));
+        segments += c->segments;
+
+        mpSegmentRamp_t ramp;
+        mp_ramp_init_fixed(&ramp, c->v_0, c->v_1, NOM_SEGMENT_TIME, c->segments);
+        for (uint32_t k = 1; k < c->segments; k++) {
+            mp_ramp_next_fixed(&ramp);
+        }
+        int64_t n = c->segments;
+        if ((c->v_0 == c->v_1) || (ramp.position == n*n*n*n*n*n)) {
+            exact_ends++;
+        }
+    }
+
+    simRampResult_t result[2];
+    memset(result, 0, sizeof(result));
+    result[0].name = "float";
+    result[1].name = "fixed";
+    _ramp_run(&result[0], false, cases, count);
+    _ramp_run(&result[1], true, cases, count);
+
+    _bench_header(out, "segment_drift");
+    fprintf(out, "  \"hours\": %.3f,\n", segments * (double)NOM_SEGMENT_MS / 3600000.0);
+    fprintf(out, "  \"ramps\": %lu,\n", (unsigned long)count);
+    fprintf(out, "  \"segments\": %llu,\n", (unsigned long long)segments);
+    fprintf(out, "  \"seed\": %lu,\n", (unsigned long)seed);
+    fprintf(out, "  \"selected\": \"%s\",\n", (SEGMENT_INTERPOLATOR == SEGMENT_INTERPOLATOR_FIXED) ? "fixed" : "float");
+    fprintf(out, "  \"exact_ends\": %lu,\n", (unsigned long)exact_ends);
+    fprintf(out, "  \"interpolators\": {\n");
+    _ramp_print(out, &result[0], segments, false);
+    _ramp_print(out, &result[1], segments, true);
+    fprintf(out, "  }\n}\n");
+
+    free(cases);
+    _bench_close(out);
+}
+
+/**** Kinematic models ****
+ *
+ *  Run with:  g2core.elf --kinematics N [--seed S] [--json results.json]
+ *
+ *  Runs every model in kinematics.h over N random points in a working envelope for it,
+ *  whatever KINEMATICS the build selected. Cartesian and CoreXY use a 400 x 400 x 100 mm
+ *  box, the delta a cylinder of 3/4 DELTA_RADIUS by 100 mm, and the SCARA the ring its
+ *  arms reach without folding flat or running straight. This does not start the firmware.
+ *
+ *  Per model:
+ *    inverse_ns          cost of one inverse(), as kn_inverse_kinematics() runs once per
+ *                        segment, best of KINEMATICS_TIMED_PASSES
+ *    forward_ns          the same for forward()
+ *    budget_pct          inverse_ns as a percent of NOM_SEGMENT_USEC. "fits" is whether
+ *                        that is within KINEMATICS_BUDGET_PCT. A board's clock is slower than
+ *                        the host's, so read the host number as a floor and check the exec
+ *                        stage of $prof on the board itself.
+ *    round_trip_max_mm   worst distance of forward(inverse(p)) from p
+ *    round_trip_mean_mm  mean of the same
+ *
+ *  "selected_ns" is the whole of kn_inverse_kinematics() for the model the build selected,
+ *  motor table included, with one motor on each axis. "selected_forward_ns" is the same for
+ *  kn_forward_kinematics() on the steps it made, and "selected_batch_ns" is one of them
+ *  converted by kn_forward_kinematics_batch() with all samples in one call.
+ */
+
+#define KINEMATICS_TIMED_PASSES 5
+
+typedef struct simKinematicsModel {
+    const char *name;
+    uint8_t id;                         // KINEMATICS_ value
+    void (*inverse)(const float travel[], float joint[]);
+    void (*forward)(const float joint[], float travel[]);
+} simKinematicsModel_t;
+
+static const simKinematicsModel_t kinematics_models[] = {
+    { "cartesian", KINEMATICS_CARTESIAN, knCartesian::inverse, knCartesian::forward },
+    { "corexy",    KINEMATICS_COREXY,    knCoreXY::inverse,    knCoreXY::forward },
+    { "delta",     KINEMATICS_DELTA,     knDelta::inverse,     knDelta::forward },
+    { "scara",     KINEMATICS_SCARA,     knScara::inverse,     knScara::forward }
+};
+#define KINEMATICS_MODELS (sizeof(kinematics_models) / sizeof(simKinematicsModel_t))
+
+static void _kinematics_point(uint32_t *state, uint8_t id, float travel[])
+{
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        travel[axis] = _uniform(state, -180, 180);     // rotary axes pass through
+    }
+    if (id == KINEMATICS_DELTA) {
+        double r = 0.75 * DELTA_RADIUS * sqrt(_uniform(state, 0, 1));
+        double theta = _uniform(state, 0, 2 * M_PI);
+        travel[AXIS_X] = r * cos(theta);
+        travel[AXIS_Y] = r * sin(theta);
+        travel[AXIS_Z] = _uniform(state, 0, 100);
+    } else if (id == KINEMATICS_SCARA) {
+        double reach = SCARA_ARM_1 + SCARA_ARM_2;
+        double r = _uniform(state, fabs(SCARA_ARM_1 - SCARA_ARM_2) + 0.1 * reach, 0.95 * reach);
+        double theta = _uniform(state, 0, 2 * M_PI);
+        travel[AXIS_X] = SCARA_OFFSET_X + r * cos(theta);
+        travel[AXIS_Y] = SCARA_OFFSET_Y + r * sin(theta);
+        travel[AXIS_Z] = _uniform(state, 0, 100);
+    } else {
+        travel[AXIS_X] = _uniform(state, 0, 400);
+        travel[AXIS_Y] = _uniform(state, 0, 400);
+        travel[AXIS_Z] = _uniform(state, 0, 100);
+    }
+}
+
+static void _kinematics_print(FILE *out, const simKinematicsModel_t *m, float *points, uint32_t count, bool last)
+{
+    float *joints = (float *)malloc(count * AXES * sizeof(float));
+    float travel[AXES];
+
+    volatile float sink = 0;
+    uint64_t inverse_ns = UINT64_MAX;
+    uint64_t forward_ns = UINT64_MAX;
+    for (uint8_t pass = 0; pass < KINEMATICS_TIMED_PASSES; pass++) {
+        uint64_t start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < count; i++) {
+            m->inverse(&points[i * AXES], &joints[i * AXES]);
+        }
+        inverse_ns = min(inverse_ns, Motate::Sim::hostNs() - start_ns);
+
+        start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < count; i++) {
+            m->forward(&joints[i * AXES], travel);
+            sink += travel[AXIS_X];
+        }
+        forward_ns = min(forward_ns, Motate::Sim::hostNs() - start_ns);
+    }
+
+    double err_max = 0;
+    double err_sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const float *p = &points[i * AXES];
+        m->forward(&joints[i * AXES], travel);
+        double err_sq = 0;
+        for (uint8_t axis = 0; axis < AXES; axis++) {
+            err_sq += square((double)travel[axis] - p[axis]);
+        }
+        err_max = max(err_max, sqrt(err_sq));
+        err_sum += sqrt(err_sq);
+    }
+    free(joints);
+
+    double ns_per_inverse = (double)inverse_ns / count;
+    double budget_pct = ns_per_inverse / (NOM_SEGMENT_USEC * 1000.0) * 100.0;
+    fprintf(out, "    \"%s\": {\n", m->name);
+    fprintf(out, "      \"inverse_ns\": %.1f,\n", ns_per_inverse);
+    fprintf(out, "      \"forward_ns\": %.1f,\n", (double)forward_ns / count);
+    fprintf(out, "      \"budget_pct\": %.4f,\n", budget_pct);
+    fprintf(out, "      \"fits\": %s,\n", (budget_pct <= KINEMATICS_BUDGET_PCT) ? "true" : "false");
+    fprintf(out, "      \"round_trip_max_mm\": %.3e,\n", err_max);
+    fprintf(out, "      \"round_trip_mean_mm\": %.3e\n", err_sum / count);
+    fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+void sim_bench_kinematics(uint32_t samples, uint32_t seed, const char *json_path)
+{
+    FILE *out = _bench_open(json_path);
+    samples = _bench_samples(samples);
+    uint32_t state = _bench_seed(seed);
+    float *points = (float *)malloc(samples * AXES * sizeof(float));
+
+    const char *selected = "";
+    for (uint8_t k = 0; k < KINEMATICS_MODELS; k++) {
+        if (kinematics_models[k].id == KINEMATICS) {
+            selected = kinematics_models[k].name;
+        }
+    }
+    _bench_header(out, "kinematics");
+    fprintf(out, "  \"samples\": %lu,\n", (unsigned long)samples);
+    fprintf(out, "  \"seed\": %lu,\n", (unsigned long)seed);
+    fprintf(out, "  \"selected\": \"%s\",\n", selected);
+    fprintf(out, "  \"segment_us\": %.1f,\n", (double)NOM_SEGMENT_USEC);
+    fprintf(out, "  \"budget_pct\": %d,\n", KINEMATICS_BUDGET_PCT);
+
+    // the firmware's path for the selected model
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        st_cfg.mot[motor].motor_map = motor % AXES;
+        st_cfg.mot[motor].steps_per_unit = 40;
+        st_cfg.mot[motor].units_per_step = 1.0 / 40;
+    }
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        cm.a[axis].axis_mode = AXIS_STANDARD;
+    }
+    kn_config_changed();
+    for (uint32_t i = 0; i < samples; i++) {
+        _kinematics_point(&state, KINEMATICS, &points[i * AXES]);
+    }
+    float *steps = (float *)malloc(samples * MOTORS * sizeof(float));
+    float *travel = (float *)malloc(samples * AXES * sizeof(float));
+    volatile float sink = 0;
+    uint64_t selected_ns = UINT64_MAX;
+    uint64_t forward_ns = UINT64_MAX;
+    uint64_t batch_ns = UINT64_MAX;
+    for (uint8_t pass = 0; pass < KINEMATICS_TIMED_PASSES; pass++) {
+        uint64_t start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < samples; i++) {
+            kn_inverse_kinematics(&points[i * AXES], &steps[i * MOTORS]);
+            sink += steps[i * MOTORS];
+        }
+        selected_ns = min(selected_ns, Motate::Sim::hostNs() - start_ns);
+
+        start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < samples; i++) {
+            kn_forward_kinematics(&steps[i * MOTORS], &travel[i * AXES]);
+            sink += travel[i * AXES];
+        }
+        forward_ns = min(forward_ns, Motate::Sim::hostNs() - start_ns);
+
+        start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < samples; i += UINT16_MAX) {
+            uint16_t count = min(samples - i, (uint32_t)UINT16_MAX);
+            kn_forward_kinematics_batch(&steps[i * MOTORS], &travel[i * AXES], count);
+            sink += travel[i * AXES];
+        }
+        batch_ns = min(batch_ns, Motate::Sim::hostNs() - start_ns);
+    }
+    free(travel);
+    free(steps);
+    fprintf(out, "  \"selected_ns\": %.1f,\n", (double)selected_ns / samples);
+    fprintf(out, "  \"selected_forward_ns\": %.1f,\n", (double)forward_ns / samples);
+    fprintf(out, "  \"selected_batch_ns\": %.1f,\n", (double)batch_ns / samples);
+
+    fprintf(out, "  \"models\": {\n");
+    for (uint8_t k = 0; k < KINEMATICS_MODELS; k++) {
+        for (uint32_t i = 0; i < samples; i++) {
+            _kinematics_point(&state, kinematics_models[k].id, &points[i * AXES]);
+        }
+        _kinematics_print(out, &kinematics_models[k], points, samples, k+1 == KINEMATICS_MODELS);
+    }
+    fprintf(out, "  }\n}\n");
+
+    free(points);
+    _bench_close(out);
+}
+
+/**** Z compensation grid ****
+ *
+ *  Run with:  g2core.elf --mesh N [--seed S] [--json results.json]
+ *
+ *  Builds a MESH_SIZE_MAX square grid of random heights, MESH_BENCH_SPACING apart, and walks
+ *  N segment ends over it and a little past its edges, in random straight moves cut into
+ *  MESH_BENCH_SEGMENT steps (a segment at the sim board's G0 rate). This does not start the
+ *  firmware.
+ *
+ *    off_ns              cost of mesh_apply() with the mesh off - the fast path every
+ *                        segment pays - best of MESH_TIMED_PASSES
+ *    on_ns               the same with the mesh on
+ *    with_kinematics_ns  kn_inverse_kinematics(mesh_apply()), as the exec runs them
+ *    budget_pct          on_ns as a percent of NOM_SEGMENT_USEC
+ *    interp_err_max_mm   worst difference from the bilinear interpolation in double
+ */
+
+#define MESH_TIMED_PASSES       5
+#define MESH_BENCH_SPACING      25.0        // mm
+#define MESH_BENCH_SEGMENT      0.5         // mm - 20000 mm/min for NOM_SEGMENT_TIME
+#define MESH_BENCH_HEIGHT       0.5         // mm - nodes are +/- this
+
+static double _mesh_reference(const float position[])
+{
+    double u = ((double)position[AXIS_X] - mesh.origin_x) / mesh.spacing_x;
+    double v = ((double)position[AXIS_Y] - mesh.origin_y) / mesh.spacing_y;
+    u = min(max(u, 0.0), (double)(mesh.count_x - 1));
+    v = min(max(v, 0.0), (double)(mesh.count_y - 1));
+    int i = min((int)floor(u), mesh.count_x - 2);
+    int j = min((int)floor(v), mesh.count_y - 2);
+    u -= i;
+    v -= j;
+    const float *z = &mesh.z[j * mesh.count_x + i];
+    return ((1-u)*(1-v)*z[0] + u*(1-v)*z[1] + (1-u)*v*z[mesh.count_x] + u*v*z[mesh.count_x + 1]);
+}
+
+void sim_bench_mesh(uint32_t samples, uint32_t seed, const char *json_path)
+{
+    FILE *out = _bench_open(json_path);
+    samples = _bench_samples(samples);
+    uint32_t state = _bench_seed(seed);
+
+    mesh_init();
+    mesh.count_x = MESH_SIZE_MAX;
+    mesh.count_y = MESH_SIZE_MAX;
+    mesh.spacing_x = MESH_BENCH_SPACING;
+    mesh.spacing_y = MESH_BENCH_SPACING;
+    mesh.nodes_per_mm_x = 1 / mesh.spacing_x;
+    mesh.nodes_per_mm_y = 1 / mesh.spacing_y;
+    for (uint16_t n = 0; n < MESH_NODES_MAX; n++) {
+        mesh.z[n] = _uniform(&state, -MESH_BENCH_HEIGHT, MESH_BENCH_HEIGHT);
+    }
+    const double size = (MESH_SIZE_MAX - 1) * MESH_BENCH_SPACING;
+
+    // segment ends of random moves, each from where the last one ended
+    float *points = (float *)malloc(samples * AXES * sizeof(float));
+    float from[AXES] = { 0 };
+    float to[AXES] = { 0 };
+    uint32_t segments = 0;
+    uint32_t segment = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        if (segment == segments) {
+            copy_vector(from, to);
+            to[AXIS_X] = _uniform(&state, -0.05 * size, 1.05 * size);
+            to[AXIS_Y] = _uniform(&state, -0.05 * size, 1.05 * size);
+            to[AXIS_Z] = _uniform(&state, 0, 10);
+            double length = sqrt(square(to[AXIS_X] - from[AXIS_X]) + square(to[AXIS_Y] - from[AXIS_Y]));
+            segments = max((uint32_t)ceil(length / MESH_BENCH_SEGMENT), (uint32_t)1);
+            segment = 0;
+        }
+        segment++;
+        for (uint8_t axis = 0; axis < AXES; axis++) {
+            points[i * AXES + axis] = from[axis] + (to[axis] - from[axis]) * segment / segments;
+        }
+    }
+
+    // one motor on each axis for the kinematics
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        st_cfg.mot[motor].motor_map = motor % AXES;
+        st_cfg.mot[motor].steps_per_unit = 40;
+        st_cfg.mot[motor].units_per_step = 1.0 / 40;
+    }
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        cm.a[axis].axis_mode = AXIS_STANDARD;
+    }
+    kn_config_changed();
+
+    volatile float sink = 0;
+    uint64_t off_ns = UINT64_MAX;
+    uint64_t on_ns = UINT64_MAX;
+    uint64_t kinematics_ns = UINT64_MAX;
+    for (uint8_t pass = 0; pass < MESH_TIMED_PASSES; pass++) {
+        float compensated[AXES];
+        float steps[MOTORS];
+
+        mesh.mode = MESH_OFF;
+        uint64_t start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < samples; i++) {
+            sink += mesh_apply(&points[i * AXES], compensated)[AXIS_Z];
+        }
+        off_ns = min(off_ns, Motate::Sim::hostNs() - start_ns);
+
+        mesh.mode = MESH_ON;
+        start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < samples; i++) {
+            sink += mesh_apply(&points[i * AXES], compensated)[AXIS_Z];
+        }
+        on_ns = min(on_ns, Motate::Sim::hostNs() - start_ns);
+
+        start_ns = Motate::Sim::hostNs();
+        for (uint32_t i = 0; i < samples; i++) {
+            kn_inverse_kinematics(mesh_apply(&points[i * AXES], compensated), steps);
+            sink += steps[MOTOR_3];
+        }
+        kinematics_ns = min(kinematics_ns, Motate::Sim::hostNs() - start_ns);
+    }
+
+    double err_max = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        err_max = max(err_max, fabs(mesh_offset(&points[i * AXES]) - _mesh_reference(&points[i * AXES])));
+    }
+    free(points);
+
+    double ns_per_on = (double)on_ns / samples;
+    _bench_header(out, "mesh");
+    fprintf(out, "  \"samples\": %lu,\n", (unsigned long)samples);
+    fprintf(out, "  \"seed\": %lu,\n", (unsigned long)seed);
+    fprintf(out, "  \"nodes\": %d,\n", MESH_NODES_MAX);
+    fprintf(out, "  \"segment_us\": %.1f,\n", (double)NOM_SEGMENT_USEC);
+    fprintf(out, "  \"off_ns\": %.1f,\n", (double)off_ns / samples);
+    fprintf(out, "  \"on_ns\": %.1f,\n", ns_per_on);
+    fprintf(out, "  \"with_kinematics_ns\": %.1f,\n", (double)kinematics_ns / samples);
+    fprintf(out, "  \"budget_pct\": %.4f,\n", ns_per_on / (NOM_SEGMENT_USEC * 1000.0) * 100.0);
+    fprintf(out, "  \"interp_err_max_mm\": %.3e\n", err_max);
+    fprintf(out, "}\n");
+
+    mesh_init();
+    _bench_close(out);
+}
+
+/**** Tram transform ****
+ *
+ *  Run with:  g2core.elf --tram N [--seed S] [--json results.json]
+ *
+ *  Queues N random feeds with mp_aline() for each $tram class (see cmRotationClass): none,
+ *  a level plane TRAM_BENCH_HEIGHT up, and that plane tilted by TRAM_BENCH_TILT. The matrix
+ *  is set by cm_set_tram() from three made up probes. The queue is emptied between batches,
+ *  outside the timing, and nothing is planned or run. This does not start the firmware.
+ *
+ *    identity_ns         mp_aline() per block with no $tram - best of TRAM_TIMED_PASSES
+ *    offset_ns           the same with the level plane
+ *    affine_ns           the same with the tilted plane
+ *    affine_err_max_mm   worst difference of a tilted target from the transform in double
+ *    round_trip_err_max_mm  worst difference of mp_get_runtime_work_position() at a tilted
+ *                        target from the target
+ */
+
+#define TRAM_TIMED_PASSES       5
+#define TRAM_BENCH_SIZE         400.0       // mm - targets are in a cube this size
+#define TRAM_BENCH_HEIGHT       1.5         // mm - Z of the probes
+#define TRAM_BENCH_TILT         0.01        // mm/mm - rise of the tilted plane in X and Y
+
+static void _tram_set(uint8_t rotation_class)
+{
+    canonical_machine_reset_rotation();
+    if (rotation_class == ROTATION_IDENTITY) {
+        return;
+    }
+    const float tilt = (rotation_class == ROTATION_AFFINE) ? TRAM_BENCH_TILT : 0;
+    const float probes[PROBES_STORED][2] = { { 0, 0 }, { 100, 0 }, { 0, 100 } };
+    for (uint8_t i = 0; i < PROBES_STORED; i++) {
+        cm.probe_state[i] = PROBE_SUCCEEDED;
+        cm.probe_results[i][AXIS_X] = probes[i][0];
+        cm.probe_results[i][AXIS_Y] = probes[i][1];
+        cm.probe_results[i][AXIS_Z] = TRAM_BENCH_HEIGHT + (probes[i][0] + probes[i][1]) * tilt;
+    }
+    nvObj_t nv;
+    memset(&nv, 0, sizeof(nv));
+    nv.value = true;
+    nv.valuetype = TYPE_BOOL;
+    cm_set_tram(&nv);
+}
+
+static uint64_t _tram_run(const float *targets, uint32_t count, double *affine_err, double *round_trip_err)
+{
+    GCodeState_t gm;
+    memset(&gm, 0, sizeof(gm));
+    gm.motion_mode = MOTION_MODE_STRAIGHT_FEED;
+    gm.feed_rate_mode = UNITS_PER_MINUTE_MODE;
+    gm.feed_rate = 1000;
+
+    planner_init();
+    uint64_t total_ns = 0;
+    uint32_t i = 0;
+    while (i < count) {
+        mp_init_buffers();                              // a fresh queue for the batch, untimed
+        uint32_t batch = min(count - i, (uint32_t)(mb.size - 1));
+        uint64_t start_ns = Motate::Sim::hostNs();
+        for (uint32_t k = i; k < i + batch; k++) {
+            copy_vector(gm.target, &targets[k * AXES]);
+            mp_aline(&gm);
+        }
+        total_ns += Motate::Sim::hostNs() - start_ns;
+        i += batch;
+
+        if (affine_err == NULL) {
+            continue;
+        }
+        const float *target = &targets[(i - 1) * AXES];    // the last target is the planner position
+        for (uint8_t axis = AXIS_X; axis <= AXIS_Z; axis++) {
+            double rotated = cm.rotation_matrix[axis][3];
+            for (uint8_t j = 0; j < 3; j++) {
+                rotated += (double)cm.rotation_matrix[axis][j] * target[j];
+            }
+            *affine_err = max(*affine_err, fabs(mp.position[axis] - rotated));
+        }
+        copy_vector(mr.position, mp.position);
+        memset(mr.gm.work_offset, 0, sizeof(mr.gm.work_offset));
+        for (uint8_t axis = AXIS_X; axis <= AXIS_Z; axis++) {
+            *round_trip_err = max(*round_trip_err, fabs((double)mp_get_runtime_work_position(axis) - target[axis]));
+        }
+    }
+    return (total_ns);
+}
+
+void sim_bench_tram(uint32_t samples, uint32_t seed, const char *json_path)
+{
+    FILE *out = _bench_open(json_path);
+    samples = _bench_samples(samples);
+    uint32_t state = _bench_seed(seed);
+
+    canonical_machine_init();
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        cm.a[axis].axis_mode = AXIS_STANDARD;
+        cm.a[axis].velocity_max = 20000;
+        cm.a[axis].feedrate_max = 20000;
+        cm.a[axis].jerk_max = 5000;
+    }
+    float *targets = (float *)malloc(samples * AXES * sizeof(float));
+    for (uint32_t i = 0; i < samples; i++) {
+        for (uint8_t axis = 0; axis < AXES; axis++) {
+            targets[i * AXES + axis] = (axis <= AXIS_Z) ? _uniform(&state, 0, TRAM_BENCH_SIZE) : 0;
+        }
+    }
+
+    const uint8_t classes[] = { ROTATION_IDENTITY, ROTATION_OFFSET, ROTATION_AFFINE };
+    uint64_t best_ns[3] = { UINT64_MAX, UINT64_MAX, UINT64_MAX };
+    uint8_t measured[3];
+    double affine_err = 0;
+    double round_trip_err = 0;
+    for (uint8_t pass = 0; pass < TRAM_TIMED_PASSES; pass++) {
+        for (uint8_t c = 0; c < 3; c++) {
+            _tram_set(classes[c]);
+            measured[c] = cm.rotation_class;
+            bool check = (pass == 0) && (classes[c] == ROTATION_AFFINE);
+            best_ns[c] = min(best_ns[c], _tram_run(targets, samples, check ? &affine_err : NULL,
+                                                                    check ? &round_trip_err : NULL));
+        }
+    }
+    free(targets);
+
+    _bench_header(out, "tram");
+    fprintf(out, "  \"samples\": %lu,\n", (unsigned long)samples);
+    fprintf(out, "  \"seed\": %lu,\n", (unsigned long)seed);
+    fprintf(out, "  \"classes\": [%d, %d, %d],\n", measured[0], measured[1], measured[2]);
+    fprintf(out, "  \"identity_ns\": %.1f,\n", (double)best_ns[0] / samples);
+    fprintf(out, "  \"offset_ns\": %.1f,\n", (double)best_ns[1] / samples);
+    fprintf(out, "  \"affine_ns\": %.1f,\n", (double)best_ns[2] / samples);
+    fprintf(out, "  \"affine_err_max_mm\": %.3e,\n", affine_err);
+    fprintf(out, "  \"round_trip_err_max_mm\": %.3e\n", round_trip_err);
+    fprintf(out, "}\n");
+
+    canonical_machine_reset_rotation();
+    planner_init();
+    _bench_close(out);
+}
@@ -0,0 +1,103 @@
+/*
+ * sim_bench.h - planner throughput benchmark for the host simulator
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SIM_BENCH_H_ONCE
+#define SIM_BENCH_H_ONCE
+
+#include <stdint.h>
+
+/**** Planner throughput benchmark ****
+ *
+ *  Run with:  g2core.elf --bench [--json results.json] [--setup '$lct=0.002'] Resources/gcode/<name>.h ...
+ *
+ *  Each program is streamed through the unmodified firmware on the sim board:
+ *  gcode_parser() -> cm_straight_feed() -> mp_aline() -> mp_plan_block_list() ->
+ *  mp_plan_move() -> mp_exec_aline(). Program files may be plain gcode or one of the
+ *  Resources/gcode/<name>.h headers, in which case the live string literals are used.
+ *
+ *  Firmware responses are discarded. Results go to stdout (or the --json file) as
+ *  one JSON object, so runs of different builds can be compared mechanically.
+ */
+
+void sim_bench_init(const char *json_path, const char *setup);
+void sim_bench_add_program(const char *path);
+bool sim_bench_active(void);
+bool sim_bench_next_program(uint64_t end_ns);  // finish the current program at virtual time end_ns, start the next; false when done
+void sim_bench_report(void);
+
+/**** Meet velocity solver comparison ****
+ *
+ *  Run with:  g2core.elf --meet-accuracy N [--seed S] [--json results.json]
+ *
+ *  Compares mp_get_meet_velocity_newton() and mp_get_meet_velocity_bracketed() over N
+ *  randomized cases, against a double precision reference. Exits when done.
+ */
+
+void sim_bench_meet_accuracy(uint32_t samples, uint32_t seed, const char *json_path);
+
+/**** Segment interpolator comparison ****
+ *
+ *  Run with:  g2core.elf --segment-drift HOURS [--seed S] [--json results.json]
+ *
+ *  Runs the float and fixed point segment interpolators over HOURS of random velocity
+ *  ramps and compares them with the exact curve. Exits when done.
+ */
+
+void sim_bench_segment_drift(float hours, uint32_t seed, const char *json_path);
+
+/**** Kinematic models ****
+ *
+ *  Run with:  g2core.elf --kinematics N [--seed S] [--json results.json]
+ *
+ *  Times the inverse and forward kinematics of every model in kinematics.h over N random
+ *  points, against the per segment budget, and checks their round trip. Exits when done.
+ */
+
+void sim_bench_kinematics(uint32_t samples, uint32_t seed, const char *json_path);
+
+/**** Z compensation grid ****
+ *
+ *  Run with:  g2core.elf --mesh N [--seed S] [--json results.json]
+ *
+ *  Times the per segment cost of the mesh (see mesh.h), off and on, over N segment ends on
+ *  a random full size grid, and checks the interpolation. Exits when done.
+ */
+
+void sim_bench_mesh(uint32_t samples, uint32_t seed, const char *json_path);
+
+/**** Tram transform ****
+ *
+ *  Run with:  g2core.elf --tram N [--seed S] [--json results.json]
+ *
+ *  Times mp_aline() over N random feeds with no $tram, a level plane and a tilted one, and
+ *  checks the tilted targets and their round trip back to work coordinates. Exits when done.
+ */
+
+void sim_bench_tram(uint32_t samples, uint32_t seed, const char *json_path);
+
+#endif // SIM_BENCH_H_ONCE
@@ -66,6 +66,10 @@ stat_t _set_leds(nvObj_t *nv);
 #define COORDS 6       // number of supported coordinate systems (1-6)
 #define PWMS 1         // number of supported PWM channels
 
+/***** Planner queue *****/
+
+#define PLANNER_BUFFER_POOL_SIZE 48     // planner buffers (blocks)
+
 
 ////////////////////////////
 /////// ARM VERSION ////////
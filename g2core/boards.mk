@@ -138,5 +138,15 @@ ifeq ("$(CONFIG)","Ultimakerv9k")
     SETTINGS_FILE="settings_ultimaker.h"
 endif
 
+##########
+# Host simulator configs:
+
+ifeq ("$(CONFIG)","Sim")
+    ifeq ("$(BOARD)","NONE")
+        BOARD=sim
+    endif
+    SETTINGS_FILE="settings_sim.h"
+endif
+
 include $(wildcard ./board/$(STAR).mk)
 
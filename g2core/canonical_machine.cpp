@@ -97,6 +97,7 @@
 #include "plan_arc.h"
 #include "planner.h"
 #include "stepper.h"
+#include "kinematics.h"
 #include "encoder.h"
 #include "spindle.h"
 #include "coolant.h"
@@ -220,7 +221,7 @@ cmCombinedState cm_get_combined_state()
 
 /*  These getters and setters will work on any gm model with inputs:
  *    MODEL         (GCodeState_t *)&cm.gm          // absolute pointer from canonical machine gm model
- *    PLANNER       (GCodeState_t *)&bf->gm         // relative to buffer *bf is currently pointing to
+ *    PLANNER       (GCodeState_t *)bf->gm          // relative to buffer *bf is currently pointing to
  *    RUNTIME       (GCodeState_t *)&mr.gm          // absolute pointer from runtime mm struct
  *    ACTIVE_MODEL   cm.am                          // active model pointer is maintained by state management
  */
@@ -311,7 +312,7 @@ float cm_get_active_coord_offset(const uint8_t axis)
  * cm_get_work_offset() - return a coord offset from the gcode_state
  *
  *    MODEL         (GCodeState_t *)&cm.gm          // absolute pointer from canonical machine gm model
- *    PLANNER       (GCodeState_t *)&bf->gm         // relative to buffer *bf is currently pointing to
+ *    PLANNER       (GCodeState_t *)bf->gm          // relative to buffer *bf is currently pointing to
  *    RUNTIME       (GCodeState_t *)&mr.gm          // absolute pointer from runtime mm struct
  *    ACTIVE_MODEL   cm.am                          // active model pointer is maintained by state management
  */
@@ -325,7 +326,7 @@ float cm_get_work_offset(const GCodeState_t *gcode_state, const uint8_t axis)
  * cm_set_work_offsets() - capture coord offsets from the model into absolute values in the gcode_state
  *
  *    MODEL         (GCodeState_t *)&cm.gm          // absolute pointer from canonical machine gm model
- *    PLANNER       (GCodeState_t *)&bf->gm         // relative to buffer *bf is currently pointing to
+ *    PLANNER       (GCodeState_t *)bf->gm          // relative to buffer *bf is currently pointing to
  *    RUNTIME       (GCodeState_t *)&mr.gm          // absolute pointer from runtime mm struct
  *    ACTIVE_MODEL   cm.am                          // active model pointer is maintained by state management
  */
@@ -439,6 +440,29 @@ stat_t cm_deferred_write_callback()
     return (STAT_OK);
 }
 
+/*
+ * _set_rotation_class() - classify the matrix for mp_aline() after it changes
+ *
+ *  The tests are exact: a level plane gives exactly 1s and 0s, and anything else has to be
+ *  rotated for the planner to match it.
+ */
+
+static void _set_rotation_class()
+{
+    cm.rotation_class = ROTATION_IDENTITY;
+    for (uint8_t i=0; i<3; i++) {
+        for (uint8_t j=0; j<3; j++) {
+            if (cm.rotation_matrix[i][j] != ((i == j) ? 1.0 : 0.0)) {
+                cm.rotation_class = ROTATION_AFFINE;
+                return;
+            }
+        }
+        if (cm.rotation_matrix[i][3] != 0.0) {
+            cm.rotation_class = ROTATION_OFFSET;
+        }
+    }
+}
+
 /*
  * cm_set_tram() - JSON command to trigger computing the rotation matrix
  * cm_get_tram() - JSON query to determine if the rotation matrix is set (non-identity)
@@ -535,7 +559,10 @@ stat_t cm_set_tram(nvObj_t *nv)
             cm.rotation_matrix[2][2] = 1 - q_xx_2 - q_yy_2;
 
             // Step 4: compute the z-offset
-            cm.rotation_z_offset = (n_x*cm.probe_results[1][0] + n_y*cm.probe_results[1][1]) / n_z + cm.probe_results[1][2];
+            cm.rotation_matrix[0][3] = 0.0;
+            cm.rotation_matrix[1][3] = 0.0;
+            cm.rotation_matrix[2][3] = (n_x*cm.probe_results[1][0] + n_y*cm.probe_results[1][1]) / n_z + cm.probe_results[1][2];
+            _set_rotation_class();
         } else {
             return (STAT_COMMAND_NOT_ACCEPTED);
         }
@@ -552,7 +579,7 @@ stat_t cm_get_tram(nvObj_t *nv)
 {
     nv->value = true;
 
-    if (fp_NOT_ZERO(cm.rotation_z_offset) ||
+    if (fp_NOT_ZERO(cm.rotation_matrix[2][3]) ||
         fp_NOT_ZERO(cm.rotation_matrix[0][1]) ||
         fp_NOT_ZERO(cm.rotation_matrix[0][2]) ||
         fp_NOT_ZERO(cm.rotation_matrix[1][0]) ||
@@ -709,12 +736,12 @@ void canonical_machine_init()
 }
 
 void canonical_machine_reset_rotation() {
-    memset(&cm.rotation_matrix, 0, sizeof(float)*3*3);
-    // We must make it an identity matrix for no rotation
+    memset(&cm.rotation_matrix, 0, sizeof(cm.rotation_matrix));
+    // We must make it an identity matrix for no rotation, with no offset
     cm.rotation_matrix[0][0] = 1.0;
     cm.rotation_matrix[1][1] = 1.0;
     cm.rotation_matrix[2][2] = 1.0;
-    cm.rotation_z_offset = 0.0;
+    cm.rotation_class = ROTATION_IDENTITY;
 }
 
 void canonical_machine_reset()
@@ -723,7 +750,7 @@ void canonical_machine_reset()
     cm_set_units_mode(cm.default_units_mode);
     cm_set_coord_system(cm.default_coord_system);   // NB: queues a block to the planner with the coordinates
     cm_select_plane(cm.default_select_plane);
-    cm_set_path_control(MODEL, cm.default_path_control);
+    cm_set_path_control(MODEL, cm.default_path_control, 0, false);
     cm_set_distance_mode(cm.default_distance_mode);
     cm_set_arc_distance_mode(INCREMENTAL_MODE);     // always the default
     cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);   // always the default
@@ -1343,11 +1370,19 @@ stat_t cm_set_feed_rate_mode(const uint8_t mode)
 
 /*
  * cm_set_path_control() - G61, G61.1, G64
+ *
+ *  G64 P<tolerance> lets the planner replace corners between feeds with blend arcs that
+ *  stay within the tolerance of the corner (see mp_aline()). G64 without P, G61 and G61.1
+ *  turn blending off.
  */
 
-stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode)
+stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode, const float P_word, const bool P_word_f)
 {
+    if (P_word_f && (P_word < 0)) {
+        return (STAT_P_WORD_IS_NEGATIVE);
+    }
     gcode_state->path_control = (cmPathControl)mode;
+    gcode_state->path_tolerance = ((mode == PATH_CONTINUOUS) && P_word_f) ? _to_millimeters(P_word) : 0;
     return (STAT_OK);
 }
 
@@ -2259,6 +2294,7 @@ stat_t cm_set_am(nvObj_t *nv)        // axis mode
         if (nv->value > AXIS_MODE_MAX_ROTARY) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
     }
     set_ui8(nv);
+    kn_config_changed();
     return(STAT_OK);
 }
 
@@ -2381,6 +2417,30 @@ stat_t cm_set_jt(nvObj_t *nv)
     return(status);
 }
 
+/*
+ * cm_set_srl() - set the step rate limit, as a fraction of FREQUENCY_DDA (0 = off)
+ *
+ *  A DDA tick can make at most one step, so the limit may not exceed STEP_RATE_LIMIT_MAX.
+ *  It applies to moves planned after it is set. Kinematic models that aren't linear can't
+ *  limit their motors' rates (see kinematics.h), so they only take 0.
+ */
+
+stat_t cm_set_srl(nvObj_t *nv)
+{
+    if (nv->value < 0) {
+        return (STAT_INPUT_LESS_THAN_MIN_VALUE);
+    }
+#if (KINEMATICS_LINEAR)
+    if (nv->value > STEP_RATE_LIMIT_MAX) {
+#else
+    if (nv->value > 0) {
+#endif
+        return (STAT_INPUT_EXCEEDS_MAX_VALUE);
+    }
+    set_flt(nv);
+    return(STAT_OK);
+}
+
 /*
  * cm_set_mfo() - set manual feedrate override factor
  * cm_set_mto() - set manual traverse override factor
@@ -2563,12 +2623,16 @@ void cm_print_gdi(nvObj_t *nv) { text_print(nv, fmt_gdi);}  // TYPE_INT
 
 static const char fmt_jt[] = "[jt]  junction integrgation time%6.2f\n";
 static const char fmt_ct[] = "[ct]  chordal tolerance%17.4f%s\n";
+static const char fmt_lct[] ="[lct] line coalesce tolerance%11.4f%s\n";
+static const char fmt_srl[] ="[srl] step rate limit%19.2f [fraction of DDA rate, 0=off]\n";
 static const char fmt_sl[] = "[sl]  soft limit enable%12d [0=disable,1=enable]\n";
 static const char fmt_lim[] ="[lim] limit switch enable%10d [0=disable,1=enable]\n";
 static const char fmt_saf[] ="[saf] safety interlock enable%6d [0=disable,1=enable]\n";
 
 void cm_print_jt(nvObj_t *nv) { text_print(nv, fmt_jt);}        // TYPE FLOAT
 void cm_print_ct(nvObj_t *nv) { text_print_flt_units(nv, fmt_ct, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_lct(nvObj_t *nv){ text_print_flt_units(nv, fmt_lct, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_srl(nvObj_t *nv){ text_print(nv, fmt_srl);}       // TYPE FLOAT
 void cm_print_sl(nvObj_t *nv) { text_print(nv, fmt_sl);}        // TYPE_INT
 void cm_print_lim(nvObj_t *nv){ text_print(nv, fmt_lim);}       // TYPE_INT
 void cm_print_saf(nvObj_t *nv){ text_print(nv, fmt_saf);}       // TYPE_INT
@@ -38,7 +38,7 @@
 /* Defines, Macros, and  Assorted Parameters */
 
 #define MODEL   (GCodeState_t *)&cm.gm      // absolute pointer from canonical machine gm model
-#define PLANNER (GCodeState_t *)&bf->gm     // relative to buffer *bf is currently pointing to
+#define PLANNER (GCodeState_t *)bf->gm      // relative to buffer *bf is currently pointing to
 #define RUNTIME (GCodeState_t *)&mr.gm      // absolute pointer from runtime mm struct
 #define ACTIVE_MODEL cm.am                  // active model pointer is maintained by state management
 
@@ -140,6 +140,12 @@ typedef enum {                  // applies to cm.probe_state
     PROBE_WAITING               // probe is waiting to be started
 } cmProbeState;
 
+typedef enum {                  // applies to cm.rotation_class
+    ROTATION_IDENTITY = 0,      // no $tram - targets are used as they are
+    ROTATION_OFFSET,            // a level plane - only the Z offset applies
+    ROTATION_AFFINE             // a tilted plane - rotate and offset
+} cmRotationClass;
+
 typedef enum {
     SAFETY_INTERLOCK_ENGAGED = 0, // meaning the interlock input is CLOSED (low)
     SAFETY_INTERLOCK_DISENGAGED
@@ -334,6 +340,7 @@ typedef struct GCodeState {             // Gcode model state - used by model, pl
     cmCanonicalPlane select_plane;      // G17,G18,G19 - values to set plane to
     cmUnitsMode units_mode;             // G20,G21 - 0=inches (G20), 1 = mm (G21)
     cmPathControl path_control;         // G61... EXACT_PATH, EXACT_STOP, CONTINUOUS
+    float path_tolerance;               // G64 P - corner blending tolerance in mm, 0 = no blending
     cmDistanceMode distance_mode;       // G90=use absolute coords, G91=incremental movement
     cmDistanceMode arc_distance_mode;   // G90.1=use absolute IJK offsets, G91.1=incremental IJK offsets
     cmAbsoluteOverride absolute_override;// G53 TRUE = move using machine coordinates - this block only
@@ -493,6 +500,9 @@ typedef struct cmSingleton {                // struct to manage cm globals and c
     // system group settings
     float junction_integration_time;        // how aggressively will the machine corner? 1.6 or so is about the upper limit
     float chordal_tolerance;                // arc chordal accuracy setting in mm
+    float coalesce_tolerance;               // path deviation allowed when merging colinear feeds, in mm. 0 = off
+    float step_rate_limit;                  // fastest any motor may step, as a fraction of FREQUENCY_DDA. 0 = off
+    uint32_t planner_lookahead_ms;          // motion time to queue before input is held off. 0 = block count only
     bool soft_limit_enable;                 // true to enable soft limit testing on Gcode inputs
     bool limit_enable;                      // true to enable limit switches (disabled is same as override)
     bool safety_interlock_enable;           // true to enable safety interlock system
@@ -532,10 +542,11 @@ typedef struct cmSingleton {                // struct to manage cm globals and c
     cmProbeState probe_state[PROBES_STORED];                 // probing state machine (simple)
     float probe_results[PROBES_STORED][AXES]; // probing results
 
-    float rotation_matrix[3][3];            // three-by-three rotation matrix. We ignore rotary axes.
-    float rotation_z_offset;                // we seperately handle a z-offset, so that the new plane
-                                            // maintains a consistent distance from the old one.
-                                            // We only need z, since we are rotating to the z axis.
+    float rotation_matrix[3][4];            // three-by-three rotation matrix with the offset as a 4th column,
+                                            // so XYZ = rotation * target + offset. We ignore rotary axes.
+                                            // Only the z-offset is used, so that the new plane maintains a
+                                            // consistent distance from the old one.
+    cmRotationClass rotation_class;         // what the matrix does, so the identity costs nothing
 
     float jogging_dest;                     // jogging direction as a relative move from current position
 
@@ -665,7 +676,8 @@ stat_t cm_goto_g30_position(const float target[], const bool flags[]);      // G
 // Machining Attributes (4.3.5)
 stat_t cm_set_feed_rate(const float feed_rate);                             // F parameter
 stat_t cm_set_feed_rate_mode(const uint8_t mode);                           // G93, G94, (G95 unimplemented)
-stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode);  // G61, G61.1, G64
+stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode,   // G61, G61.1, G64
+                           const float P_word, const bool P_word_f);
 
 // Machining Functions (4.3.6)
 stat_t cm_straight_feed(const float target[], const bool flags[]);          // G1
@@ -781,6 +793,7 @@ stat_t cm_set_am(nvObj_t *nv);          // set axis mode
 stat_t cm_set_hi(nvObj_t *nv);          // set homing input
 
 stat_t cm_set_jt(nvObj_t *nv);          // set junction integration time constant
+stat_t cm_set_srl(nvObj_t *nv);         // set step rate limit
 stat_t cm_set_vm(nvObj_t *nv);          // set velocity max and reciprocal
 stat_t cm_set_fr(nvObj_t *nv);          // set feedrate max and reciprocal
 stat_t cm_set_jm(nvObj_t *nv);          // set jerk max with 1,000,000 correction
@@ -830,6 +843,8 @@ stat_t cm_get_tram(nvObj_t *nv);        // return if the rotation matrix is non-
 
   void cm_print_jt(nvObj_t *nv);    // global CM settings
   void cm_print_ct(nvObj_t *nv);
+  void cm_print_lct(nvObj_t *nv);
+  void cm_print_srl(nvObj_t *nv);
   void cm_print_sl(nvObj_t *nv);
   void cm_print_lim(nvObj_t *nv);
   void cm_print_saf(nvObj_t *nv);
@@ -896,6 +911,8 @@ stat_t cm_get_tram(nvObj_t *nv);        // return if the rotation matrix is non-
 
   #define cm_print_jt tx_print_stub    // global CM settings
   #define cm_print_ct tx_print_stub
+  #define cm_print_lct tx_print_stub
+  #define cm_print_srl tx_print_stub
   #define cm_print_sl tx_print_stub
   #define cm_print_lim tx_print_stub
   #define cm_print_saf tx_print_stub
@@ -36,6 +36,9 @@
 #include "settings.h"
 #include "planner.h"
 #include "plan_arc.h"
+#include "plan_trace.h"
+#include "profile.h"
+#include "mesh.h"
 #include "stepper.h"
 #include "gpio.h"
 #include "spindle.h"
@@ -173,6 +176,17 @@ const cfgItem_t cfgArray[] = {
     { "prb","prbb",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[0][AXIS_B], 0 },
     { "prb","prbc",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[0][AXIS_C], 0 },
 
+    { "zm","zme", _f0,   0, mesh_print_zme, get_ui8, mesh_set_zme, (float *)&mesh.mode,      MESH_OFF },  // Z compensation grid
+    { "zm","zmx", _fipc, 3, mesh_print_zmx, get_flt, mesh_set_org, (float *)&mesh.origin_x,  MESH_ORIGIN_X },
+    { "zm","zmy", _fipc, 3, mesh_print_zmy, get_flt, mesh_set_org, (float *)&mesh.origin_y,  MESH_ORIGIN_Y },
+    { "zm","zmdx",_fipc, 3, mesh_print_zmdx,get_flt, mesh_set_spc, (float *)&mesh.spacing_x, MESH_SPACING_X },
+    { "zm","zmdy",_fipc, 3, mesh_print_zmdy,get_flt, mesh_set_spc, (float *)&mesh.spacing_y, MESH_SPACING_Y },
+    { "zm","zmnx",_fip,  0, mesh_print_zmnx,get_ui8, mesh_set_cnt, (float *)&mesh.count_x,   MESH_COUNT_X },
+    { "zm","zmny",_fip,  0, mesh_print_zmny,get_ui8, mesh_set_cnt, (float *)&mesh.count_y,   MESH_COUNT_Y },
+    { "zm","zmi", _f0,   0, mesh_print_zmi, get_ui8, mesh_set_zmi, (float *)&mesh.index,     0 },         // node for zmz
+    { "zm","zmz", _fc,   3, mesh_print_zmz, mesh_get_zmz, mesh_set_zmz, (float *)&cs.null,  0 },         // Z of that node
+    { "zm","zmc", _f0,   0, tx_print_nul,   get_nul, mesh_set_zmc, (float *)&cs.null,        0 },         // SET to clear the grid
+
     { "jog","jogx",_f0, 0, tx_print_nul, get_nul, cm_run_jogx, (float *)&cm.jogging_dest, 0},
     { "jog","jogy",_f0, 0, tx_print_nul, get_nul, cm_run_jogy, (float *)&cm.jogging_dest, 0},
     { "jog","jogz",_f0, 0, tx_print_nul, get_nul, cm_run_jogz, (float *)&cm.jogging_dest, 0},
@@ -196,7 +210,7 @@ const cfgItem_t cfgArray[] = {
 #endif
 
     // Motor parameters
-    { "1","1ma",_fip, 0, st_print_ma, get_ui8, set_ui8,     (float *)&st_cfg.mot[MOTOR_1].motor_map,      M1_MOTOR_MAP },
+    { "1","1ma",_fip, 0, st_print_ma, get_ui8, st_set_ma,   (float *)&st_cfg.mot[MOTOR_1].motor_map,      M1_MOTOR_MAP },
     { "1","1sa",_fip, 3, st_print_sa, get_flt, st_set_sa,   (float *)&st_cfg.mot[MOTOR_1].step_angle,     M1_STEP_ANGLE },
     { "1","1tr",_fipc,4, st_print_tr, get_flt, st_set_tr,   (float *)&st_cfg.mot[MOTOR_1].travel_rev,     M1_TRAVEL_PER_REV },
     { "1","1mi",_fip, 0, st_print_mi, get_ui8, st_set_mi,   (float *)&st_cfg.mot[MOTOR_1].microsteps,     M1_MICROSTEPS },
@@ -207,7 +221,7 @@ const cfgItem_t cfgArray[] = {
 //  { "1","1pi",_fip, 3, st_print_pi, get_flt, st_set_pi,   (float *)&st_cfg.mot[MOTOR_1].power_idle,     M1_POWER_IDLE },
 //  { "1","1mt",_fip, 2, st_print_mt, get_flt, st_set_mt,   (float *)&st_cfg.mot[MOTOR_1].motor_timeout,  M1_MOTOR_TIMEOUT },
 #if (MOTORS >= 2)
-    { "2","2ma",_fip, 0, st_print_ma, get_ui8, set_ui8,     (float *)&st_cfg.mot[MOTOR_2].motor_map,      M2_MOTOR_MAP },
+    { "2","2ma",_fip, 0, st_print_ma, get_ui8, st_set_ma,   (float *)&st_cfg.mot[MOTOR_2].motor_map,      M2_MOTOR_MAP },
     { "2","2sa",_fip, 3, st_print_sa, get_flt, st_set_sa,   (float *)&st_cfg.mot[MOTOR_2].step_angle,     M2_STEP_ANGLE },
     { "2","2tr",_fipc,4, st_print_tr, get_flt, st_set_tr,   (float *)&st_cfg.mot[MOTOR_2].travel_rev,     M2_TRAVEL_PER_REV },
     { "2","2mi",_fip, 0, st_print_mi, get_ui8, st_set_mi,   (float *)&st_cfg.mot[MOTOR_2].microsteps,     M2_MICROSTEPS },
@@ -219,7 +233,7 @@ const cfgItem_t cfgArray[] = {
 //  { "2","2mt",_fip, 2, st_print_mt, get_flt, st_set_mt,   (float *)&st_cfg.mot[MOTOR_2].motor_timeout,  M2_MOTOR_TIMEOUT },
 #endif
 #if (MOTORS >= 3)
-    { "3","3ma",_fip, 0, st_print_ma, get_ui8, set_ui8,     (float *)&st_cfg.mot[MOTOR_3].motor_map,      M3_MOTOR_MAP },
+    { "3","3ma",_fip, 0, st_print_ma, get_ui8, st_set_ma,   (float *)&st_cfg.mot[MOTOR_3].motor_map,      M3_MOTOR_MAP },
     { "3","3sa",_fip, 3, st_print_sa, get_flt, st_set_sa,   (float *)&st_cfg.mot[MOTOR_3].step_angle,     M3_STEP_ANGLE },
     { "3","3tr",_fipc,4, st_print_tr, get_flt, st_set_tr,   (float *)&st_cfg.mot[MOTOR_3].travel_rev,     M3_TRAVEL_PER_REV },
     { "3","3mi",_fip, 0, st_print_mi, get_ui8, st_set_mi,   (float *)&st_cfg.mot[MOTOR_3].microsteps,     M3_MICROSTEPS },
@@ -231,7 +245,7 @@ const cfgItem_t cfgArray[] = {
 //  { "3","3mt",_fip, 2, st_print_mt, get_flt, st_set_mt,   (float *)&st_cfg.mot[MOTOR_3].motor_timeout,  M3_MOTOR_TIMEOUT },
 #endif
 #if (MOTORS >= 4)
-    { "4","4ma",_fip, 0, st_print_ma, get_ui8, set_ui8,     (float *)&st_cfg.mot[MOTOR_4].motor_map,      M4_MOTOR_MAP },
+    { "4","4ma",_fip, 0, st_print_ma, get_ui8, st_set_ma,   (float *)&st_cfg.mot[MOTOR_4].motor_map,      M4_MOTOR_MAP },
     { "4","4sa",_fip, 3, st_print_sa, get_flt, st_set_sa,   (float *)&st_cfg.mot[MOTOR_4].step_angle,     M4_STEP_ANGLE },
     { "4","4tr",_fipc,4, st_print_tr, get_flt, st_set_tr,   (float *)&st_cfg.mot[MOTOR_4].travel_rev,     M4_TRAVEL_PER_REV },
     { "4","4mi",_fip, 0, st_print_mi, get_ui8, st_set_mi,   (float *)&st_cfg.mot[MOTOR_4].microsteps,     M4_MICROSTEPS },
@@ -243,7 +257,7 @@ const cfgItem_t cfgArray[] = {
 //  { "4","4mt",_fip, 2, st_print_mt, get_flt, st_set_mt,   (float *)&st_cfg.mot[MOTOR_4].motor_timeout,  M4_MOTOR_TIMEOUT },
 #endif
 #if (MOTORS >= 5)
-    { "5","5ma",_fip, 0, st_print_ma, get_ui8, set_ui8,     (float *)&st_cfg.mot[MOTOR_5].motor_map,      M5_MOTOR_MAP },
+    { "5","5ma",_fip, 0, st_print_ma, get_ui8, st_set_ma,   (float *)&st_cfg.mot[MOTOR_5].motor_map,      M5_MOTOR_MAP },
     { "5","5sa",_fip, 3, st_print_sa, get_flt, st_set_sa,   (float *)&st_cfg.mot[MOTOR_5].step_angle,     M5_STEP_ANGLE },
     { "5","5tr",_fipc,4, st_print_tr, get_flt, st_set_tr,   (float *)&st_cfg.mot[MOTOR_5].travel_rev,     M5_TRAVEL_PER_REV },
     { "5","5mi",_fip, 0, st_print_mi, get_ui8, st_set_mi,   (float *)&st_cfg.mot[MOTOR_5].microsteps,     M5_MICROSTEPS },
@@ -255,7 +269,7 @@ const cfgItem_t cfgArray[] = {
 //  { "5","5mt",_fip, 2, st_print_mt, get_flt, st_set_mt,   (float *)&st_cfg.mot[MOTOR_5].motor_timeout,  M5_MOTOR_TIMEOUT },
 #endif
 #if (MOTORS >= 6)
-    { "6","6ma",_fip, 0, st_print_ma, get_ui8, set_ui8,     (float *)&st_cfg.mot[MOTOR_6].motor_map,      M6_MOTOR_MAP },
+    { "6","6ma",_fip, 0, st_print_ma, get_ui8, st_set_ma,   (float *)&st_cfg.mot[MOTOR_6].motor_map,      M6_MOTOR_MAP },
     { "6","6sa",_fip, 3, st_print_sa, get_flt, st_set_sa,   (float *)&st_cfg.mot[MOTOR_6].step_angle,     M6_STEP_ANGLE },
     { "6","6tr",_fipc,4, st_print_tr, get_flt, st_set_tr,   (float *)&st_cfg.mot[MOTOR_6].travel_rev,     M6_TRAVEL_PER_REV },
     { "6","6mi",_fip, 0, st_print_mi, get_ui8, st_set_mi,   (float *)&st_cfg.mot[MOTOR_6].microsteps,     M6_MICROSTEPS },
@@ -605,6 +619,8 @@ const cfgItem_t cfgArray[] = {
     // General system parameters
     { "sys","jt", _fipn, 2, cm_print_jt,  get_flt, cm_set_jt,(float *)&cm.junction_integration_time,JUNCTION_INTEGRATION_TIME },
     { "sys","ct", _fipnc,4, cm_print_ct,  get_flt, set_flu,  (float *)&cm.chordal_tolerance,        CHORDAL_TOLERANCE },
+    { "sys","lct",_fipnc,4, cm_print_lct, get_flt, set_flu,  (float *)&cm.coalesce_tolerance,       COALESCE_TOLERANCE },
+    { "sys","srl",_fipn, 2, cm_print_srl, get_flt, cm_set_srl,(float *)&cm.step_rate_limit,         STEP_RATE_LIMIT },
     { "sys","sl", _fipn, 0, cm_print_sl,  get_ui8, set_01,   (float *)&cm.soft_limit_enable,        SOFT_LIMIT_ENABLE },
     { "sys","lim", _fipn,0, cm_print_lim, get_ui8, set_01,   (float *)&cm.limit_enable,             HARD_LIMIT_ENABLE },
     { "sys","saf", _fipn,0, cm_print_saf, get_ui8, set_01,   (float *)&cm.safety_interlock_enable,  SAFETY_INTERLOCK_ENABLE },
@@ -642,6 +658,7 @@ const cfgItem_t cfgArray[] = {
     { "sys","ej", _fipn, 0, js_print_ej,  get_ui8, json_set_ej,(float *)&cs.comm_mode,              COMM_MODE },
     { "sys","jv", _fipn, 0, js_print_jv,  get_ui8, json_set_jv,(float *)&js.json_verbosity,         JSON_VERBOSITY },
     { "sys","qv", _fipn, 0, qr_print_qv,  get_ui8, set_0123,   (float *)&qr.queue_report_verbosity, QUEUE_REPORT_VERBOSITY },
+    { "sys","qt", _fipn, 0, qr_print_qt,  get_int, set_int,    (float *)&cm.planner_lookahead_ms,   PLANNER_LOOKAHEAD_MS },
     { "sys","sv", _fipn, 0, sr_print_sv,  get_ui8, set_012,    (float *)&sr.status_report_verbosity,STATUS_REPORT_VERBOSITY },
     { "sys","si", _fipn, 0, sr_print_si,  get_int, sr_set_si,  (float *)&sr.status_report_interval, STATUS_REPORT_INTERVAL_MS },
 
@@ -659,6 +676,7 @@ const cfgItem_t cfgArray[] = {
     { "", "qr",  _f0, 0, qr_print_qr,  qr_get,    set_nul,   (float *)&cs.null, 0 },    // get queue value - planner buffers available
     { "", "qi",  _f0, 0, qr_print_qi,  qi_get,    set_nul,   (float *)&cs.null, 0 },    // get queue value - buffers added to queue
     { "", "qo",  _f0, 0, qr_print_qo,  qo_get,    set_nul,   (float *)&cs.null, 0 },    // get queue value - buffers removed from queue
+    { "", "qq",  _f0, 0, qr_print_qq,  qq_get,    set_nul,   (float *)&cs.null, 0 },    // get queue value - motion time queued (ms)
     { "", "er",  _f0, 0, tx_print_nul, rpt_er,    set_nul,   (float *)&cs.null, 0 },    // get bogus exception report for testing
     { "", "qf",  _f0, 0, tx_print_nul, get_nul,   cm_run_qf, (float *)&cs.null, 0 },    // SET to invoke queue flush
     { "", "rx",  _f0, 0, tx_print_int, get_rx,    set_nul,   (float *)&cs.null, 0 },    // get RX buffer bytes or packets
@@ -705,6 +723,17 @@ const cfgItem_t cfgArray[] = {
 #ifdef __DIAGNOSTIC_PARAMETERS
     { "",    "clc",_f0, 0, tx_print_nul, st_clc,  st_clc, (float *)&cs.null, 0 },  // clear diagnostic step counters
     { "",   "_dam",_f0, 0, tx_print_nul, cm_dam,  cm_dam, (float *)&cs.null, 0 },  // dump active model
+    { "",   "_pbh",_f0, 0, tx_print_int, get_ui8, set_nul,(float *)&st_pre.high_water, 0 },  // prep ring high water mark
+    { "",   "_pbl",_f0, 0, tx_print_int, get_ui8, set_nul,(float *)&st_pre.low_water, 0 },   // prep ring low water mark
+#if MP_TRACE_ENABLE
+    { "",    "trd",_f0, 0, mp_trace_print_trd, mp_trace_dump_json,   set_nul, (float *)&cs.null, 0 },  // dump planner trace as JSON
+    { "",    "trb",_f0, 0, mp_trace_print_trd, mp_trace_dump_binary, set_nul, (float *)&cs.null, 0 },  // dump planner trace as hex
+    { "",    "trc",_f0, 0, tx_print_nul, mp_trace_clear, mp_trace_clear, (float *)&cs.null, 0 },      // clear planner trace
+#endif
+#if PF_ENABLE
+    { "",   "prof",_f0, 0, pf_print_prof, pf_dump,  set_nul,  (float *)&cs.null, 0 },  // dump latency profile as JSON
+    { "",    "prc",_f0, 0, tx_print_nul,  pf_clear, pf_clear, (float *)&cs.null, 0 },  // clear latency profile
+#endif
 
     { "_te","_tex",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_X], 0 }, // X target endpoint
     { "_te","_tey",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_Y], 0 },
@@ -885,17 +914,18 @@ const cfgItem_t cfgArray[] = {
     { "","ofs",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // work offset group
     { "","hom",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // axis homing state group
     { "","prb",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // probing state group
+    { "","zm", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // Z compensation grid group
     { "","pwr",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // motor power readout group
     { "","jog",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // axis jogging state group
     { "","jid",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // job ID group
-    // +8 = 53
+    // +9 = 54
     { "","he1", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // heater 1 group
     { "","he2", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // heater 2 group
     { "","he3", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // heater 3 group
     { "","pid1",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // PID 1 group
     { "","pid2",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // PID 2 group
     { "","pid3",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // PID 3 group
-    // +6 = 59
+    // +6 = 60
 
 #ifdef __USER_DATA
     { "","uda", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // user data group
@@ -927,7 +957,7 @@ const cfgItem_t cfgArray[] = {
 /***** Make sure these defines line up with any changes in the above table *****/
 
 #define NV_COUNT_UBER_GROUPS    6     // count of uber-groups, above
-#define FIXED_GROUPS            59    // count of fixed groups, excluding optional groups
+#define FIXED_GROUPS            60    // count of fixed groups, excluding optional groups
 
 #if (MOTORS >= 5)
 #define MOTOR_GROUP_5           1
@@ -39,6 +39,7 @@
 #include "temperature.h"
 #include "encoder.h"
 #include "hardware.h"
+#include "profile.h"
 #include "gpio.h"
 #include "report.h"
 #include "help.h"
@@ -131,7 +132,9 @@ void controller_request_enquiry()
 void controller_run()
 {
     while (true) {
+        PF_START(PF_MAIN);
         _controller_HSM();
+        PF_END(PF_MAIN);
     }
 }
 
@@ -201,7 +204,7 @@ static stat_t _dispatch_command()
 {
     if (cs.controller_state != CONTROLLER_PAUSED) {
         devflags_t flags = DEV_IS_BOTH;
-        if ((!mp_planner_is_full()) && (cs.bufp = xio_readline(flags, cs.linelen)) != NULL) {
+        if (mp_planner_admits_input() && (cs.bufp = xio_readline(flags, cs.linelen)) != NULL) {
             _dispatch_kernel();
         }
     }
@@ -350,7 +353,7 @@ static stat_t _sync_to_tx_buffer()
 
 static stat_t _sync_to_planner()
 {
-    if (mp_planner_is_full()) {   // allow up to N planner buffers for this line
+    if (!mp_planner_admits_input()) {   // allow up to N planner buffers or $qt of motion for this line
         return (STAT_EAGAIN);
     }
     return (STAT_OK);
@@ -35,6 +35,7 @@
 #include "planner.h"
 #include "encoder.h"
 #include "kinematics.h"
+#include "mesh.h"
 #include "gpio.h"
 #include "report.h"
 #include "util.h"
@@ -72,6 +73,7 @@ static struct hmHomingSingleton hm;
 /**** NOTE: global prototypes and other .h info is located in canonical_machine.h ****/
 
 static stat_t _set_homing_func(stat_t (*func)(int8_t axis));
+static stat_t _homing_mesh_off(int8_t axis);
 static stat_t _homing_axis_start(int8_t axis);
 static stat_t _homing_axis_clear_init(int8_t axis);
 static stat_t _homing_axis_search(int8_t axis);
@@ -167,11 +169,13 @@ stat_t cm_homing_cycle_start(void) {
     cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);
     hm.set_coordinates = true;
 
-    // clear rotation matrix
+    // clear rotation matrix. Z compensation is cleared once the moves ahead have run
     canonical_machine_reset_rotation();
+    hm.waiting_for_motion_end = true;
+    mp_queue_command(_homing_axis_move_callback, nullptr, nullptr);
 
     hm.axis          = -1;                  // set to retrieve initial axis
-    hm.func          = _homing_axis_start;  // bind initial processing function
+    hm.func          = _homing_mesh_off;    // bind initial processing function
     cm.machine_state = MACHINE_CYCLE;
     cm.cycle_state   = CYCLE_HOMING;
     cm.homing_state  = HOMING_NOT_HOMED;
@@ -194,6 +198,20 @@ stat_t cm_homing_cycle_callback(void) {
     return (hm.func(hm.axis));  // execute the current homing move
 }
 
+/*
+ * _homing_mesh_off() - turn Z compensation off before the first homing move
+ *
+ *  mesh_set_mode() moves the runtime position, so it waits for the moves queued ahead of
+ *  the G28.2 to finish (see cm_homing_cycle_start()) rather than run at parse time.
+ */
+
+static stat_t _homing_mesh_off(int8_t axis) {
+    if (mesh.mode != MESH_OFF) {
+        mesh_set_mode(MESH_OFF);
+    }
+    return (_set_homing_func(_homing_axis_start));
+}
+
 /*
  * Homing axis moves - these execute in sequence for each axis
  *
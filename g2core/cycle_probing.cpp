@@ -31,6 +31,7 @@
 #include "text_parser.h"
 #include "canonical_machine.h"
 #include "kinematics.h"
+#include "mesh.h"
 #include "encoder.h"
 #include "spindle.h"
 #include "report.h"
@@ -305,6 +306,7 @@ static stat_t _probing_backoff() {
         // snapshot was taken by switch interrupt at the time of closure
         float contact_position[AXES];
         kn_forward_kinematics(en_get_encoder_snapshot_vector(), contact_position);
+        mesh_remove(contact_position);
 
         _probe_axis_move(contact_position, true);  // NB: feed rate is the same as the probe move
     } else {
@@ -352,6 +354,9 @@ static stat_t _probing_finish() {
     for (uint8_t axis = 0; axis < AXES; axis++) {
         cm.probe_results[0][axis] = cm_get_absolute_position(ACTIVE_MODEL, axis);
     }
+    if (cm.probe_state[0] == PROBE_SUCCEEDED) {
+        mesh_record_probe(cm.probe_results[0]);         // if the mesh is recording
+    }
 
     // If probe was successful the 'e' word == 1, otherwise e == 0 to signal an error
     char  buf[32];
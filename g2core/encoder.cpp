@@ -77,7 +77,8 @@ stat_t encoder_test_assertions() {
 void en_set_encoder_steps(uint8_t motor, float steps) { en.en[motor].encoder_steps = (int32_t)round(steps); }
 
 /*
- * en_read_encoder()
+ * en_read_encoder()       - encoder position in steps
+ * en_read_encoder_steps() - the same, as the integer count
  *
  *	The stepper ISR count steps into steps_run(). These values are accumulated to
  *	encoder_position during LOAD (HI interrupt level). The encoder position is
@@ -87,6 +88,7 @@ void en_set_encoder_steps(uint8_t motor, float steps) { en.en[motor].encoder_ste
  */
 
 float en_read_encoder(uint8_t motor) { return ((float)en.en[motor].encoder_steps); }
+int32_t en_read_encoder_steps(uint8_t motor) { return (en.en[motor].encoder_steps); }
 
 /*
  * en_take_encoder_snapshot()
@@ -98,6 +98,7 @@
 
 #define SET_ENCODER_STEP_SIGN(m, s) en.en[m].step_sign = s;
 #define INCREMENT_ENCODER(m) en.en[m].steps_run += en.en[m].step_sign;
+#define INCREMENT_ENCODER_BY(m, s) en.en[m].steps_run += en.en[m].step_sign * (int16_t)(s);  // s is 0 or 1
 #define ACCUMULATE_ENCODER(m)                     \
     en.en[m].encoder_steps += en.en[m].steps_run; \
     en.en[m].steps_run = 0;
@@ -129,6 +130,7 @@ stat_t encoder_test_assertions(void);
 
 void en_set_encoder_steps(uint8_t motor, float steps);
 float en_read_encoder(uint8_t motor);
+int32_t en_read_encoder_steps(uint8_t motor);
 
 void en_take_encoder_snapshot();
 float en_get_encoder_snapshot_steps(uint8_t motor);
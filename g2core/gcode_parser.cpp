@@ -651,7 +651,7 @@ static stat_t _execute_gcode_block(char *active_comment)
     //--> cutter length compensation goes here
     EXEC_FUNC(cm_set_coord_system, coord_system);           // G54, G55, G56, G57, G58, G59
 //    EXEC_FUNC(cm_set_path_control, path_control);         // G61, G61.1, G64
-    if(cm.gf.path_control) { status = cm_set_path_control(MODEL, cm.gn.path_control); }
+    if(cm.gf.path_control) { ritorno(cm_set_path_control(MODEL, cm.gn.path_control, cm.gn.parameter, cm.gf.parameter)); }
 
     EXEC_FUNC(cm_set_distance_mode, distance_mode);         // G90, G91
     EXEC_FUNC(cm_set_arc_distance_mode, arc_distance_mode); // G90.1, G91.1
@@ -1,5 +1,5 @@
 /*
- * kinematics.cpp - inverse kinematics routines
+ * kinematics.cpp - inverse and forward kinematics
  * This file is part of the g2core project
  *
  * Copyright (c) 2010 - 2016 Alden S. Hart, Jr.
@@ -32,131 +32,291 @@
 #include "kinematics.h"
 #include "util.h"
 
-static void _inverse_kinematics(const float travel[], float joint[]);
-
 /*
- * kn_kinematics() - wrapper routine for inverse kinematics
+ * Motor table and joint terms
  *
- *	Calls kinematics function(s).
- *	Performs axis mapping & conversion of length units to steps (and deals with inhibited axes)
+ *  kn_inverse_kinematics() maps joints to motors through a flat table, one entry per motor,
+ *  so the exec doesn't search the motor map for every axis on every segment. A motor with
+ *  no axis, or whose axis is inhibited, has axis -1 and its steps are left as they were.
+ *  The table starts zeroed - all motors on X with no steps per unit - until the config
+ *  loads and the setters build it.
  *
- *	The reason steps are returned as floats (as opposed to, say, uint32_t) is to accommodate
- *	fractional DDA steps. The DDA deals with fractional step values as fixed-point binary in
- *	order to get the smoothest possible operation. Steps are passed to the move prep routine
- *	as floats and converted to fixed-point binary during queue loading. See stepper.c for details.
+ *  kn_forward_kinematics() goes the other way through a list of joint terms. Each axis
+ *  takes its finest resolution motor, or the average of the motors that share the finest
+ *  resolution (a gantry), so a term is a motor, its axis and its units per step already
+ *  weighted for the average. Inhibited axes and axes with no motor have no terms and read 0.
  */
 
-void kn_inverse_kinematics(const float travel[], float steps[]) {
-    float joint[AXES];
+typedef struct knMotor {
+    int8_t axis;                    // joint that drives the motor, -1 for none
+    float steps_per_unit;           // copy of st_cfg.mot[].steps_per_unit
+} knMotor_t;
 
-    _inverse_kinematics(travel, joint);  // insert inverse kinematics transformations here
-
-// We'll time-test each and see if unrolling is worth it.
-#if 0
-    // Map motors to axes and convert length units to steps
-    // Most of the conversion math has already been done in during config in steps_per_unit()
-    // which takes axis travel, step angle and microsteps into account.
-    for (uint8_t axis=0; axis<AXES; axis++) {
-        if (cm.a[axis].axis_mode == AXIS_INHIBITED) { joint[axis] = 0;}
-        if (st_cfg.mot[MOTOR_1].motor_map == axis) {
-            steps[MOTOR_1] = joint[axis] * st_cfg.mot[MOTOR_1].steps_per_unit;
-        }
-        if (st_cfg.mot[MOTOR_2].motor_map == axis) {
-            steps[MOTOR_2] = joint[axis] * st_cfg.mot[MOTOR_2].steps_per_unit;
-        }
-        if (st_cfg.mot[MOTOR_3].motor_map == axis) {
-            steps[MOTOR_3] = joint[axis] * st_cfg.mot[MOTOR_3].steps_per_unit;
-        }
-        if (st_cfg.mot[MOTOR_4].motor_map == axis) {
-            steps[MOTOR_4] = joint[axis] * st_cfg.mot[MOTOR_4].steps_per_unit;
-        }
-#if (MOTORS >= 5)
-        if (st_cfg.mot[MOTOR_5].motor_map == axis) {
-            steps[MOTOR_5] = joint[axis] * st_cfg.mot[MOTOR_5].steps_per_unit;
-        }
-#endif
-#if (MOTORS >= 6)
-        if (st_cfg.mot[MOTOR_6].motor_map == axis) {
-            steps[MOTOR_6] = joint[axis] * st_cfg.mot[MOTOR_6].steps_per_unit;
+static knMotor_t kn_motor[MOTORS];
+
+typedef struct knJointTerm {
+    uint8_t motor;
+    uint8_t axis;
+    float units_per_step;           // weighted when motors are averaged
+} knJointTerm_t;
+
+static knJointTerm_t kn_joint_term[MOTORS];     // a motor is in at most one term
+static uint8_t kn_joint_terms;
+
+/*
+ * kn_config_changed() - rebuild the motor table and the joint terms
+ *
+ *  Call after anything that changes the motor map, a motor's steps per unit or an axis
+ *  mode ($1ma, $1su and the $1sa, $1tr, $1mi it's computed from, $xam).
+ */
+
+void kn_config_changed()
+{
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        uint8_t axis = st_cfg.mot[motor].motor_map;
+        if ((axis < AXES) && (cm.a[axis].axis_mode != AXIS_INHIBITED)) {
+            kn_motor[motor].axis = axis;
+            kn_motor[motor].steps_per_unit = st_cfg.mot[motor].steps_per_unit;
+        } else {
+            kn_motor[motor].axis = -1;
+            kn_motor[motor].steps_per_unit = 0;
         }
-#endif
     }
 
-#else
-
+    kn_joint_terms = 0;
     for (uint8_t axis = 0; axis < AXES; axis++) {
         if (cm.a[axis].axis_mode == AXIS_INHIBITED) {
-            joint[axis] = 0;
             continue;
         }
+        uint8_t first = kn_joint_terms;
+        float best_steps_per_unit = -1.0;
         for (uint8_t motor = 0; motor < MOTORS; motor++) {
-            if (st_cfg.mot[motor].motor_map == axis) {
-                steps[motor] = joint[axis] * st_cfg.mot[motor].steps_per_unit;
+            if (st_cfg.mot[motor].motor_map != axis) {
+                continue;
+            }
+            float weight;
+            if (best_steps_per_unit < st_cfg.mot[motor].steps_per_unit) {         // a better resolution replaces
+                best_steps_per_unit = st_cfg.mot[motor].steps_per_unit;
+                kn_joint_terms = first;
+                weight = 1.0;
+            } else if (fp_EQ(best_steps_per_unit, st_cfg.mot[motor].steps_per_unit)) {   // the same is averaged in
+                for (uint8_t t = first; t < kn_joint_terms; t++) {
+                    kn_joint_term[t].units_per_step *= 0.5;
+                }
+                weight = 0.5;
+            } else {
+                continue;
             }
+            kn_joint_term[kn_joint_terms].motor = motor;
+            kn_joint_term[kn_joint_terms].axis = axis;
+            kn_joint_term[kn_joint_terms].units_per_step = st_cfg.mot[motor].units_per_step * weight;
+            kn_joint_terms++;
         }
     }
-#endif
 }
 
 /*
- * _inverse_kinematics() - inverse kinematics - example is for a cartesian machine
+ * kn_inverse_kinematics() - axis travel to motor steps
  *
- *	You can glue in inverse kinematics here, but be aware of time budget constraints.
- *	This function is run during the _exec() portion of the cycle and will therefore
- *	be run once per interpolation segment. The total time for the segment load,
- *	including the inverse kinematics transformation cannot exceed the segment time,
- *	and ideally should be no more than 25-50% of the segment time. Currently segments
- *	run every 1.5 ms, but this might be lowered. To profile this time look at the
- *	time it takes to complete the mp_exec_move() function.
+ *	Runs the inverse kinematics, then maps joints to motors and converts length units
+ *	to steps with the motor table (which deals with inhibited axes).
  *
- *	Note: the compiler will  inline trivial functions (like memcpy) so there is no
- *	size or performance penalty for breaking this out
+ *	The reason steps are returned as floats (as opposed to, say, uint32_t) is to accommodate
+ *	fractional DDA steps. The DDA deals with fractional step values as fixed-point binary in
+ *	order to get the smoothest possible operation. Steps are passed to the move prep routine
+ *	as floats and converted to fixed-point binary during queue loading. See stepper.c for details.
  */
-static void _inverse_kinematics(const float travel[], float joint[]) {
-    memcpy(joint, travel, sizeof(float) * AXES);  // just do a memcpy for Cartesian machines
 
-    //	for (uint8_t i=0; i<AXES; i++) {
-    //		joint[i] = travel[i];
-    //	}
+void kn_inverse_kinematics(const float travel[], float steps[]) {
+    float joint[AXES];
+
+    knModel::inverse(travel, joint);  // the model selected in kinematics.h
+
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        const knMotor_t *m = &kn_motor[motor];
+        if (m->axis >= 0) {
+            steps[motor] = joint[m->axis] * m->steps_per_unit;
+        }
+    }
 }
 
 /*
- * kn_forward_kinematics() - forward kinematics for a cartesian machine
- *
- * This is designed for PRECISION, not PERFORMANCE!
- *
- * This function is NOT to be used where high-speed is important. If that becomes the case,
- * there are many opportunities for caching and optimization for performance here.
+ * kn_motor_steps_max() - most steps any one motor takes for a straight move
  *
+ *  travel[] is the move's length on each axis. A linear model maps a move to joint moves
+ *  as it maps positions to joints, so the motors' steps come from the motor table as they
+ *  do in kn_inverse_kinematics(). The models that aren't linear don't have it.
  */
 
-void kn_forward_kinematics(const float steps[], float travel[]) {
-    float best_steps_per_unit[AXES];
+#if (KINEMATICS_LINEAR)
+float kn_motor_steps_max(const float travel[])
+{
+    float joint[AXES];
+    float steps = 0;
 
-    // Setup
-    for (uint8_t axis = 0; axis < AXES; axis++) {
-        travel[axis]              = 0.0;
-        best_steps_per_unit[axis] = -1.0;
+    knModel::inverse(travel, joint);
+    for (uint8_t motor = 0; motor < MOTORS; motor++) {
+        const knMotor_t *m = &kn_motor[motor];
+        if (m->axis >= 0) {
+            steps = max(steps, fabs(joint[m->axis] * m->steps_per_unit));
+        }
     }
+    return (steps);
+}
+#endif
 
-    // Scan through each axis, and then through each motor
-    for (uint8_t axis = 0; axis < AXES; axis++) {
-        if (cm.a[axis].axis_mode == AXIS_INHIBITED) {
-            travel[axis] = 0.0;
-            continue;
+/*
+ * kn_forward_kinematics()       - motor steps to axis travel
+ * kn_forward_kinematics_batch() - the same for count step vectors, packed MOTORS and AXES apart
+ *
+ *  Motors are mapped back to joints with the joint terms, then the selected model's
+ *  forward() makes axis travel.
+ */
+
+void kn_forward_kinematics(const float steps[], float travel[])
+{
+    kn_forward_kinematics_batch(steps, travel, 1);
+}
+
+void kn_forward_kinematics_batch(const float steps[], float travel[], const uint16_t count)
+{
+    float joint[AXES];
+
+    for (uint16_t i = 0; i < count; i++, steps += MOTORS, travel += AXES) {
+        for (uint8_t axis = 0; axis < AXES; axis++) {
+            joint[axis] = 0;
         }
-        for (uint8_t motor = 0; motor < MOTORS; motor++) {
-            if (st_cfg.mot[motor].motor_map == axis) {
-                // If this motor has a better (or the only) resolution, then we use this motor's value
-                if (best_steps_per_unit[axis] < st_cfg.mot[motor].steps_per_unit) {
-                    best_steps_per_unit[axis] = st_cfg.mot[motor].steps_per_unit;
-                    travel[axis]              = steps[motor] * st_cfg.mot[motor].units_per_step;
-
-                    // If a econd motor has the same reolution for the same axis, we'll average their values
-                } else if (fp_EQ(best_steps_per_unit[axis], st_cfg.mot[motor].steps_per_unit)) {
-                    travel[axis] = (travel[axis] + (steps[motor] * st_cfg.mot[motor].units_per_step)) / 2.0;
-                }
-            }
+        for (uint8_t t = 0; t < kn_joint_terms; t++) {
+            const knJointTerm_t *term = &kn_joint_term[t];
+            joint[term->axis] += steps[term->motor] * term->units_per_step;
         }
+        knModel::forward(joint, travel);
     }
 }
+
+/*
+ * Kinematic models - see kinematics.h
+ *
+ *  The inverse() functions run once per segment in the exec interrupt (see the budget in
+ *  kinematics.h). The forward() functions are for probing and homing and aren't timed.
+ */
+
+// Cartesian - joints are the axes
+
+void knCartesian::inverse(const float travel[], float joint[])
+{
+    memcpy(joint, travel, sizeof(float) * AXES);
+}
+
+void knCartesian::forward(const float joint[], float travel[])
+{
+    memcpy(travel, joint, sizeof(float) * AXES);
+}
+
+// CoreXY and H-bot - both motors move for X or Y alone
+
+void knCoreXY::inverse(const float travel[], float joint[])
+{
+    memcpy(joint, travel, sizeof(float) * AXES);
+    joint[AXIS_X] = travel[AXIS_X] + travel[AXIS_Y];
+    joint[AXIS_Y] = travel[AXIS_X] - travel[AXIS_Y];
+}
+
+void knCoreXY::forward(const float joint[], float travel[])
+{
+    memcpy(travel, joint, sizeof(float) * AXES);
+    travel[AXIS_X] = (joint[AXIS_X] + joint[AXIS_Y]) * 0.5;
+    travel[AXIS_Y] = (joint[AXIS_X] - joint[AXIS_Y]) * 0.5;
+}
+
+// Linear delta - each carriage sits a rod's length from the effector
+
+static const float delta_rod_sq = (float)DELTA_DIAGONAL_ROD * (float)DELTA_DIAGONAL_ROD;
+static const float delta_tower_x[3] = { (float)(-0.866025404 * DELTA_RADIUS), (float)(0.866025404 * DELTA_RADIUS), 0 };
+static const float delta_tower_y[3] = { (float)(-0.5 * DELTA_RADIUS), (float)(-0.5 * DELTA_RADIUS), (float)DELTA_RADIUS };
+
+void knDelta::inverse(const float travel[], float joint[])
+{
+    memcpy(joint, travel, sizeof(float) * AXES);
+    for (uint8_t tower = 0; tower < 3; tower++) {
+        float dx = delta_tower_x[tower] - travel[AXIS_X];
+        float dy = delta_tower_y[tower] - travel[AXIS_Y];
+        float h_sq = delta_rod_sq - dx*dx - dy*dy;
+        joint[AXIS_X + tower] = travel[AXIS_Z] + ((h_sq > 0) ? sqrt(h_sq) : 0);   // out of reach: rod flat
+    }
+}
+
+/*
+ *  Trilateration: the effector is where spheres of rod length around the three carriages
+ *  meet. The frame is set up on the carriages - ex toward tower 2, ey toward tower 3 in
+ *  their plane, ez up out of it - and the lower of the two meeting points is taken.
+ */
+
+void knDelta::forward(const float joint[], float travel[])
+{
+    memcpy(travel, joint, sizeof(float) * AXES);
+    float p[3][3];
+    for (uint8_t tower = 0; tower < 3; tower++) {
+        p[tower][0] = delta_tower_x[tower];
+        p[tower][1] = delta_tower_y[tower];
+        p[tower][2] = joint[AXIS_X + tower];
+    }
+    float ex[3], ey[3], ez[3], p13[3];
+    float d = 0, i = 0, j = 0, ey_len = 0;
+    for (uint8_t k = 0; k < 3; k++) {
+        ex[k] = p[1][k] - p[0][k];
+        d += ex[k] * ex[k];
+    }
+    d = sqrt(d);
+    for (uint8_t k = 0; k < 3; k++) {
+        ex[k] /= d;
+        p13[k] = p[2][k] - p[0][k];
+        i += ex[k] * p13[k];
+    }
+    for (uint8_t k = 0; k < 3; k++) {
+        ey[k] = p13[k] - i * ex[k];
+        ey_len += ey[k] * ey[k];
+    }
+    ey_len = sqrt(ey_len);
+    for (uint8_t k = 0; k < 3; k++) {
+        ey[k] /= ey_len;
+        j += ey[k] * p13[k];
+    }
+    ez[0] = ex[1]*ey[2] - ex[2]*ey[1];
+    ez[1] = ex[2]*ey[0] - ex[0]*ey[2];
+    ez[2] = ex[0]*ey[1] - ex[1]*ey[0];
+
+    float x = d * 0.5;                                  // all three spheres have the same radius
+    float y = (i*i + j*j - 2*i*x) / (2*j);
+    float z_sq = delta_rod_sq - x*x - y*y;
+    float z = (z_sq > 0) ? sqrt(z_sq) : 0;
+    for (uint8_t k = 0; k < 3; k++) {
+        travel[AXIS_X + k] = p[0][k] + x*ex[k] + y*ey[k] - z*ez[k];
+    }
+}
+
+// SCARA - two links in the XY plane, angles in degrees
+
+void knScara::inverse(const float travel[], float joint[])
+{
+    memcpy(joint, travel, sizeof(float) * AXES);
+    const float l1 = SCARA_ARM_1;
+    const float l2 = SCARA_ARM_2;
+    float x = travel[AXIS_X] - (float)SCARA_OFFSET_X;
+    float y = travel[AXIS_Y] - (float)SCARA_OFFSET_Y;
+
+    float c2 = (x*x + y*y - l1*l1 - l2*l2) / (2 * l1 * l2);
+    c2 = min(max(c2, (float)-1.0), (float)1.0);         // out of reach: arm straight or folded
+    float s2 = SCARA_ELBOW * sqrt(1 - c2*c2);
+    joint[AXIS_X] = (atan2(y, x) - atan2(l2 * s2, l1 + l2 * c2)) * (float)RADIAN;
+    joint[AXIS_Y] = atan2(s2, c2) * (float)RADIAN;
+}
+
+void knScara::forward(const float joint[], float travel[])
+{
+    memcpy(travel, joint, sizeof(float) * AXES);
+    float shoulder = joint[AXIS_X] / (float)RADIAN;
+    float elbow = shoulder + joint[AXIS_Y] / (float)RADIAN;
+    travel[AXIS_X] = (float)SCARA_OFFSET_X + SCARA_ARM_1 * cos(shoulder) + SCARA_ARM_2 * cos(elbow);
+    travel[AXIS_Y] = (float)SCARA_OFFSET_Y + SCARA_ARM_1 * sin(shoulder) + SCARA_ARM_2 * sin(elbow);
+}
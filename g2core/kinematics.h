@@ -1,5 +1,5 @@
 /*
- * kinematics.h - inverse kinematics routines
+ * kinematics.h - inverse and forward kinematics
  * This file is part of the g2core project
  *
  * Copyright (c) 2013 - 2016 Alden S. Hart, Jr.
@@ -25,14 +25,127 @@
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+/*
+ *  Kinematics are picked at compile time with KINEMATICS in the settings file. Each model
+ *  is a policy class with an inverse() from axis travel to joints and a matching forward().
+ *  kn_inverse_kinematics() runs the selected inverse() once per segment in the exec
+ *  interrupt, then maps joints to motors with the motor map and steps_per_unit, so a joint
+ *  is whatever the motors on that "axis" move: a carriage height for a delta, an angle in
+ *  degrees for a SCARA. Axes a model doesn't use (Z for CoreXY and SCARA, and A, B, C for
+ *  all of them) pass through unchanged.
+ *
+ *  The planner still plans in Cartesian space. Velocity and jerk are per axis, not per
+ *  joint, and the DDA runs each segment as a straight line in joint space, so the path
+ *  between segment ends is only as close as the segments are short. Homing still moves one
+ *  axis at a time. The step rate limit ($srl) is per motor, and only the linear models
+ *  (KINEMATICS_LINEAR) can keep it: their motors run at a steady share of a straight move,
+ *  where a delta's or a SCARA's speed up and slow down along it.
+ *
+ *  Inverse kinematics may take at most KINEMATICS_BUDGET_PCT of a nominal segment. The sim
+ *  board checks every model against it, and their round trip accuracy, with
+ *  g2core.elf --kinematics N (see sim_bench.h). On a board the exec stage of $prof includes it.
+ */
+
 #ifndef KINEMATICS_H_ONCE
 #define KINEMATICS_H_ONCE
 
+#include "g2core.h"
+#include "settings.h"
+
+#define KINEMATICS_CARTESIAN    0       // joints are the axes
+#define KINEMATICS_COREXY       1       // A = X+Y, B = X-Y on the X and Y motors. Z passes through
+#define KINEMATICS_HBOT         KINEMATICS_COREXY   // an H-bot differs in the belts, not the math
+#define KINEMATICS_DELTA        2       // linear delta - the X, Y and Z motors drive towers 1, 2 and 3
+#define KINEMATICS_SCARA        3       // two link arm - the X and Y motors turn the shoulder and elbow
+
+#ifndef KINEMATICS
+#define KINEMATICS              KINEMATICS_CARTESIAN
+#endif
+
+#define KINEMATICS_LINEAR       ((KINEMATICS == KINEMATICS_CARTESIAN) || (KINEMATICS == KINEMATICS_COREXY))
+
+#define KINEMATICS_BUDGET_PCT   10      // most of a nominal segment the inverse kinematics may take
+
+// Linear delta. Towers stand at 210, 330 and 90 degrees around the Z axis, and X=Y=0 is
+// the center of the bed. A joint is its carriage's height above the effector's Z.
+#ifndef DELTA_DIAGONAL_ROD
+#define DELTA_DIAGONAL_ROD      250.0   // mm, pivot to pivot length of the diagonal rods
+#endif
+#ifndef DELTA_RADIUS
+#define DELTA_RADIUS            124.0   // mm, horizontal distance from effector pivots to carriage pivots at X=Y=0
+#endif
+
+// SCARA. The shoulder is at SCARA_OFFSET_X, SCARA_OFFSET_Y. Joint X is the upper arm's
+// angle from +X, joint Y the forearm's angle from the upper arm, both in degrees. Joint X
+// wraps at +/-180, and is undefined right over the shoulder, so the offsets should put
+// X=Y=0 and the whole work area to one side of it, and not behind it (-X).
+#ifndef SCARA_ARM_1
+#define SCARA_ARM_1             150.0   // mm, shoulder to elbow
+#endif
+#ifndef SCARA_ARM_2
+#define SCARA_ARM_2             150.0   // mm, elbow to tool
+#endif
+#ifndef SCARA_OFFSET_X
+#define SCARA_OFFSET_X          0.0     // mm, shoulder position in machine coordinates
+#endif
+#ifndef SCARA_OFFSET_Y
+#define SCARA_OFFSET_Y          0.0
+#endif
+#ifndef SCARA_ELBOW
+#define SCARA_ELBOW             1       // 1 bends the elbow counterclockwise, -1 clockwise
+#endif
+
+/*
+ * Kinematic models
+ *
+ *  inverse() - axis travel to joint positions. Points out of reach clamp to the nearest
+ *              reachable joint position rather than making NaNs, so soft limits are the
+ *              place to keep a machine in its envelope.
+ *  forward() - joint positions to axis travel.
+ */
+
+struct knCartesian {
+    static void inverse(const float travel[], float joint[]);
+    static void forward(const float joint[], float travel[]);
+};
+
+struct knCoreXY {
+    static void inverse(const float travel[], float joint[]);
+    static void forward(const float joint[], float travel[]);
+};
+
+struct knDelta {
+    static void inverse(const float travel[], float joint[]);
+    static void forward(const float joint[], float travel[]);
+};
+
+struct knScara {
+    static void inverse(const float travel[], float joint[]);
+    static void forward(const float joint[], float travel[]);
+};
+
+#if (KINEMATICS == KINEMATICS_CARTESIAN)
+typedef knCartesian knModel;
+#elif (KINEMATICS == KINEMATICS_COREXY)
+typedef knCoreXY knModel;
+#elif (KINEMATICS == KINEMATICS_DELTA)
+typedef knDelta knModel;
+#elif (KINEMATICS == KINEMATICS_SCARA)
+typedef knScara knModel;
+#else
+#error KINEMATICS must be one of the KINEMATICS_ models in kinematics.h
+#endif
+
 /*
  * Global Scope Functions
  */
 
+void kn_config_changed(void);
 void kn_inverse_kinematics(const float travel[], float steps[]);
 void kn_forward_kinematics(const float steps[], float travel[]);
+void kn_forward_kinematics_batch(const float steps[], float travel[], const uint16_t count);
+#if (KINEMATICS_LINEAR)
+float kn_motor_steps_max(const float travel[]);
+#endif
 
 #endif  // End of include Guard: KINEMATICS_H_ONCE
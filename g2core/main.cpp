@@ -35,6 +35,8 @@
 #include "temperature.h"
 #include "gpio.h"
 #include "pwm.h"
+#include "mesh.h"
+#include "profile.h"
 #include "xio.h"
 
 #include "util.h"
@@ -95,6 +97,7 @@ extern OutputPin<kDebug3_PinNumber> debug_pin3;
 void application_init_services(void)
 {
     hardware_init();				// system hardware setup 			- must be first
+    profile_init();                 // latency profile clock, if enabled
     persistence_init();				// set up EEPROM or other NVM		- must be second
     xio_init();						// xtended io subsystem				- must be third
 }
@@ -108,6 +111,7 @@ void application_init_machine(void)
     gpio_init();                    // inputs and outputs
     pwm_init();                     // pulse width modulation drivers
     planner_init();                 // motion planning subsystem
+    mesh_init();                    // Z compensation grid, off
     canonical_machine_init();       // canonical machine
 }
 
@@ -116,6 +120,7 @@ void application_init_startup(void)
     // start the application
     controller_init();              // should be first startup init (requires xio_init())
     config_init();					// apply the config settings from persistence
+    mp_set_steps_to_runtime_position(); // steps per unit are set now - non-Cartesian joints aren't 0 at 0
     canonical_machine_reset();
     spindle_init();                 // should be after PWM and canonical machine inits and config_init()
     spindle_reset();
@@ -0,0 +1,267 @@
+/*
+ * mesh.cpp - Z compensation grid (mesh bed leveling)
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2026 g2core contributors
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "mesh.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "text_parser.h"
+#include "util.h"
+
+meshGrid_t mesh;
+
+/*
+ * mesh_init() - start with the mesh off and the grid flat
+ *
+ *  The config sets the origin, spacing and size after this.
+ */
+
+void mesh_init()
+{
+    memset(&mesh, 0, sizeof(mesh));
+    mesh.count_x = 2;
+    mesh.count_y = 2;
+    mesh.spacing_x = 1;
+    mesh.spacing_y = 1;
+    mesh.nodes_per_mm_x = 1;
+    mesh.nodes_per_mm_y = 1;
+}
+
+/*
+ * mesh_offset() - Z to add at the X and Y of position: the grid interpolated bilinearly
+ *
+ *  Runs once per segment in the exec when the mesh is on, so it finds the cell by scaling
+ *  rather than searching. Positions off the grid are clamped to its edge.
+ */
+
+float mesh_offset(const float position[])
+{
+    float u = (position[AXIS_X] - mesh.origin_x) * mesh.nodes_per_mm_x;
+    float v = (position[AXIS_Y] - mesh.origin_y) * mesh.nodes_per_mm_y;
+    u = min(max(u, 0.0f), (float)(mesh.count_x - 1));
+    v = min(max(v, 0.0f), (float)(mesh.count_y - 1));
+
+    uint8_t i = min((uint8_t)u, (uint8_t)(mesh.count_x - 2));    // cell, so the far edge uses the last one
+    uint8_t j = min((uint8_t)v, (uint8_t)(mesh.count_y - 2));
+    u -= i;
+    v -= j;
+
+    const float *z = &mesh.z[j * mesh.count_x + i];
+    float z_0 = z[0] + (z[1] - z[0]) * u;
+    float z_1 = z[mesh.count_x] + (z[mesh.count_x + 1] - z[mesh.count_x]) * u;
+    return (z_0 + (z_1 - z_0) * v);
+}
+
+/*
+ * mesh_remove() - take the mesh back out of a position from the forward kinematics
+ */
+
+void mesh_remove(float position[])
+{
+    if (mesh.mode == MESH_ON) {
+        position[AXIS_Z] -= mesh_offset(position);
+    }
+}
+
+/*
+ * mesh_record_probe() - store a probe's Z in the node nearest it, if recording
+ */
+
+void mesh_record_probe(const float position[])
+{
+    if (mesh.mode != MESH_RECORD) {
+        return;
+    }
+    float u = floor((position[AXIS_X] - mesh.origin_x) * mesh.nodes_per_mm_x + 0.5);
+    float v = floor((position[AXIS_Y] - mesh.origin_y) * mesh.nodes_per_mm_y + 0.5);
+    if ((u < 0) || (u >= mesh.count_x) || (v < 0) || (v >= mesh.count_y)) {
+        return;                                     // not on the grid
+    }
+    mesh.z[(uint16_t)v * mesh.count_x + (uint16_t)u] = position[AXIS_Z];
+}
+
+/*
+ * mesh_set_mode() - turn the mesh on or off without moving
+ *
+ *  The motors are wherever the old mode put them, so the runtime Z is moved by the
+ *  difference in offset under the tool and the steps are set from it. The machine must
+ *  be stopped.
+ */
+
+void mesh_set_mode(const uint8_t mode)
+{
+    float position[AXES];
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        position[axis] = mp_get_runtime_absolute_position(axis);
+    }
+    float offset = (mesh.mode == MESH_ON) ? mesh_offset(position) : 0;
+    mesh.mode = mode;
+    if (mode == MESH_ON) {
+        offset -= mesh_offset(position);
+    }
+    cm_set_position(AXIS_Z, position[AXIS_Z] + offset);
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * mesh_set_zme() - set the mode, with the machine stopped
+ * mesh_set_org() - set the X or Y of node 0
+ * mesh_set_spc() - set the X or Y spacing
+ * mesh_set_cnt() - set the nodes in X or Y, which clears the grid
+ * mesh_set_zmi() - select the node for $zmz
+ * mesh_get_zmz() - get the Z of that node
+ * mesh_set_zmz() - set it
+ * mesh_set_zmc() - set all nodes to 0
+ *
+ *  The grid setters are refused while the mesh is on, as the tool would jump.
+ */
+
+static stat_t _mesh_grid_unlocked(nvObj_t *nv)
+{
+    if (mesh.mode == MESH_ON) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_COMMAND_NOT_ACCEPTED);
+    }
+    return (STAT_OK);
+}
+
+stat_t mesh_set_zme(nvObj_t *nv)
+{
+    if ((nv->value < MESH_OFF) || (nv->value > MESH_RECORD)) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    if (cm_get_runtime_busy() || mp_has_runnable_buffer()) {     // moving, or moves queued
+        nv->valuetype = TYPE_NULL;
+        return (STAT_COMMAND_NOT_ACCEPTED);
+    }
+    mesh_set_mode((uint8_t)nv->value);
+    nv->valuetype = TYPE_INT;
+    return (STAT_OK);
+}
+
+stat_t mesh_set_org(nvObj_t *nv)
+{
+    stat_t status_code;
+    ritorno(_mesh_grid_unlocked(nv));
+    return (set_flu(nv));
+}
+
+stat_t mesh_set_spc(nvObj_t *nv)
+{
+    stat_t status_code;
+    ritorno(_mesh_grid_unlocked(nv));
+    if (nv->value <= 0) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    set_flu(nv);
+    mesh.nodes_per_mm_x = 1 / mesh.spacing_x;
+    mesh.nodes_per_mm_y = 1 / mesh.spacing_y;
+    return (STAT_OK);
+}
+
+stat_t mesh_set_cnt(nvObj_t *nv)
+{
+    stat_t status_code;
+    ritorno(_mesh_grid_unlocked(nv));
+    if ((nv->value < 2) || (nv->value > MESH_SIZE_MAX)) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    if (*((uint8_t *)GET_TABLE_WORD(target)) != (uint8_t)nv->value) {
+        memset(mesh.z, 0, sizeof(mesh.z));          // the rows move, so the old nodes mean nothing
+        mesh.index = 0;
+    }
+    return (set_ui8(nv));
+}
+
+stat_t mesh_set_zmi(nvObj_t *nv)
+{
+    if ((nv->value < 0) || (nv->value >= (mesh.count_x * mesh.count_y))) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    return (set_ui8(nv));
+}
+
+stat_t mesh_get_zmz(nvObj_t *nv)
+{
+    nv->value = mesh.z[mesh.index];
+    nv->precision = GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+
+stat_t mesh_set_zmz(nvObj_t *nv)
+{
+    stat_t status_code;
+    ritorno(_mesh_grid_unlocked(nv));
+    if (cm_get_units_mode(MODEL) == INCHES) {
+        nv->value *= MM_PER_INCH;
+    }
+    mesh.z[mesh.index] = nv->value;
+    nv->precision = GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+
+stat_t mesh_set_zmc(nvObj_t *nv)
+{
+    stat_t status_code;
+    ritorno(_mesh_grid_unlocked(nv));
+    memset(mesh.z, 0, sizeof(mesh.z));
+    return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char *_units() { return ((cm_get_units_mode(ACTIVE_MODEL) == INCHES) ? " in" : " mm"); }
+
+static const char fmt_zme[] = "[zme] mesh mode%25d [0=off,1=on,2=record probes]\n";
+static const char fmt_zmx[] = "[zmx] mesh origin X%21.3f%s\n";
+static const char fmt_zmy[] = "[zmy] mesh origin Y%21.3f%s\n";
+static const char fmt_zmdx[] = "[zmdx] mesh spacing X%19.3f%s\n";
+static const char fmt_zmdy[] = "[zmdy] mesh spacing Y%19.3f%s\n";
+static const char fmt_zmnx[] = "[zmnx] mesh nodes X%21d\n";
+static const char fmt_zmny[] = "[zmny] mesh nodes Y%21d\n";
+static const char fmt_zmi[] = "[zmi] mesh node%25d\n";
+static const char fmt_zmz[] = "[zmz] mesh node Z%23.3f%s\n";
+
+void mesh_print_zme(nvObj_t *nv) { text_print(nv, fmt_zme);}     // TYPE_INT
+void mesh_print_zmx(nvObj_t *nv) { text_print_flt_units(nv, fmt_zmx, _units());}
+void mesh_print_zmy(nvObj_t *nv) { text_print_flt_units(nv, fmt_zmy, _units());}
+void mesh_print_zmdx(nvObj_t *nv) { text_print_flt_units(nv, fmt_zmdx, _units());}
+void mesh_print_zmdy(nvObj_t *nv) { text_print_flt_units(nv, fmt_zmdy, _units());}
+void mesh_print_zmnx(nvObj_t *nv) { text_print(nv, fmt_zmnx);}   // TYPE_INT
+void mesh_print_zmny(nvObj_t *nv) { text_print(nv, fmt_zmny);}   // TYPE_INT
+void mesh_print_zmi(nvObj_t *nv) { text_print(nv, fmt_zmi);}     // TYPE_INT
+void mesh_print_zmz(nvObj_t *nv) { text_print_flt_units(nv, fmt_zmz, _units());}
+
+#endif // __TEXT_MODE
@@ -0,0 +1,133 @@
+/*
+ * mesh.h - Z compensation grid (mesh bed leveling)
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2026 g2core contributors
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ *  The mesh is a grid of Z heights over X and Y, for beds and fixtures that aren't flat
+ *  enough for the 3 point plane of $tram. Node (i,j) is at origin + (i * spacing_x,
+ *  j * spacing_y) in machine coordinates, and the grid is up to MESH_SIZE_MAX nodes a side.
+ *
+ *  When it's on, the exec adds the bilinear interpolation of the grid at each segment's X
+ *  and Y to its Z, just before the inverse kinematics, so the mesh never reaches the
+ *  planner or the position reports. Outside the grid the edge nodes carry on flat. A move
+ *  follows the mesh because the exec cuts it into segments and compensates each one at its
+ *  end. While the mesh is on, cruise bodies are held to the ramps' NOM_SEGMENT_USEC (0.5 mm
+ *  at 20000 mm/min) rather than MAX_SEGMENT_USEC. The Z the mesh adds is not planned, so it
+ *  isn't held to Z's velocity and jerk - keep the slopes gentle.
+ *
+ *  $zme is 0 for off, 1 for on, and 2 to record: each successful probe (G38.2...) then
+ *  stores its Z in the node nearest its X and Y. So a grid is built by setting its origin,
+ *  spacing and size, $zme=2, probing each node, then $zme=1. A host can also read and write
+ *  nodes with $zmi (node index, j * nx + i) and $zmz (its Z). Nodes aren't saved, and the
+ *  grid can't be changed while the mesh is on.
+ *
+ *  Turning the mesh on or off leaves the tool where it is and moves the reported Z by the
+ *  offset under it instead, so it is only accepted with the machine stopped. Homing turns it
+ *  off once the moves ahead of the G28.2 have run, and clears the $tram rotation.
+ */
+
+#ifndef MESH_H_ONCE
+#define MESH_H_ONCE
+
+#include "g2core.h"
+#include "config.h"
+#include "hardware.h"
+
+#define MESH_SIZE_MAX       16                  // nodes a side
+#define MESH_NODES_MAX      (MESH_SIZE_MAX * MESH_SIZE_MAX)
+
+typedef enum {
+    MESH_OFF = 0,
+    MESH_ON,                        // compensate each segment
+    MESH_RECORD                     // store probes in the grid, don't compensate
+} meshMode;
+
+typedef struct meshGrid {
+    uint8_t mode;                   // meshMode
+    uint8_t count_x;                // nodes in X and Y
+    uint8_t count_y;
+    uint8_t index;                  // node $zmz reads and writes
+    float origin_x;                 // machine position of node 0
+    float origin_y;
+    float spacing_x;                // mm between nodes
+    float spacing_y;
+    float nodes_per_mm_x;           // 1/spacing, for the exec
+    float nodes_per_mm_y;
+    float z[MESH_NODES_MAX];        // count_x nodes a row, row 0 first
+} meshGrid_t;
+
+extern meshGrid_t mesh;
+
+void mesh_init(void);
+float mesh_offset(const float position[]);
+void mesh_remove(float position[]);
+void mesh_record_probe(const float position[]);
+void mesh_set_mode(const uint8_t mode);
+
+/*
+ * mesh_apply() - returns the position to step to: travel itself with the mesh off, or
+ *                travel with the mesh added, written to compensated
+ */
+
+inline const float *mesh_apply(const float travel[], float compensated[])
+{
+    if (mesh.mode != MESH_ON) {
+        return (travel);
+    }
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        compensated[axis] = travel[axis];
+    }
+    compensated[AXIS_Z] += mesh_offset(travel);
+    return (compensated);
+}
+
+stat_t mesh_set_zme(nvObj_t *nv);
+stat_t mesh_set_org(nvObj_t *nv);
+stat_t mesh_set_spc(nvObj_t *nv);
+stat_t mesh_set_cnt(nvObj_t *nv);
+stat_t mesh_set_zmi(nvObj_t *nv);
+stat_t mesh_get_zmz(nvObj_t *nv);
+stat_t mesh_set_zmz(nvObj_t *nv);
+stat_t mesh_set_zmc(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+
+    void mesh_print_zme(nvObj_t *nv);
+    void mesh_print_zmx(nvObj_t *nv);
+    void mesh_print_zmy(nvObj_t *nv);
+    void mesh_print_zmdx(nvObj_t *nv);
+    void mesh_print_zmdy(nvObj_t *nv);
+    void mesh_print_zmnx(nvObj_t *nv);
+    void mesh_print_zmny(nvObj_t *nv);
+    void mesh_print_zmi(nvObj_t *nv);
+    void mesh_print_zmz(nvObj_t *nv);
+
+#else
+
+    #define mesh_print_zme tx_print_stub
+    #define mesh_print_zmx tx_print_stub
+    #define mesh_print_zmy tx_print_stub
+    #define mesh_print_zmdx tx_print_stub
+    #define mesh_print_zmdy tx_print_stub
+    #define mesh_print_zmnx tx_print_stub
+    #define mesh_print_zmny tx_print_stub
+    #define mesh_print_zmi tx_print_stub
+    #define mesh_print_zmz tx_print_stub
+
+#endif // __TEXT_MODE
+
+#endif // End of include guard: MESH_H_ONCE
@@ -34,6 +34,7 @@ static stat_t _compute_arc(const bool radius_f);
 static void _compute_arc_offsets_from_radius(void);
 static float _estimate_arc_time (float arc_time);
 static stat_t _test_arc_soft_limits(void);
+static bool _arc_can_run_as_block(void);
 
 /*****************************************************************************
  * Canonical Machining arc functions (arc prep for planning and runtime)
@@ -70,6 +71,9 @@ void cm_abort_arc()
  *  cm_arc_cycle_callback() is called from the controller main loop. Each time it's called
  *  it queues as many arc segments (lines) as it can before it blocks, then returns.
  *
+ *  If the arc can run as a block (see _arc_can_run_as_block()) it is queued in one go
+ *  with mp_arc() instead, and the runtime puts every segment on the circle.
+ *
  *  Parts of this routine were informed by the grbl project.
  */
 
@@ -81,6 +85,36 @@ stat_t cm_arc_callback()
     if (mp_planner_is_full()) {
         return (STAT_EAGAIN);
     }
+    if (arc.run_as_block) {
+        mpArc_t geometry;
+        geometry.center_0 = arc.center_0;
+        geometry.center_1 = arc.center_1;
+        geometry.radius = arc.radius;
+        geometry.theta_end = arc.theta + arc.angular_travel;
+        geometry.theta_per_mm = arc.angular_travel / arc.length;
+        geometry.linear_end = arc.position[arc.linear_axis] + arc.linear_travel;
+        geometry.linear_per_mm = arc.linear_travel / arc.length;
+        geometry.plane_axis_0 = arc.plane_axis_0;
+        geometry.plane_axis_1 = arc.plane_axis_1;
+        geometry.linear_axis = arc.linear_axis;
+
+        // end on the circle, as the last segment of an expanded arc does
+        arc.gm.target[arc.plane_axis_0] = arc.center_0 + sin(geometry.theta_end) * arc.radius;
+        arc.gm.target[arc.plane_axis_1] = arc.center_1 + cos(geometry.theta_end) * arc.radius;
+        arc.gm.target[arc.linear_axis] = geometry.linear_end;
+        copy_vector(arc.position, arc.gm.target);
+
+        // the rotation is the identity, so only its Z offset applies (see mp_aline())
+        arc.gm.target[AXIS_Z] += cm.rotation_matrix[AXIS_Z][3];
+        if (arc.plane_axis_1 == AXIS_Z) {
+            geometry.center_1 += cm.rotation_matrix[AXIS_Z][3];
+        } else if (arc.linear_axis == AXIS_Z) {
+            geometry.linear_end += cm.rotation_matrix[AXIS_Z][3];
+        }
+        mp_arc(&arc.gm, &geometry, arc.length);     // run the arc
+        arc.run_state = BLOCK_INACTIVE;
+        return (STAT_OK);
+    }
     arc.theta += arc.segment_theta;
     arc.gm.target[arc.plane_axis_0] = arc.center_0 + sin(arc.theta) * arc.radius;
     arc.gm.target[arc.plane_axis_1] = arc.center_1 + cos(arc.theta) * arc.radius;
@@ -100,7 +134,8 @@ stat_t cm_arc_callback()
  * cm_arc_feed() - canonical machine entry point for arcs
  *
  * Generates an arc by queuing line segments to the move buffer. The arc is
- * approximated by generating a large number of tiny, linear segments.
+ * approximated by generating a large number of tiny, linear segments - or, where
+ * possible, queued as a single arc block (see cm_arc_callback()).
  */
 
 stat_t cm_arc_feed(const float target[], const bool target_f[],     // target endpoint
@@ -337,7 +372,8 @@ static stat_t _compute_arc(const bool radius_f)
     arc.segments = floor(min(segments_for_chordal_accuracy, segments_for_minimum_time));
     arc.segments = max(arc.segments, (float)1.0);        //...but is at least 1 segment
 
-    if (arc.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+    arc.run_as_block = _arc_can_run_as_block();
+    if ((arc.gm.feed_rate_mode == INVERSE_TIME_MODE) && !arc.run_as_block) {
         arc.gm.feed_rate /= arc.segments;
     }
     // setup the rest of the arc parameters
@@ -350,6 +386,31 @@ static stat_t _compute_arc(const bool radius_f)
     return (STAT_OK);
 }
 
+/*
+ * _arc_can_run_as_block() - true if the arc can be queued as one planner block
+ *
+ *  mp_arc() takes the circle as it is in the arc plane, so the arc is expanded into lines
+ *  if the rotation matrix would tilt it. Axes outside the arc move with the first segment
+ *  of an expanded arc, so those arcs are expanded too.
+ */
+
+static bool _arc_can_run_as_block()
+{
+    if (!ARC_BLOCKS || (arc.radius < MIN_ARC_RADIUS)) {
+        return (false);
+    }
+    if (cm.rotation_class == ROTATION_AFFINE) {
+        return (false);
+    }
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        if ((axis != arc.plane_axis_0) && (axis != arc.plane_axis_1) && (axis != arc.linear_axis) &&
+            (fp_NE(arc.gm.target[axis], arc.position[axis]))) {
+            return (false);
+        }
+    }
+    return (true);
+}
+
 /*
  * _compute_arc_offsets_from_radius() - compute arc center (offset) from radius.
  *
@@ -30,6 +30,10 @@
 #define ARC_RADIUS_ERROR_MIN ((float)0.005)     // min mm where 1% rule applies
 #define ARC_RADIUS_TOLERANCE ((float)0.001)     // 0.1% radius variance test
 
+#ifndef ARC_BLOCKS                              // make BOARD=sim ARC_BLOCKS=0 overrides this
+#define ARC_BLOCKS 1                            // 1 = queue arcs as one planner block, 0 = always expand into lines
+#endif
+
 typedef struct arArcSingleton {                 // persistent planner and runtime variables
     magic_t magic_start;
     uint8_t run_state;              // runtime state machine sequence
@@ -44,6 +48,7 @@ typedef struct arArcSingleton {                 // persistent planner and runtim
     float planar_travel;            // travel in arc plane in mm
     float linear_travel;            // travel along linear axis of arc in mm
     bool  full_circle;              // True if full circle arcs specified
+    bool  run_as_block;             // True to queue the arc as one planner block (see cm_arc_callback())
     float rotations;                // number of full rotations to add (P value + sign)
 
     cmAxes plane_axis_0;            // arc plane axis 0 - e.g. X for G17
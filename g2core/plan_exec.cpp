@@ -30,7 +30,9 @@
 #include "config.h"
 #include "controller.h"
 #include "planner.h"
+#include "plan_trace.h"
 #include "kinematics.h"
+#include "mesh.h"
 #include "stepper.h"
 #include "encoder.h"
 #include "report.h"
@@ -44,7 +46,10 @@ static stat_t _exec_aline_body(mpBuf_t *bf); // passing bf so that body can exte
 static stat_t _exec_aline_tail(mpBuf_t *bf);
 static stat_t _exec_aline_segment(void);
 
-static void _init_forward_diffs(float v_0, float v_1);
+static void _init_ramp(const float v_0, const float v_1, const float length);
+static void _next_ramp(void);
+static float _body_segment_usec(void);
+static float _exec_remaining_length(void);
 
 /*************************************************************************
  * mp_plan_move() - call ramping function to plan moves ahead of the exec
@@ -69,7 +74,7 @@ stat_t mp_plan_move()
         return (STAT_NOOP);
     }
 
-    if (bf->block_type != BLOCK_TYPE_ALINE) {
+    if (!mp_is_aline_type(bf->block_type)) {
         // Nothing to see here...
 
         bf->buffer_state = MP_BUFFER_PLANNED;
@@ -96,7 +101,7 @@ stat_t mp_plan_move()
             return (STAT_NOOP);
         }
 
-        if (bf->block_type != BLOCK_TYPE_ALINE) {
+        if (!mp_is_aline_type(bf->block_type)) {
             // Nothing to see here...
 
             bf->buffer_state = MP_BUFFER_PLANNED;
@@ -115,17 +120,21 @@ stat_t mp_plan_move()
     // This is to help sync mr.p to point to the next planned mr.bf
     // mr.p is only advanced in mp_exec_aline, after mp.r = mr.p.
 
+    float block_time = bf->block_time;
+    MP_PROFILE_START(MP_PROFILE_CALCULATE_RAMPS);
     mp_calculate_ramps(block, bf, entry_velocity);
+    MP_PROFILE_END(MP_PROFILE_CALCULATE_RAMPS);
+    mp_add_block_time(bf, bf->block_time - block_time);    // the ramps replace the estimate
 
     if (block->exit_velocity > block->cruise_velocity)  {
-        __asm__("BKPT"); // exit > cruise after calculate_block
+        __BKPT(0); // exit > cruise after calculate_block
     }
     if (block->head_length < 0.00001 && block->body_length < 0.00001 && block->tail_length < 0.00001)  {
-        __asm__("BKPT"); // zero or negative length block
+        __BKPT(0); // zero or negative length block
     }
 
     bf->buffer_state = MP_BUFFER_PLANNED;
-    bf->plannable = false;
+    mp_set_unplannable(bf);
 
     // report that we planned something...
     return (STAT_OK);
@@ -148,11 +157,11 @@ stat_t mp_exec_move()
         return (STAT_NOOP);
     }
 
-    if (bf->block_type == BLOCK_TYPE_ALINE) {             // cycle auto-start for lines only
+    if (mp_is_aline_type(bf->block_type)) {               // cycle auto-start for lines and arcs only
         // first-time operations
         if (bf->buffer_state != MP_BUFFER_RUNNING) {
             if ((bf->buffer_state < MP_BUFFER_PREPPED) && (cm.motion_state == MOTION_RUN)) {
-                __asm__("BKPT");
+                __BKPT(0);
                 // rpt_exception(42, "mp_exec_move() buffer is not prepped");
                 // ^^^ CAUSES A CRASH. We can't rpt_exception from here!
                 st_prep_null();
@@ -162,11 +171,13 @@ stat_t mp_exec_move()
                 // This detects buffer starvation, but also can be a single-line "jog" or command
                 // rpt_exception(42, "mp_exec_move() next buffer is empty");
                 // ^^^ CAUSES A CRASH. We can't rpt_exception from here!
+                MP_TRACE(MP_TRACE_STARVED, bf, mp.run_time_remaining * 60000);
             }
 
             if (bf->buffer_state == MP_BUFFER_PREPPED) {
                 if (cm.motion_state == MOTION_RUN) {
-//                    __asm__("BKPT"); // we are running but don't have a block planned
+//                    __BKPT(0); // we are running but don't have a block planned
+                    MP_TRACE(MP_TRACE_UNPLANNED, bf, mp.run_time_remaining * 60000);
                 }
                 // We need to have it planned. We don't want to do this here, as it
                 // might already be happening in a lower interrupt.
@@ -180,6 +191,7 @@ stat_t mp_exec_move()
                 return (STAT_NOOP);
             }
             mp_planner_time_accounting();
+            MP_TRACE(MP_TRACE_RUN, bf, mp.run_time_remaining * 60000);
         }
 
         if (bf->nx->buffer_state == MP_BUFFER_PREPPED) {
@@ -198,6 +210,12 @@ stat_t mp_exec_move()
     if (bf->bf_func == NULL) {
         return(cm_panic(STAT_INTERNAL_ERROR, "mp_exec_move()")); // never supposed to get here
     }
+    if (mp_is_aline_type(bf->block_type)) {
+        MP_PROFILE_START(MP_PROFILE_EXEC_ALINE);
+        stat_t status = bf->bf_func(bf);
+        MP_PROFILE_END(MP_PROFILE_EXEC_ALINE);
+        return (status);
+    }
     return (bf->bf_func(bf));                             // run the move callback in the planner buffer
 }
 
@@ -284,7 +302,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         }
 
         // Start a new move by setting up the runtime singleton (mr)
-        memcpy(&mr.gm, &(bf->gm), sizeof(GCodeState_t)); // copy in the gcode model state
+        memcpy(&mr.gm, bf->gm, sizeof(GCodeState_t)); // copy in the gcode model state
         bf->block_state = BLOCK_ACTIVE;                      // note that this buffer is running -- note the planner doesn't look at block_state
         mr.block_state = BLOCK_INITIAL_ACTION;
         mr.section = SECTION_HEAD;
@@ -364,14 +382,28 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         }
 
         copy_vector(mr.unit, bf->unit);
-        copy_vector(mr.target, bf->gm.target);          // save the final target of the move
+        copy_vector(mr.target, bf->gm->target);         // save the final target of the move
         copy_vector(mr.axis_flags, bf->axis_flags);
 
         // generate the way points for position correction at section ends
-        for (uint8_t axis=0; axis<AXES; axis++) {
-            mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.r->head_length;
-            mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length);
-            mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length + mr.r->tail_length);
+        mr.block_type = bf->block_type;
+        if (mr.block_type == BLOCK_TYPE_ARC) {           // arcs put them on the circle
+            memcpy(&mr.arc, bf->arc, sizeof(mpArc_t));
+            mr.path_remaining = bf->length;
+            mr.waypoint_remaining[SECTION_HEAD] = bf->length - mr.r->head_length;
+            mr.waypoint_remaining[SECTION_BODY] = mr.waypoint_remaining[SECTION_HEAD] - mr.r->body_length;
+            mr.waypoint_remaining[SECTION_TAIL] = 0;
+            for (uint8_t section=SECTION_HEAD; section<SECTION_TAIL; section++) {
+                copy_vector(mr.waypoint[section], mr.target);
+                mp_arc_position(&mr.arc, mr.waypoint_remaining[section], mr.waypoint[section]);
+            }
+            copy_vector(mr.waypoint[SECTION_TAIL], mr.target);  // the tail ends on the target
+        } else {
+            for (uint8_t axis=0; axis<AXES; axis++) {
+                mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.r->head_length;
+                mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length);
+                mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length + mr.r->tail_length);
+            }
         }
     }
 
@@ -421,7 +453,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         if (cm.hold_state == FEEDHOLD_DECEL_END) {
             mr.block_state = BLOCK_INACTIVE;                                    // invalidate mr buffer to reset the new move
             bf->block_state = BLOCK_INITIAL_ACTION;                                  // tell _exec to re-use the bf buffer
-            bf->length = get_axis_vector_length(mr.target, mr.position);// reset length
+            bf->length = _exec_remaining_length();                      // reset length
             //bf->entry_vmax = 0;                                         // set bp+0 as hold point
 
             cm.hold_state = FEEDHOLD_PENDING;
@@ -460,7 +492,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
                 mr.r->head_length = 0;
                 mr.r->body_length = 0;
 
-                float available_length = get_axis_vector_length(mr.target, mr.position);
+                float available_length = _exec_remaining_length();
                 mr.r->tail_length = mp_get_target_length(0, mr.r->cruise_velocity, bf);  // braking length
 
                 if (fp_ZERO(available_length - mr.r->tail_length)) {    // (1c) the deceleration time is almost exactly the remaining of the current move
@@ -504,6 +536,9 @@ stat_t mp_exec_aline(mpBuf_t *bf)
     if ((cm.hold_state == FEEDHOLD_DECEL_TO_ZERO) && (status == STAT_OK)) {
         cm.hold_state = FEEDHOLD_DECEL_END;
         bf->block_state = BLOCK_INITIAL_ACTION;                      // reset bf so it can restart the rest of the move
+        if (mr.block_type == BLOCK_TYPE_ARC) {
+            bf->length = _exec_remaining_length();                  // an arc counts its path, and restarting resets the count
+        }
     }
 
     // There are 4 things that can happen here depending on return conditions:
@@ -520,7 +555,6 @@ stat_t mp_exec_aline(mpBuf_t *bf)
     } else {
         mr.block_state = BLOCK_INACTIVE;                        // invalidate mr buffer (reset)
         mr.section_state = SECTION_OFF;
-        mp.run_time_remaining = 0.0;                    // it's done, so time goes to zero
 
         mr.entry_velocity     = mr.r->exit_velocity;     // feed the old exit into the entry.
 
@@ -537,6 +571,20 @@ stat_t mp_exec_aline(mpBuf_t *bf)
     return (status);
 }
 
+/*
+ * _exec_remaining_length() - path length left in the running block
+ *
+ *  Lines measure it to the target, arcs keep count of it along the circle.
+ */
+
+static float _exec_remaining_length()
+{
+    if (mr.block_type == BLOCK_TYPE_ARC) {
+        return (max(mr.path_remaining, (float)0));
+    }
+    return (get_axis_vector_length(mr.target, mr.position));
+}
+
 /*
  * mp_exit_hold_state() - end a feedhold
  *
@@ -660,8 +708,13 @@ void mp_exit_hold_state()
  *  Note that with our current control points, D and E are actually 0.
  */
 
+/*
+ * mp_ramp_init_float() - start a ramp from v_0 to v_1 in the given number of segments
+ * mp_ramp_next_float() - step the ramp to the next segment
+ */
+
 // Total time: 147us
-static void _init_forward_diffs(const float v_0, const float v_1)
+void mp_ramp_init_float(mpSegmentRamp_t *ramp, const float v_0, const float v_1, const float segments)
 {
     // Times from *here*
 /* Full formulation:
@@ -691,7 +744,7 @@ static void _init_forward_diffs(const float v_0, const float v_1)
     // F = Vi
 
 
-    const float h   = 1/(mr.segments);
+    const float h   = 1/(segments);
     const float h_2 = h   * h;
     const float h_3 = h_2 * h;
     const float h_4 = h_3 * h;
@@ -713,11 +766,11 @@ static void _init_forward_diffs(const float v_0, const float v_1)
      *  F_1 =     120 A h^5
      */
 
-    mr.forward_diff_5 = const1*Ah_5 +  5.0*Bh_4 + const2*Ch_3;
-    mr.forward_diff_4 = const3*Ah_5 + 29.0*Bh_4 +    9.0*Ch_3;
-    mr.forward_diff_3 =  255.0*Ah_5 + 48.0*Bh_4 +    6.0*Ch_3;
-    mr.forward_diff_2 =  300.0*Ah_5 + 24.0*Bh_4;
-    mr.forward_diff_1 =  120.0*Ah_5;
+    ramp->forward_diff_5 = const1*Ah_5 +  5.0*Bh_4 + const2*Ch_3;
+    ramp->forward_diff_4 = const3*Ah_5 + 29.0*Bh_4 +    9.0*Ch_3;
+    ramp->forward_diff_3 =  255.0*Ah_5 + 48.0*Bh_4 +    6.0*Ch_3;
+    ramp->forward_diff_2 =  300.0*Ah_5 + 24.0*Bh_4;
+    ramp->forward_diff_1 =  120.0*Ah_5;
 
     // Calculate the initial velocity by calculating V(h/2)
     const float half_h   = h * 0.5; // h/2
@@ -729,7 +782,132 @@ static void _init_forward_diffs(const float v_0, const float v_1)
     const float half_Bh_4 = B * half_h_4;
     const float half_Ah_5 = A * half_h_5;
 
-    mr.segment_velocity = half_Ah_5 + half_Bh_4 + half_Ch_3 + v_0;
+    ramp->velocity = half_Ah_5 + half_Bh_4 + half_Ch_3 + v_0;
+}
+
+void mp_ramp_next_float(mpSegmentRamp_t *ramp)
+{
+    ramp->velocity += ramp->forward_diff_5;
+    ramp->forward_diff_5 += ramp->forward_diff_4;
+    ramp->forward_diff_4 += ramp->forward_diff_3;
+    ramp->forward_diff_3 += ramp->forward_diff_2;
+    ramp->forward_diff_2 += ramp->forward_diff_1;
+}
+
+/*
+ * mp_ramp_init_fixed() - start a ramp from v_0 to v_1, false if it has too many segments
+ * mp_ramp_next_fixed() - step the ramp to the next segment
+ *
+ *  The fixed point interpolator steps through the position curve instead of the velocity
+ *  curve, using integers so no rounding error accumulates. Integrating the velocity curve
+ *  above, the distance covered after k of n segments of a ramp of time T is
+ *
+ *        d(k) = v_0 * T * k/n + (v_1 - v_0) * T/2 * u^4 (5 - 6u + 2u^2)     with u = k/n
+ *
+ *  Multiplying the second term by n^6 makes it an integer polynomial of degree 6 in k:
+ *
+ *        R(k) = k^4 (5n^2 - 6kn + 2k^2)        R(0) = 0, R(n) = n^6
+ *
+ *  Its forward differences are exact in 64 bits as long as n^6 fits, which limits these ramps
+ *  to FIXED_RAMP_SEGMENTS_MAX segments (about 2 seconds). Each segment then costs six 64 bit
+ *  adds. The segment's velocity is its length over its time, and the distance from the start
+ *  of the section is computed from R(k) afresh, so each segment ends exactly on the curve
+ *  to float precision and the section lands on the waypoint. A constant velocity (a body)
+ *  has no R term and no length limit.
+ */
+
+bool mp_ramp_init_fixed(mpSegmentRamp_t *ramp, const float v_0, const float v_1, const float segment_time, const uint32_t segments)
+{
+    bool constant = (v_0 == v_1);
+    if ((segments > FIXED_RAMP_SEGMENTS_MAX) && !constant) {
+        return (false);
+    }
+    ramp->fixed = true;
+    ramp->segment = 0;
+    ramp->position = 0;
+    ramp->entry_velocity = v_0;
+    ramp->step_length = v_0 * segment_time;
+    memset(ramp->diff, 0, sizeof(ramp->diff));
+
+    if (constant) {
+        ramp->ramp_length = 0;
+        ramp->ramp_velocity = 0;
+    } else {
+        const int64_t n = segments;
+        const int64_t n_5 = n * n * n * n * n;
+        int64_t r[7];                                   // R(0) - R(6), then the difference table at k = 0
+        for (int64_t k = 0; k < 7; k++) {
+            r[k] = k * k * k * k * (5 * n * n - 6 * k * n + 2 * k * k);
+        }
+        for (uint8_t level = 1; level < 7; level++) {
+            for (uint8_t k = 6; k >= level; k--) {
+                r[k] -= r[k-1];
+            }
+        }
+        for (uint8_t level = 0; level < 6; level++) {
+            ramp->diff[level] = r[level+1];
+        }
+        ramp->ramp_velocity = (v_1 - v_0) / (2 * (float)n_5);
+        ramp->ramp_length = ramp->ramp_velocity * segment_time;
+    }
+    mp_ramp_next_fixed(ramp);                           // set up the first segment
+    return (true);
+}
+
+void mp_ramp_next_fixed(mpSegmentRamp_t *ramp)
+{
+    const int64_t delta = ramp->diff[0];                // R(k+1) - R(k)
+    ramp->position += delta;
+    ramp->diff[0] += ramp->diff[1];
+    ramp->diff[1] += ramp->diff[2];
+    ramp->diff[2] += ramp->diff[3];
+    ramp->diff[3] += ramp->diff[4];
+    ramp->diff[4] += ramp->diff[5];
+    ramp->segment++;
+
+    ramp->velocity = ramp->entry_velocity + ramp->ramp_velocity * (float)delta;
+    ramp->distance = ramp->step_length * ramp->segment + ramp->ramp_length * (float)ramp->position;
+}
+
+/*
+ * _init_ramp() - set up the interpolator for a head, body or tail
+ * _next_ramp() - advance it to the next segment
+ *
+ *  SEGMENT_INTERPOLATOR selects the interpolator. The fixed point one hands ramps with
+ *  more than FIXED_RAMP_SEGMENTS_MAX segments to the float one.
+ */
+
+static void _init_ramp(const float v_0, const float v_1, const float length)
+{
+#if (SEGMENT_INTERPOLATOR == SEGMENT_INTERPOLATOR_FIXED)
+    copy_vector(mr.section_start, mr.position);
+    mr.section_path_start = mr.path_remaining;
+    if (mp_ramp_init_fixed(&mr.ramp, v_0, v_1, mr.segment_time, mr.segment_count)) {
+        mr.segment_velocity = mr.ramp.velocity;
+        return;
+    }
+    mr.ramp.fixed = false;
+#endif
+    if (mr.segment_count == 1) {
+        // We will only have one segment, simply average the velocities
+        mr.segment_velocity = length / mr.segment_time;
+    } else {
+        mp_ramp_init_float(&mr.ramp, v_0, v_1, mr.segments); // <-- sets inital segment_velocity
+        mr.segment_velocity = mr.ramp.velocity;
+    }
+}
+
+static void _next_ramp()
+{
+#if (SEGMENT_INTERPOLATOR == SEGMENT_INTERPOLATOR_FIXED)
+    if (mr.ramp.fixed) {
+        mp_ramp_next_fixed(&mr.ramp);
+        mr.segment_velocity = mr.ramp.velocity;
+        return;
+    }
+#endif
+    mp_ramp_next_float(&mr.ramp);
+    mr.segment_velocity = mr.ramp.velocity;
 }
 
 /*********************************************************************************************
@@ -738,9 +916,7 @@ static void _init_forward_diffs(const float v_0, const float v_1)
 
 static stat_t _exec_aline_head(mpBuf_t *bf)
 {
-    bool first_pass = false;
     if (mr.section_state == SECTION_NEW) {                          // INITIALIZATION
-        first_pass = true;
         if (fp_ZERO(mr.r->head_length)) {
             mr.section = SECTION_BODY;
             return(_exec_aline_body(bf));                            // skip ahead to the body generator
@@ -748,13 +924,7 @@ static stat_t _exec_aline_head(mpBuf_t *bf)
         mr.segments = ceil(uSec(mr.r->head_time) / NOM_SEGMENT_USEC);// # of segments for the section
         mr.segment_count = (uint32_t)mr.segments;
         mr.segment_time = mr.r->head_time / mr.segments;             // time to advance for each segment
-
-        if (mr.segment_count == 1) {
-            // We will only have one segment, simply average the velocities
-            mr.segment_velocity = mr.r->head_length / mr.segment_time;
-        } else {
-            _init_forward_diffs(mr.entry_velocity, mr.r->cruise_velocity); // <-- sets inital segment_velocity
-        }
+        _init_ramp(mr.entry_velocity, mr.r->cruise_velocity, mr.r->head_length); // <-- sets inital segment_velocity
         if (mr.segment_time < MIN_SEGMENT_TIME) {
             _debug_trap("mr.segment_time < MIN_SEGMENT_TIME");
             return(STAT_OK);                                        // exit without advancing position, say we're done
@@ -762,7 +932,7 @@ static stat_t _exec_aline_head(mpBuf_t *bf)
         mr.section = SECTION_HEAD;
         mr.section_state = SECTION_RUNNING;
     } else {
-        mr.segment_velocity += mr.forward_diff_5;
+        _next_ramp();
     }
 
     if (_exec_aline_segment() == STAT_OK) {                     // set up for second half
@@ -772,20 +942,49 @@ static stat_t _exec_aline_head(mpBuf_t *bf)
 
         mr.section = SECTION_BODY;
         mr.section_state = SECTION_NEW;
-    } else if (!first_pass) {
-        mr.forward_diff_5 += mr.forward_diff_4;
-        mr.forward_diff_4 += mr.forward_diff_3;
-        mr.forward_diff_3 += mr.forward_diff_2;
-        mr.forward_diff_2 += mr.forward_diff_1;
     }
     return(STAT_EAGAIN);
 }
 
+/*
+ * _body_segment_usec() - segment time for a cruise body
+ *
+ *  Bodies run segments of up to MAX_SEGMENT_MS, so a long cruise takes about a third as many
+ *  exec and stepper prep passes as it would at NOM_SEGMENT_MS. An arc body's segments are
+ *  chords between points on the circle, so they are kept short enough to stay within the
+ *  chordal tolerance, as they are when plan_arc.cpp expands an arc into lines. Bodies never
+ *  use shorter segments than the ramps do.
+ *
+ *  A delta or a SCARA runs each segment as a straight line in joint space, which is a curve
+ *  in axis space (see kinematics.h), so their bodies stay at NOM_SEGMENT_USEC. The linear
+ *  models' segments are straight lines either way. So do the bodies when the mesh is on, as
+ *  each segment is only compensated at its end (see mesh.h).
+ */
+
+static float _body_segment_usec()
+{
+#if !(KINEMATICS_LINEAR)
+    return (NOM_SEGMENT_USEC);
+#endif
+    if (mesh.mode == MESH_ON) {
+        return (NOM_SEGMENT_USEC);
+    }
+    float usec = MAX_SEGMENT_USEC;
+    if ((mr.block_type == BLOCK_TYPE_ARC) && (mr.arc.radius > cm.chordal_tolerance)) {
+        float chord = sqrt(4*cm.chordal_tolerance * (2*mr.arc.radius - cm.chordal_tolerance));
+        usec = min(usec, uSec(chord / mr.r->cruise_velocity));
+    }
+    return (max(usec, NOM_SEGMENT_USEC));
+}
+
 /*********************************************************************************************
  * _exec_aline_body()
  *
  *    The body is broken into little segments even though it is a straight line so that
  *    feed holds can happen in the middle of a line with a minimum of latency
+ *
+ *    Velocity is constant in a body, so its segments can be longer than those of the ramps.
+ *    See _body_segment_usec().
  */
 static stat_t _exec_aline_body(mpBuf_t *bf)
 {
@@ -796,7 +995,7 @@ static stat_t _exec_aline_body(mpBuf_t *bf)
         }
 
         float body_time = mr.r->body_time;
-        mr.segments = ceil(uSec(body_time) / NOM_SEGMENT_USEC);
+        mr.segments = ceil(uSec(body_time) / _body_segment_usec());
         mr.segment_time = body_time / mr.segments;
         mr.segment_velocity = mr.r->cruise_velocity;
         mr.segment_count = (uint32_t)mr.segments;
@@ -804,9 +1003,16 @@ static stat_t _exec_aline_body(mpBuf_t *bf)
             _debug_trap("mr.segment_time < MIN_SEGMENT_TIME");
             return(STAT_OK);                                // exit without advancing position, say we're done
         }
+#if (SEGMENT_INTERPOLATOR == SEGMENT_INTERPOLATOR_FIXED)
+        _init_ramp(mr.segment_velocity, mr.segment_velocity, mr.r->body_length);    // measure the body from its start too
+#endif
 
         mr.section = SECTION_BODY;
         mr.section_state = SECTION_RUNNING;                 // uses PERIOD_2 so last segment detection works
+#if (SEGMENT_INTERPOLATOR == SEGMENT_INTERPOLATOR_FIXED)
+    } else {
+        _next_ramp();
+#endif
     }
     if (_exec_aline_segment() == STAT_OK) {                 // OK means this section is done
         mr.section = SECTION_TAIL;
@@ -821,9 +1027,7 @@ static stat_t _exec_aline_body(mpBuf_t *bf)
 
 static stat_t _exec_aline_tail(mpBuf_t *bf)
 {
-    bool first_pass = false;
     if (mr.section_state == SECTION_NEW) {                          // INITIALIZATION
-        first_pass = true;
 
         // Mark the block as unplannable
         bf->plannable = false;
@@ -832,12 +1036,7 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
         mr.segments = ceil(uSec(mr.r->tail_time) / NOM_SEGMENT_USEC);// # of segments for the section
         mr.segment_count = (uint32_t)mr.segments;
         mr.segment_time = mr.r->tail_time / mr.segments;             // time to advance for each segment
-
-        if (mr.segment_count == 1) {
-            mr.segment_velocity = mr.r->tail_length / mr.segment_time;
-        } else {
-            _init_forward_diffs(mr.r->cruise_velocity, mr.r->exit_velocity); // <-- sets inital segment_velocity
-        }
+        _init_ramp(mr.r->cruise_velocity, mr.r->exit_velocity, mr.r->tail_length); // <-- sets inital segment_velocity
         if (mr.segment_time < MIN_SEGMENT_TIME) {
             _debug_trap("mr.segment_time < MIN_SEGMENT_TIME");
             return(STAT_OK);                                        // exit without advancing position, say we're done
@@ -846,27 +1045,27 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
         mr.section = SECTION_TAIL;
         mr.section_state = SECTION_RUNNING;
     } else {
-        mr.segment_velocity += mr.forward_diff_5;
+        _next_ramp();
     }
 
     if (_exec_aline_segment() == STAT_OK) {
         return(STAT_OK);                                        // STAT_OK completes the move
-    } else if (!first_pass) {
-        mr.forward_diff_5 += mr.forward_diff_4;
-        mr.forward_diff_4 += mr.forward_diff_3;
-        mr.forward_diff_3 += mr.forward_diff_2;
-        mr.forward_diff_2 += mr.forward_diff_1;
     }
     return(STAT_EAGAIN);
 }
 
 /*********************************************************************************************
- * _exec_aline_segment() - segment runner helper
+ * mp_reset_step_history() - start the segment target history over from a known step position
+ * _exec_aline_segment()   - segment runner helper
  *
  * NOTES ON STEP ERROR CORRECTION:
  *
- *  The commanded_steps are the target_steps delayed by one more segment.
- *  This lines them up in time with the encoder readings so a following error can be generated
+ *  The encoder holds the steps of every line segment the DDA has finished, which is every
+ *  segment loaded before the one now running. The exec runs up to PREP_BUFFER_SIZE segments
+ *  ahead of the DDA, so the targets of the last few prepped segments are kept in a history
+ *  indexed by segment count. The commanded_steps are the target of the segment numbered
+ *  st_get_lines_loaded() - 1. This lines them up in time with the encoder readings so a
+ *  following error can be generated
  *
  *  The following_error term is positive if the encoder reading is greater than (ahead of)
  *  the commanded steps, and negative (behind) if the encoder reading is less than the
@@ -880,10 +1079,48 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
  *         -100        -90           -10        encoder is 10 steps behind commanded steps
  */
 
-static stat_t _exec_aline_segment()
+#define STEP_HISTORY_SIZE (2*PREP_BUFFER_SIZE)     // must hold PREP_BUFFER_SIZE+2 entries - power of 2
+
+#if (STEP_PREP == STEP_PREP_FIXED)
+typedef int64_t mpStepHistory_t;                        // target substeps
+static int64_t _target_substeps[MOTORS];                // mr.target_steps in substeps - what the DDA was given
+
+/*
+ * _steps_to_substeps() - convert a step position from the kinematics to substeps
+ *
+ *  The whole steps are multiplied as integers. Only the fraction goes through float, where
+ *  it is exact and its product fits the mantissa, so the result is good to a quarter substep.
+ */
+static int64_t _steps_to_substeps(const float steps)
 {
-    float travel_steps[MOTORS];
+    int32_t whole = (int32_t)floorf(steps);
+    return ((int64_t)whole * DDA_SUBSTEPS_FIXED + (int32_t)((steps - whole) * DDA_SUBSTEPS_FIXED + 0.5f));
+}
+#else
+typedef float mpStepHistory_t;                          // target steps
+#endif
+
+static mpStepHistory_t _step_history[STEP_HISTORY_SIZE][MOTORS];    // targets by segment count (masked)
+static uint32_t _lines_prepped;                         // segment count of the last target in the history
 
+void mp_reset_step_history(const float steps[])
+{
+    for (uint8_t m=0; m<MOTORS; m++) {
+#if (STEP_PREP == STEP_PREP_FIXED)
+        _target_substeps[m] = _steps_to_substeps(steps[m]);
+        _step_history[0][m] = _target_substeps[m];
+#else
+        _step_history[0][m] = steps[m];
+#endif
+    }
+    for (uint8_t i=1; i<STEP_HISTORY_SIZE; i++) {
+        memcpy(_step_history[i], _step_history[0], sizeof(_step_history[i]));
+    }
+    _lines_prepped = st_get_lines_loaded();
+}
+
+static stat_t _exec_aline_segment()
+{
     // Set target position for the segment
     // If the segment ends on a section waypoint synchronize to the head, body or tail end
     // Otherwise if not at a section waypoint compute target from segment time and velocity
@@ -891,6 +1128,21 @@ static stat_t _exec_aline_segment()
 
     if ((--mr.segment_count == 0) && (cm.motion_state != MOTION_HOLD)) {
         copy_vector(mr.gm.target, mr.waypoint[mr.section]);
+        mr.path_remaining = mr.waypoint_remaining[mr.section];
+#if (SEGMENT_INTERPOLATOR == SEGMENT_INTERPOLATOR_FIXED)
+    } else if (mr.ramp.fixed) {                             // measured from the start of the section, so nothing accumulates
+        if (mr.block_type == BLOCK_TYPE_ARC) {
+            mr.path_remaining = mr.section_path_start - mr.ramp.distance;
+            mp_arc_position(&mr.arc, mr.path_remaining, mr.gm.target);
+        } else {
+            for (uint8_t a=0; a<AXES; a++) {
+                mr.gm.target[a] = mr.section_start[a] + mr.unit[a] * mr.ramp.distance;
+            }
+        }
+#endif
+    } else if (mr.block_type == BLOCK_TYPE_ARC) {
+        mr.path_remaining -= mr.segment_velocity * mr.segment_time;
+        mp_arc_position(&mr.arc, mr.path_remaining, mr.gm.target);
     } else {
         float segment_length = mr.segment_velocity * mr.segment_time;
         // see https://en.wikipedia.org/wiki/Kahan_summation_algorithm
@@ -914,16 +1166,49 @@ static stat_t _exec_aline_segment()
     //       Other kinematics may require transforming travel distance as opposed to simply subtracting steps.
 
 
+    uint32_t lines_loaded;
+    int32_t encoder_steps[MOTORS];
+    do {                                                    // the loader may run in between - read it again
+        lines_loaded = st_get_lines_loaded();
+        for (uint8_t m=0; m<MOTORS; m++) {
+            encoder_steps[m] = en_read_encoder_steps(m);    // get current encoder position (time aligns to commanded_steps)
+        }
+    } while (lines_loaded != st_get_lines_loaded());
     for (uint8_t m=0; m<MOTORS; m++) {
-        mr.commanded_steps[m] = mr.position_steps[m];       // previous segment's position, delayed by 1 segment
+        mr.encoder_steps[m] = encoder_steps[m];
+    }
+    const mpStepHistory_t *commanded = _step_history[(lines_loaded - 1) & (STEP_HISTORY_SIZE-1)];
+
+#if (STEP_PREP == STEP_PREP_FIXED)
+    int32_t travel_substeps[MOTORS];
+    int32_t following_error[MOTORS];
+    for (uint8_t m=0; m<MOTORS; m++) {
+        mr.position_steps[m] = mr.target_steps[m];          // previous segment's target becomes position
+        int64_t error = (int64_t)encoder_steps[m] * DDA_SUBSTEPS_FIXED - commanded[m];
+        following_error[m] = (error > INT32_MAX) ? INT32_MAX : ((error < -INT32_MAX) ? -INT32_MAX : (int32_t)error);
+        mr.following_error[m] = following_error[m] * (1 / (float)DDA_SUBSTEPS_FIXED);     // for diagnostics only
+        mr.commanded_steps[m] = mr.encoder_steps[m] - mr.following_error[m];
+    }
+    float compensated[AXES];
+    kn_inverse_kinematics(mesh_apply(mr.gm.target, compensated), mr.target_steps);  // now determine the target steps...
+    for (uint8_t m=0; m<MOTORS; m++) {                      // and the distances to be traveled, exactly
+        int64_t target = _steps_to_substeps(mr.target_steps[m]);
+        travel_substeps[m] = (int32_t)(target - _target_substeps[m]);
+        _target_substeps[m] = target;
+    }
+#else
+    float travel_steps[MOTORS];
+    for (uint8_t m=0; m<MOTORS; m++) {
+        mr.commanded_steps[m] = commanded[m];               // target of the segment the DDA last finished
         mr.position_steps[m] = mr.target_steps[m];          // previous segment's target becomes position
-        mr.encoder_steps[m] = en_read_encoder(m);           // get current encoder position (time aligns to commanded_steps)
         mr.following_error[m] = mr.encoder_steps[m] - mr.commanded_steps[m];
     }
-    kn_inverse_kinematics(mr.gm.target, mr.target_steps);   // now determine the target steps...
+    float compensated[AXES];
+    kn_inverse_kinematics(mesh_apply(mr.gm.target, compensated), mr.target_steps);  // now determine the target steps...
     for (uint8_t m=0; m<MOTORS; m++) {                      // and compute the distances to be traveled
         travel_steps[m] = mr.target_steps[m] - mr.position_steps[m];
     }
+#endif
 
     // Update the mb->run_time_remaining -- we know it's missing the current segment's time before it's loaded, that's ok.
     mp.run_time_remaining -= mr.segment_time;
@@ -932,7 +1217,22 @@ static stat_t _exec_aline_segment()
     }
 
     // Call the stepper prep function
+#if (STEP_PREP == STEP_PREP_FIXED)
+    if (isinf(mr.segment_time)) {                           // never supposed to happen
+        return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE, "st_prep_line()"));
+    } else if (isnan(mr.segment_time)) {                    // never supposed to happen
+        return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_NAN, "st_prep_line()"));
+    }
+    ritorno(st_prep_line_fixed(travel_substeps, following_error, (uint32_t)(mr.segment_time * 60 * FREQUENCY_DDA * (1 << SEGMENT_TICKS_SHIFT))));
+    mpStepHistory_t *history = _step_history[++_lines_prepped & (STEP_HISTORY_SIZE-1)];
+    memcpy(history, _target_substeps, sizeof(_step_history[0]));
+#else
     ritorno(st_prep_line(travel_steps, mr.following_error, mr.segment_time));
+    mpStepHistory_t *history = _step_history[++_lines_prepped & (STEP_HISTORY_SIZE-1)];
+    for (uint8_t m=0; m<MOTORS; m++) {
+        history[m] = mr.target_steps[m];
+    }
+#endif
     copy_vector(mr.position, mr.gm.target);                 // update position from target
     if (mr.segment_count == 0) {
         return (STAT_OK);                                   // this section has run all its segments
@@ -31,7 +31,9 @@
 #include "controller.h"
 #include "canonical_machine.h"
 #include "planner.h"
+#include "plan_trace.h"
 #include "stepper.h"
+#include "kinematics.h"
 #include "report.h"
 #include "util.h"
 #include "spindle.h"
@@ -49,16 +51,23 @@ extern OutputPin<kDebug3_PinNumber> debug_pin3;
 
 // planner helper functions
 static mpBuf_t* _plan_block(mpBuf_t* bf);
+static bool _backplan_can_wait(void);
 static void _calculate_override(mpBuf_t* bf);
-static void _calculate_jerk(mpBuf_t* bf);
+static void _calculate_jerk(mpBuf_t* bf, const float unit[]);
 static void _calculate_vmaxes(mpBuf_t* bf, const float axis_length[], const float axis_square[]);
 static void _calculate_junction_vmax(mpBuf_t* bf);
+static float _line_vectors(const float target[], float axis_length[], float axis_square[], bool flags[]);
+static bool _block_can_change(mpBuf_t* bf);
+static void _reopen_block(mpBuf_t* bf);
+static void _rotate_target(const float target[], float target_rotated[]);
+static bool _coalesce_line(const GCodeState_t* gm_in, const float target_rotated[], const float axis_length[]);
+static bool _blend_corner(const GCodeState_t* gm_in, const float axis_length[], const float length);
 
 //+++++DIAGNOSTICS
 #pragma GCC optimize("O0")  // this pragma is required to force the planner to actually set these unused values
 //#pragma GCC reset_options
 static void _set_bf_diagnostics(mpBuf_t* bf) {
-    bf->linenum = bf->gm.linenum;
+    bf->linenum = bf->gm->linenum;
 //  UPDATE_BF_DIAGNOSTICS(bf);   //+++++
 }
 #pragma GCC reset_options
@@ -78,26 +87,24 @@ float mp_get_runtime_velocity(void) { return (mr.segment_velocity); }
 float mp_get_runtime_absolute_position(uint8_t axis) { return (mr.position[axis]); }
 void mp_set_runtime_work_offset(float offset[]) { copy_vector(mr.gm.work_offset, offset); }
 
-// We have to handle rotation - "rotate" by the transverse of the matrix to got "normal" coordinates
+// We have to handle rotation - take the offset back out and "rotate" by the transverse of the
+// matrix to get "normal" coordinates. Without a tilt that's just the offset.
 float mp_get_runtime_work_position(uint8_t axis) {
-    // Shorthand:
-    // target_rotated[0] = a x_1 + b x_2 + c x_3
-    // target_rotated[1] = a y_1 + b y_2 + c y_3
-    // target_rotated[2] = a z_1 + b z_2 + c z_3 + z_offset
-
-    if (axis == AXIS_X) {
-        return mr.position[0] * cm.rotation_matrix[0][0] + mr.position[1] * cm.rotation_matrix[1][0] +
-               mr.position[2] * cm.rotation_matrix[2][0] - mr.gm.work_offset[0];
-    } else if (axis == AXIS_Y) {
-        return mr.position[0] * cm.rotation_matrix[0][1] + mr.position[1] * cm.rotation_matrix[1][1] +
-               mr.position[2] * cm.rotation_matrix[2][1] - mr.gm.work_offset[1];
-    } else if (axis == AXIS_Z) {
-        return mr.position[0] * cm.rotation_matrix[0][2] + mr.position[1] * cm.rotation_matrix[1][2] +
-               mr.position[2] * cm.rotation_matrix[2][2] - cm.rotation_z_offset - mr.gm.work_offset[2];
-    } else {
+    if ((axis > AXIS_Z) || (cm.rotation_class == ROTATION_IDENTITY)) {
         // ABC, UVW, we don't rotate them
         return (mr.position[axis] - mr.gm.work_offset[axis]);
     }
+    if (cm.rotation_class == ROTATION_OFFSET) {
+        return (mr.position[axis] - cm.rotation_matrix[axis][3] - mr.gm.work_offset[axis]);
+    }
+
+    // Shorthand, with p_i = position[i] - r_i3 and r_10 being cm.rotation_matrix[1][0]:
+    // work[0] = p_0 r_00 + p_1 r_10 + p_2 r_20
+    // work[1] = p_0 r_01 + p_1 r_11 + p_2 r_21
+    // work[2] = p_0 r_02 + p_1 r_12 + p_2 r_22
+    return ((mr.position[0] - cm.rotation_matrix[0][3]) * cm.rotation_matrix[0][axis] +
+            (mr.position[1] - cm.rotation_matrix[1][3]) * cm.rotation_matrix[1][axis] +
+            (mr.position[2] - cm.rotation_matrix[2][3]) * cm.rotation_matrix[2][axis] - mr.gm.work_offset[axis]);
 }
 
 /*
@@ -134,16 +141,21 @@ bool mp_runtime_is_idle() { return (!st_runtime_isbusy()); }
  *  Note: Returning a status that is not STAT_OK means the endpoint is NOT advanced. So lines
  *        that are too short to move will accumulate and get executed once the accumulated error
  *        exceeds the minimums.
+ *
+ *  Note: If line coalescing is enabled ($lct) a feed that continues the previous one within
+ *        the tolerance extends that block instead of taking a new one. See _coalesce_line().
+ *
+ *  Note: In G64 P mode the corner with the previous feed may be replaced by a blend arc,
+ *        which is queued ahead of this line. See _blend_corner().
  */
 
 stat_t mp_aline(GCodeState_t* gm_in) 
 {
     mpBuf_t* bf;  // current move pointer
-    float target_rotated[AXES] = {0, 0, 0, 0, 0, 0};
-    float axis_square[AXES]    = {0, 0, 0, 0, 0, 0};
+    float target_rotated[AXES];
+    float axis_square[AXES];
     float axis_length[AXES];
     bool  flags[AXES];
-    float length_square = 0;
     float length;
 
     // A few notes about the rotated coordinate space:
@@ -153,41 +165,9 @@ stat_t mp_aline(GCodeState_t* gm_in)
     // These are positions POST-rotation:
     //  target_rotated (after the rotiton here, of course)
     //  mp.* (anything in mp, including mp.gm.*)
+    _rotate_target(gm_in->target, target_rotated);
 
-    // a being target[0],
-    // b being target[1],
-    // c being target[2],
-    // x_1 being cm.rotation_matrix[1][0]
-
-    // Shorthand:
-    // target_rotated[0] = a x_0 + b y_0 + c z_0
-    // target_rotated[1] = a x_1 + b y_1 + c z_1
-    // target_rotated[2] = a x_2 + b y_2 + c z_2 + z_offset
-
-    target_rotated[0] = gm_in->target[0] * cm.rotation_matrix[0][0] + gm_in->target[1] * cm.rotation_matrix[0][1] +
-                        gm_in->target[2] * cm.rotation_matrix[0][2];
-
-    target_rotated[1] = gm_in->target[0] * cm.rotation_matrix[1][0] + gm_in->target[1] * cm.rotation_matrix[1][1] +
-                        gm_in->target[2] * cm.rotation_matrix[1][2];
-
-    target_rotated[2] = gm_in->target[0] * cm.rotation_matrix[2][0] + gm_in->target[1] * cm.rotation_matrix[2][1] +
-                        gm_in->target[2] * cm.rotation_matrix[2][2] + cm.rotation_z_offset;
-
-    // copy rotation axes ABC
-    target_rotated[3] = gm_in->target[3];
-    target_rotated[4] = gm_in->target[4];
-    target_rotated[5] = gm_in->target[5];
-
-    for (uint8_t axis = 0; axis < AXES; axis++) {
-        axis_length[axis] = target_rotated[axis] - mp.position[axis];
-        if ((flags[axis] = fp_NOT_ZERO(axis_length[axis]))) {  // yes, this supposed to be = not ==
-            axis_square[axis] = square(axis_length[axis]);
-            length_square += axis_square[axis];
-        } else {
-            axis_length[axis] = 0;  // make it truly zero if it was tiny
-        }
-    }
-    length = sqrt(length_square);
+    length = _line_vectors(target_rotated, axis_length, axis_square, flags);
 
     // exit if the move has zero movement. At all.
     if (fp_ZERO(length)) {
@@ -195,13 +175,24 @@ stat_t mp_aline(GCodeState_t* gm_in)
         return (STAT_MINIMUM_LENGTH_MOVE);
     }
 
+    // merge it into the previous block if it continues that line closely enough
+    if (_coalesce_line(gm_in, target_rotated, axis_length)) {
+        copy_vector(mp.position, target_rotated);  // set the planner position
+        return (STAT_OK);
+    }
+
+    // round the corner with the previous block. The line now starts where the blend ends.
+    if (_blend_corner(gm_in, axis_length, length)) {
+        length = _line_vectors(target_rotated, axis_length, axis_square, flags);
+    }
+
     // get a cleared buffer and copy in the Gcode model state
     if ((bf = mp_get_write_buffer()) == NULL) {  // never supposed to fail
         return (cm_panic(STAT_FAILED_GET_PLANNER_BUFFER, "aline()"));
     }
-    memcpy(&bf->gm, gm_in, sizeof(GCodeState_t));
-    // Since bf->gm.target is being used all over the place, we'll make it the rotated target
-    copy_vector(bf->gm.target, target_rotated);  // copy the rotated taget in place
+    memcpy(bf->gm, gm_in, sizeof(GCodeState_t));
+    // Since bf->gm->target is being used all over the place, we'll make it the rotated target
+    copy_vector(bf->gm->target, target_rotated); // copy the rotated taget in place
 
     // setup the buffer
     bf->bf_func = mp_exec_aline;                          // register the callback to the exec function
@@ -211,16 +202,459 @@ stat_t mp_aline(GCodeState_t* gm_in)
             bf->unit[axis] = axis_length[axis] / length;  // nb: bf-> unit was cleared by mp_get_write_buffer()
         }
     }
-    _calculate_jerk(bf);                              // compute bf->jerk values
+    _calculate_jerk(bf, bf->unit);                    // compute bf->jerk values
     _calculate_vmaxes(bf, axis_length, axis_square);  // compute cruise_vmax and absolute_vmax
     _set_bf_diagnostics(bf);                          //+++++DIAGNOSTIC
 
     // Note: these next lines must remain in exact order. Position must update before committing the buffer.
-    copy_vector(mp.position, bf->gm.target);   // set the planner position
+    copy_vector(mp.position, bf->gm->target);  // set the planner position
     mp_commit_write_buffer(BLOCK_TYPE_ALINE);  // commit current block (must follow the position update)
+
+    if ((cm.coalesce_tolerance > 0) && (gm_in->motion_mode == MOTION_MODE_STRAIGHT_FEED) &&
+        (gm_in->feed_rate_mode == UNITS_PER_MINUTE_MODE)) {
+        mp.coalesce = bf;                      // the next feed may extend this block
+        mp.coalesce_deviation = 0;
+    }
+    return (STAT_OK);
+}
+
+/*
+ * _line_vectors() - per-axis travel from the planner position to target
+ *
+ *  Fills axis_length[], axis_square[] and the axis flags and returns the length of the
+ *  line. Tiny axis moves are made truly zero.
+ */
+
+static float _line_vectors(const float target[], float axis_length[], float axis_square[], bool flags[])
+{
+    float length_square = 0;
+
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        axis_length[axis] = target[axis] - mp.position[axis];
+        if ((flags[axis] = fp_NOT_ZERO(axis_length[axis]))) {  // yes, this supposed to be = not ==
+            axis_square[axis] = square(axis_length[axis]);
+            length_square += axis_square[axis];
+        } else {
+            axis_length[axis] = 0;  // make it truly zero if it was tiny
+            axis_square[axis] = 0;
+        }
+    }
+    return (sqrt(length_square));
+}
+
+/*
+ * _rotate_target() - apply the $tram matrix to a target, as cm.rotation_class allows
+ *
+ *  The offset is the 4th column of the matrix, so a tilted target takes one pass of three
+ *  multiply-adds per axis. Without $tram, which is nearly always, it's a copy.
+ *
+ *  a being target[0],
+ *  b being target[1],
+ *  c being target[2],
+ *  r_10 being cm.rotation_matrix[1][0]
+ *
+ *  Shorthand:
+ *  target_rotated[0] = a r_00 + b r_01 + c r_02 + r_03
+ *  target_rotated[1] = a r_10 + b r_11 + c r_12 + r_13
+ *  target_rotated[2] = a r_20 + b r_21 + c r_22 + r_23
+ */
+
+static void _rotate_target(const float target[], float target_rotated[])
+{
+    for (uint8_t axis = 0; axis < AXES; axis++) {       // ABC (and UVW) are not rotated
+        target_rotated[axis] = target[axis];
+    }
+    if (cm.rotation_class == ROTATION_IDENTITY) {
+        return;
+    }
+    if (cm.rotation_class == ROTATION_OFFSET) {
+        target_rotated[AXIS_Z] += cm.rotation_matrix[AXIS_Z][3];
+        return;
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        const float *row = cm.rotation_matrix[i];
+        target_rotated[i] = target[0] * row[0] + target[1] * row[1] + target[2] * row[2] + row[3];
+    }
+}
+
+/*
+ * _coalesce_line() - extend the newest block with a line that continues it
+ *
+ *  CAM output often chains many short, nearly colinear feeds. Each would cost a buffer, a
+ *  junction and at least MIN_BLOCK_TIME. If the new line shares the modal state of the
+ *  newest block and the path through their common point stays within $lct of the merged
+ *  chord the block is stretched to the new target instead. Returns true if it was merged.
+ *
+ *  The deviation is bounded over all lines merged so far: points on the old chord are no
+ *  further from the new chord than its endpoint is, so the deviations add up.
+ *
+ *  The block can only be stretched while the runtime can't reach it (see _block_can_change()).
+ *
+ *  The block takes the line number of the last line merged, so reports show the line the
+ *  move ends on.
+ */
+
+static bool _coalesce_line(const GCodeState_t* gm_in, const float target_rotated[], const float axis_length[])
+{
+    mpBuf_t* bf = mp.coalesce;
+
+    if ((bf == NULL) || (cm.coalesce_tolerance <= 0) || (bf->block_type != BLOCK_TYPE_ALINE) ||
+        !_block_can_change(bf)) {
+        return (false);
+    }
+
+    // the modal state has to match - only the target and line number may differ
+    GCodeState_t* gm = bf->gm;
+    if ((gm_in->motion_mode != MOTION_MODE_STRAIGHT_FEED) || (gm->motion_mode != MOTION_MODE_STRAIGHT_FEED) ||
+        (gm_in->feed_rate_mode != UNITS_PER_MINUTE_MODE) || (gm->feed_rate_mode != UNITS_PER_MINUTE_MODE) ||
+        (gm_in->feed_rate != gm->feed_rate) || (gm_in->path_control != gm->path_control) ||
+        (gm_in->path_control == PATH_EXACT_STOP) || (gm_in->units_mode != gm->units_mode) ||
+        (gm_in->coord_system != gm->coord_system) || (gm_in->absolute_override != gm->absolute_override) ||
+        (gm_in->tool != gm->tool) || (gm_in->tool_select != gm->tool_select) ||
+        (memcmp(gm_in->work_offset, gm->work_offset, sizeof(gm->work_offset)) != 0)) {
+        return (false);
+    }
+
+    // geometry of the merged line and deviation of the common point from it
+    float merged[AXES];
+    float merged_square[AXES];
+    float merged_length = 0;
+    float along = 0;
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        merged[axis] = (bf->unit[axis] * bf->length) + axis_length[axis];
+        merged_square[axis] = square(merged[axis]);
+        merged_length += merged_square[axis];
+        along += bf->unit[axis] * bf->length * merged[axis];
+    }
+    merged_length = sqrt(merged_length);
+    if (fp_ZERO(merged_length)) {
+        return (false);
+    }
+    along /= merged_length;                     // distance of the common point along the merged chord
+    if ((along <= 0) || (along >= merged_length)) {
+        return (false);                         // the new line turns back
+    }
+    float deviation = mp.coalesce_deviation + sqrt(max(square(bf->length) - square(along), (float)0));
+    if (deviation > cm.coalesce_tolerance) {
+        return (false);
+    }
+
+    // stretch the block
+    _reopen_block(bf);
+    copy_vector(gm->target, target_rotated);
+    gm->linenum = gm_in->linenum;
+    bf->length = merged_length;
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        if ((bf->axis_flags[axis] = fp_NOT_ZERO(merged[axis]))) {
+            bf->unit[axis] = merged[axis] / merged_length;
+        } else {
+            merged[axis] = 0;
+            merged_square[axis] = 0;
+            bf->unit[axis] = 0;
+        }
+    }
+    _calculate_jerk(bf, bf->unit);
+    _calculate_vmaxes(bf, merged, merged_square);
+    _set_bf_diagnostics(bf);
+
+    mp_add_block_time(bf, bf->block_time);
+    mp.coalesce_deviation = deviation;
+    mp.request_planning = true;
+    mp.block_timeout.set(BLOCK_TIMEOUT_MS);
+    MP_PROFILE_COALESCE();
+    return (true);
+}
+
+/*
+ * _block_can_change() - true if the newest block may still be changed by mp_aline()
+ * _reopen_block()     - take the block back from the planner before changing it
+ *
+ *  A block can only be changed while the runtime can't reach it. Unplanned and primed
+ *  blocks are never touched by the exec. A back-planned (PREPPED) block must be far enough
+ *  ahead of the run buffer that neither it nor the block before it can be forward planned
+ *  before the planner primes it again, and the block before it must still be plannable
+ *  so its exit can follow the new junction. A primed block is put back to INITIALIZING and
+ *  the planner pointer is moved back to it, so the junction and vmaxes are recomputed.
+ *
+ *  _reopen_block() also takes the block's time out of the planner time sums. The caller
+ *  adds the new block_time back once the vmaxes are recomputed.
+ */
+
+static bool _block_can_change(mpBuf_t* bf)
+{
+    if ((bf != mb.w->pv) || (bf->buffer_state == MP_BUFFER_EMPTY) || (bf->buffer_state > MP_BUFFER_PREPPED) ||
+        (cm.hold_state != FEEDHOLD_OFF) || mp.ramp_active || (cm.cycle_state != CYCLE_MACHINING)) {
+        return (false);
+    }
+    if (bf->buffer_state >= MP_BUFFER_IN_PROCESS) {
+        if ((mp.planner_state != PLANNER_PRIMING) || (mp.p != mb.w)) {
+            return (false);
+        }
+        if (bf->buffer_state == MP_BUFFER_PREPPED) {
+            if (!bf->pv->plannable) {
+                return (false);
+            }
+            mpBuf_t* r = mb.r;
+            for (uint8_t i = 0; i < 4; i++, r = r->nx) {
+                if (r == bf) {
+                    return (false);
+                }
+            }
+        }
+    }
+    return (true);
+}
+
+static void _reopen_block(mpBuf_t* bf)
+{
+    if (bf->buffer_state == MP_BUFFER_IN_PROCESS) {
+        mp.backplan_pending--;                  // it will be primed again
+    }
+    if (bf->buffer_state >= MP_BUFFER_IN_PROCESS) {
+        bf->buffer_state = MP_BUFFER_INITIALIZING;
+        mp.p = bf;
+    }
+    mp_add_block_time(bf, -bf->block_time);
+    bf->cruise_velocity = 0;
+    bf->exit_velocity = 0;
+    bf->hint = NO_HINT;
+    bf->plannable = true;
+}
+
+/*
+ * _blend_corner() - replace the corner with the previous feed by a blend arc (G64 P)
+ *
+ *  With a path tolerance set the corner between two feeds in a principal plane may be cut
+ *  by a tangent arc that stays within the tolerance of the corner point. The arc of
+ *  radius R turning through phi leaves the corner by R * (1/cos(phi/2) - 1) at its middle
+ *  and touches each line at d = R * tan(phi/2) from the corner. d is limited to half of
+ *  either line so consecutive blends don't overlap.
+ *
+ *  The arc is run through at the centripetal limit of mp_arc(), cbrt(Jm * R^2), so it is
+ *  only used if that is faster than the junction velocity the corner would get without it.
+ *  Near colinear corners are already fast and reversals can't be blended usefully. Note
+ *  that the arc holds its velocity while a plain corner only dips to the junction velocity,
+ *  so very small tolerances can cost a little time rather than save it.
+ *
+ *  The previous block is shortened to the tangent point and the arc is queued after it.
+ *  mp.position is left at the end of the arc, where the caller starts the new line.
+ *  Returns true if the corner was blended.
+ */
+
+static bool _blend_corner(const GCodeState_t* gm_in, const float axis_length[], const float length)
+{
+    mpBuf_t* bf = mb.w->pv;
+
+    if ((gm_in->path_control != PATH_CONTINUOUS) || (gm_in->path_tolerance <= 0) ||
+        (gm_in->motion_mode != MOTION_MODE_STRAIGHT_FEED) || (gm_in->feed_rate_mode != UNITS_PER_MINUTE_MODE) ||
+        (bf->block_type != BLOCK_TYPE_ALINE) || (bf->gm->path_control != PATH_CONTINUOUS) ||
+        (bf->gm->motion_mode != MOTION_MODE_STRAIGHT_FEED) || (bf->gm->feed_rate_mode != UNITS_PER_MINUTE_MODE) ||
+        (mp_get_planner_buffers() < 2) || !_block_can_change(bf)) {
+        return (false);
+    }
+    for (uint8_t axis = 0; axis < AXES; axis++) {  // the corner has to be where the block ends
+        if (fp_NE(bf->gm->target[axis], mp.position[axis])) {
+            return (false);
+        }
+    }
+
+    // both lines have to lie in one principal plane
+    uint8_t plane[2];
+    uint8_t axes = 0;
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        if (bf->axis_flags[axis] || fp_NOT_ZERO(axis_length[axis])) {
+            if ((axis > AXIS_Z) || (axes == 2)) {
+                return (false);
+            }
+            plane[axes++] = axis;
+        }
+    }
+    if (axes != 2) {
+        return (false);
+    }
+    float u1_0 = bf->unit[plane[0]];
+    float u1_1 = bf->unit[plane[1]];
+    float u2_0 = axis_length[plane[0]] / length;
+    float u2_1 = axis_length[plane[1]] / length;
+
+    float cos_phi = u1_0 * u2_0 + u1_1 * u2_1;
+    if ((cos_phi > BLEND_COLINEAR_COSINE) || (cos_phi < -BLEND_COLINEAR_COSINE)) {
+        return (false);
+    }
+    float half = acos(cos_phi) / 2;            // half the turn
+    float radius = gm_in->path_tolerance * cos(half) / (1 - cos(half));
+    float d = radius * tan(half);
+    float d_max = min(bf->length, length) / 2;
+    if (d > d_max) {
+        d = d_max;
+        radius = d / tan(half);
+    }
+    if (fp_ZERO(radius)) {
+        return (false);
+    }
+
+    // compare with the junction velocity of the plain corner
+    float feed_rate = min(gm_in->feed_rate, bf->gm->feed_rate);
+    float jerk_plane = min(cm.a[plane[0]].jerk_max, cm.a[plane[1]].jerk_max) * JERK_MULTIPLIER;
+    float blend_velocity = min3(cbrt(jerk_plane * square(radius)), feed_rate,
+                                min(cm.a[plane[0]].feedrate_max, cm.a[plane[1]].feedrate_max));
+    float blend_length = radius * half * 2;
+    float junction_velocity = feed_rate;
+    for (uint8_t i = 0; i < 2; i++) {
+        float delta = fabs((i == 0) ? (u2_0 - u1_0) : (u2_1 - u1_1));
+        if (delta > EPSILON) {
+            junction_velocity = min(junction_velocity, cm.a[plane[i]].max_junction_accel / delta);
+        }
+    }
+    if (blend_velocity <= junction_velocity) {
+        return (false);
+    }
+
+    // cut the previous line back to the first tangent point
+    float corner[AXES];
+    copy_vector(corner, mp.position);
+    _reopen_block(bf);
+    bf->length -= d;
+    float bf_length[AXES];
+    float bf_square[AXES];
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        bf->gm->target[axis] -= bf->unit[axis] * d;
+        bf_length[axis] = bf->unit[axis] * bf->length;
+        bf_square[axis] = square(bf_length[axis]);
+    }
+    _calculate_vmaxes(bf, bf_length, bf_square);
+    _set_bf_diagnostics(bf);
+    mp_add_block_time(bf, bf->block_time);
+    copy_vector(mp.position, bf->gm->target);
+
+    // the center is R to the inside of the turn from the tangent point
+    float cross = u1_0 * u2_1 - u1_1 * u2_0;   // > 0 turns counterclockwise in the plane
+    float n_0 = u2_0 - u1_0 * cos_phi;
+    float n_1 = u2_1 - u1_1 * cos_phi;
+    float n = sqrt(square(n_0) + square(n_1));
+
+    mpArc_t blend;
+    blend.plane_axis_0 = plane[0];
+    blend.plane_axis_1 = plane[1];
+    blend.linear_axis = AXIS_X + AXIS_Y + AXIS_Z - plane[0] - plane[1];
+    blend.radius = radius;
+    blend.center_0 = mp.position[plane[0]] + n_0 / n * radius;
+    blend.center_1 = mp.position[plane[1]] + n_1 / n * radius;
+    blend.theta_per_mm = ((cross > 0) ? -1 : 1) / radius;  // see mp_arc_position()
+    blend.theta_end = atan2(mp.position[plane[0]] - blend.center_0, mp.position[plane[1]] - blend.center_1) +
+                      blend.theta_per_mm * blend_length;
+    blend.linear_end = mp.position[blend.linear_axis];
+    blend.linear_per_mm = 0;
+
+    GCodeState_t gm;
+    memcpy(&gm, gm_in, sizeof(GCodeState_t));
+    copy_vector(gm.target, corner);
+    mp_arc_position(&blend, 0, gm.target);
+    gm.feed_rate = feed_rate;
+    mp_arc(&gm, &blend, blend_length);    // leaves mp.position at the end of the arc
+    MP_PROFILE_BLEND();
+    return (true);
+}
+
+/****************************************************************************************
+ * mp_arc() - plan an arc or helix as a single block
+ *
+ *  The arc is planned like a line of the arc's length and runs through mp_exec_aline(),
+ *  which puts each segment on the circle (see mp_arc_position()). One arc takes one buffer
+ *  however fine the chordal tolerance, and there are no chord junctions to slow it down.
+ *
+ *  gm_in->target is the end of the arc. It and the geometry are in machine coordinates,
+ *  i.e. already rotated - mp_arc() can't rotate a circle, so arcs from Gcode are expanded
+ *  into lines unless the rotation matrix is the identity (see cm_arc_callback()).
+ *
+ *  The velocity limits:
+ *    - Each plane axis may carry the whole planar velocity somewhere on the arc, so the
+ *      jerk and the axis feed rates are scaled as for a line with that unit vector.
+ *    - Centripetal: at constant velocity v the plane axes see a jerk of v^3/r^2, so the
+ *      planar velocity is held to cbrt(Jm * r^2) of the slower plane axis.
+ *
+ *  bf->unit is the direction the arc starts in. The direction it ends in is computed from
+ *  the geometry when the junction after it is planned.
+ */
+
+stat_t mp_arc(GCodeState_t* gm_in, const mpArc_t* arc, const float length)
+{
+    mpBuf_t* bf;
+    float axis_length[AXES] = {0, 0, 0, 0, 0, 0};
+    float axis_square[AXES] = {0, 0, 0, 0, 0, 0};
+    float axis_share[AXES]  = {0, 0, 0, 0, 0, 0};
+
+    if ((bf = mp_get_write_buffer()) == NULL) {  // never supposed to fail
+        return (cm_panic(STAT_FAILED_GET_PLANNER_BUFFER, "arc()"));
+    }
+    memcpy(bf->gm, gm_in, sizeof(GCodeState_t));
+    memcpy(bf->arc, arc, sizeof(mpArc_t));
+
+    // setup the buffer
+    bf->bf_func = mp_exec_aline;  // arcs run as alines
+    bf->length  = length;
+    mp_arc_direction(bf->arc, length, bf->unit);
+
+    float planar = fabs(arc->radius * arc->theta_per_mm);  // share of the path in the plane
+    float linear = fabs(arc->linear_per_mm);               // share along the linear axis
+    bf->axis_flags[arc->plane_axis_0] = true;
+    bf->axis_flags[arc->plane_axis_1] = true;
+    bf->axis_flags[arc->linear_axis]  = fp_NOT_ZERO(linear);
+    axis_share[arc->plane_axis_0] = planar;
+    axis_share[arc->plane_axis_1] = planar;
+    axis_length[arc->plane_axis_0] = planar * length;
+    axis_length[arc->plane_axis_1] = planar * length;
+    axis_square[arc->plane_axis_0] = square(planar * length);  // the XYZ length is the helix length
+    if (bf->axis_flags[arc->linear_axis]) {
+        axis_share[arc->linear_axis]  = linear;
+        axis_length[arc->linear_axis] = linear * length;
+        axis_square[arc->linear_axis] = square(linear * length);
+    }
+    _calculate_jerk(bf, axis_share);
+    _calculate_vmaxes(bf, axis_length, axis_square);
+
+    // centripetal limit
+    float jerk_plane = min(cm.a[arc->plane_axis_0].jerk_max, cm.a[arc->plane_axis_1].jerk_max) * JERK_MULTIPLIER;
+    float vmax       = cbrt(jerk_plane * square(arc->radius)) / planar;
+    if (bf->cruise_vset > vmax) {
+        bf->cruise_vset = vmax;
+        bf->cruise_vmax = vmax;
+        bf->block_time  = length / vmax;
+    }
+    bf->absolute_vmax = min(bf->absolute_vmax, vmax);
+    _set_bf_diagnostics(bf);
+
+    // Note: these next lines must remain in exact order. Position must update before committing the buffer.
+    copy_vector(mp.position, bf->gm->target);  // set the planner position
+    mp_commit_write_buffer(BLOCK_TYPE_ARC);    // commit current block (must follow the position update)
     return (STAT_OK);
 }
 
+/*
+ * mp_arc_position()  - position on the arc with <remaining> mm of path to go
+ * mp_arc_direction() - unit vector of the direction of travel at that point
+ *
+ *  Only the plane axes and the linear axis are written. These run in the exec, so they
+ *  use the float functions.
+ */
+
+void mp_arc_position(const mpArc_t* arc, const float remaining, float position[])
+{
+    float theta = arc->theta_end - arc->theta_per_mm * remaining;
+    position[arc->plane_axis_0] = arc->center_0 + sinf(theta) * arc->radius;
+    position[arc->plane_axis_1] = arc->center_1 + cosf(theta) * arc->radius;
+    position[arc->linear_axis]  = arc->linear_end - arc->linear_per_mm * remaining;
+}
+
+void mp_arc_direction(const mpArc_t* arc, const float remaining, float unit[])
+{
+    float theta  = arc->theta_end - arc->theta_per_mm * remaining;
+    float planar = arc->radius * arc->theta_per_mm;
+    unit[arc->plane_axis_0] = cosf(theta) * planar;
+    unit[arc->plane_axis_1] = -sinf(theta) * planar;
+    unit[arc->linear_axis]  = arc->linear_per_mm;
+}
+
 /*
  * mp_plan_block_list() - plan all the blocks in the list
  *
@@ -232,6 +666,10 @@ stat_t mp_aline(GCodeState_t* gm_in)
  *  planning in planner.cpp/mp_plan_buffer(). The planning pass may be planning moves for
  *  the first time, or replanning moves, or any combination. Starting "early" will cause
  *  a replan, which is useful for feedholds and feed overrides.
+ *
+ *  If the back-planning pass for the newest blocks was deferred (see _backplan_can_wait())
+ *  and can't wait any longer it is started here, from the newest block, without priming
+ *  anything again.
  */
 
 void mp_plan_block_list() 
@@ -239,6 +677,13 @@ void mp_plan_block_list()
     mpBuf_t* bf                = mp.p;
     bool     planned_something = false;
 
+    if ((mp.backplan_pending > 0) && (bf->buffer_state == MP_BUFFER_EMPTY) &&
+        (bf->pv->plannable) && !_backplan_can_wait()) {
+        mp.planning_return = bf;
+        mp.planner_state   = PLANNER_BACK_PLANNING;
+        bf = bf->pv;
+    }
+
     while (true) {
         // unconditional exit condition
         if (bf->buffer_state == MP_BUFFER_EMPTY) {
@@ -251,7 +696,9 @@ void mp_plan_block_list()
             return;
         }
 
+        MP_PROFILE_START(MP_PROFILE_PLAN_BLOCK);
         bf = _plan_block(bf);  // returns next block to plan
+        MP_PROFILE_END(MP_PROFILE_PLAN_BLOCK);
 
         planned_something = true;
         mp.p              = bf;  //+++++ DIAGNOSTIC - this is not needed but is set here for debugging purposes
@@ -264,6 +711,29 @@ void mp_plan_block_list()
     mp.p = bf;  // update planner pointer
 }
 
+/*
+ * _backplan_can_wait() - true if the back-planning pass for new blocks can be put off
+ *
+ *  The backward pass stops at the planning horizon - the first block that is no longer
+ *  plannable because everything before it is already optimal (see bf->plannable below).
+ *  In a long chain of short blocks the horizon trails the newest block by many blocks, and
+ *  walking back to it for every new block makes the cost per block the chain length.
+ *
+ *  The pass only changes blocks that the runtime hasn't reached. While there is more than
+ *  PHAT_CITY_TIME of non-plannable blocks queued ahead of the runtime it can be left for
+ *  the next block, so one walk covers up to BACKPLAN_DEFER_MAX new blocks. Primed blocks
+ *  stay IN_PROCESS until the pass runs, and the runtime won't start an unprepped block.
+ *  Feedholds and override ramps always plan right away.
+ */
+
+static bool _backplan_can_wait()
+{
+    return ((mp.backplan_pending < BACKPLAN_DEFER_MAX) &&
+            (cm.hold_state == FEEDHOLD_OFF) && !mp.ramp_active &&
+            (mb.r->buffer_state >= MP_BUFFER_PLANNED) &&
+            (mp.plannable_time > PHAT_CITY_TIME));
+}
+
 /*
  * _plan_block() - the block chain using pessimistic assumptions
  */
@@ -277,7 +747,7 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
 
         if (bf->pv->plannable) {
             _calculate_junction_vmax(bf->pv);  // compute maximum junction velocity constraint
-            if (bf->pv->gm.path_control == PATH_EXACT_STOP) {
+            if (bf->pv->gm->path_control == PATH_EXACT_STOP) {
                 bf->pv->exit_vmax = 0;
             } else {
                 bf->pv->exit_vmax = min3(bf->pv->junction_vmax, bf->pv->cruise_vmax, bf->cruise_vmax);
@@ -291,10 +761,14 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
         // bf->pv_group = bf->pv;
 
         bf->hint = NO_HINT;  // ensure we've cleared the hints
+        mp.backplan_pending++;
         // Time: 12us-41us
         if (bf->nx->plannable) {  // read in new buffers until EMPTY
             return (bf->nx);
         }
+        if (_backplan_can_wait()) {  // leave the backward pass for a later block
+            return (bf->nx);
+        }
         mp.planning_return = bf->nx;                 // where to return after planning is complete
         mp.planner_state   = PLANNER_BACK_PLANNING;  // start backplanning
     }
@@ -310,13 +784,17 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
         // We will alter the previous block's exit_velocity.
         float braking_velocity = 0;  // we use this to stre the previous entry velocity, start at 0
         bool optimal = false;  // we use the optimal flag (as the opposite of plannable) to carry plan-ability backward.
+        uint16_t visited = 0;  // blocks walked by this pass (profiling only)
 
         // We test for (braking_velocity < bf->exit_velocity) in case of an inversion, and plannable is then violated.
         for (; bf->plannable || (braking_velocity < bf->exit_velocity); bf = bf->pv) {
             // Timings from *here*
 
             bf->iterations++;
-            bf->plannable = bf->plannable && !optimal;  // Don't accidentally enable plannable!
+            visited++;
+            if (optimal) {
+                mp_set_unplannable(bf);                 // never re-enables plannable
+            }
 
             // Let's be mindful that for ward planning may change exit_vmax, and our exit velocity may be lowered
             braking_velocity = min(braking_velocity, bf->exit_vmax);
@@ -343,7 +821,7 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
                 braking_velocity = 0;
 
                 // bf->plannable = !optimal && bf->pv->plannable;
-                bf->plannable = false;
+                mp_set_unplannable(bf);
 
                 bf->hint = COMMAND_BLOCK;
 
@@ -423,6 +901,9 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
                 bf->buffer_state = MP_BUFFER_PREPPED;
             }
         }  // for loop
+        MP_PROFILE_BACKPLAN(mp.backplan_pending, visited);
+        MP_TRACE(MP_TRACE_BACKPLAN, mb.w->pv, visited);
+        mp.backplan_pending = 0;
     }      // exits with bf pointing to a locked or EMPTY block
 
     mp.planner_state = PLANNER_PRIMING;  // revert to initial state
@@ -490,19 +971,20 @@ static void _calculate_override(mpBuf_t* bf)  // execute ramp to adjust cruise v
  *  Set the jerk scaling to the lowest axis with a non-zero unit vector.
  *  Go through the axes one by one and compute the scaled jerk, then pick
  *  the highest jerk that does not violate any of the axes in the move.
+ *  Lines pass their unit vector, arcs the largest share of the path each axis takes.
  *
  * Cost about ~65 uSec
  */
 
-static void _calculate_jerk(mpBuf_t* bf) 
+static void _calculate_jerk(mpBuf_t* bf, const float unit[]) 
 {
     // compute the jerk as the largest jerk that still meets axis constraints
     bf->jerk   = 8675309;  // a ridiculously large number
     float jerk = 0;
 
     for (uint8_t axis = 0; axis < AXES; axis++) {
-        if (fabs(bf->unit[axis]) > 0) {  // if this axis is participating in the move
-            jerk = cm.a[axis].jerk_max / fabs(bf->unit[axis]);
+        if (fabs(unit[axis]) > 0) {  // if this axis is participating in the move
+            jerk = cm.a[axis].jerk_max / fabs(unit[axis]);
             if (jerk < bf->jerk) {
                 bf->jerk = jerk;
                 //              bf->jerk_axis = axis;           // +++ diagnostic
@@ -536,6 +1018,12 @@ static void _calculate_jerk(mpBuf_t* bf)
  *  absolute_vmax is the time limited by the rate-limiting axis. It is saved for possible
  *  use later in feed override computation.
  *
+ *  Neither may ask any motor for more than $srl (cm.step_rate_limit) of FREQUENCY_DDA
+ *  steps per second, as the DDA can't make more than one step per tick. The kinematics
+ *  give each motor's share of the move (kn_motor_steps_max()), so a CoreXY motor that
+ *  carries both X and Y is limited by their sum. Arcs pass each plane axis its peak share.
+ *  Only the linear kinematic models have the limit (see kinematics.h).
+ *
  *  Velocities may be also be degraded (slowed down) if:
  *    - The block calls for a time that is less than the minimum update time (min segment time).
  *      This is very important to ensure proper block planning and trapezoid generation.
@@ -587,24 +1075,24 @@ static void _calculate_vmaxes(mpBuf_t* bf, const float axis_length[], const floa
     float block_time;           // resulting move time
 
     // compute feed time for feeds and probe motion
-    if (bf->gm.motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
-        if (bf->gm.feed_rate_mode == INVERSE_TIME_MODE) {
-            feed_time             = bf->gm.feed_rate;  // NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
-            bf->gm.feed_rate_mode = UNITS_PER_MINUTE_MODE;
+    if (bf->gm->motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
+        if (bf->gm->feed_rate_mode == INVERSE_TIME_MODE) {
+            feed_time             = bf->gm->feed_rate;  // NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
+            bf->gm->feed_rate_mode = UNITS_PER_MINUTE_MODE;
         } else {
             // compute length of linear move in millimeters. Feed rate is provided as mm/min
-            feed_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / bf->gm.feed_rate;
+            feed_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / bf->gm->feed_rate;
             // if no linear axes, compute length of multi-axis rotary move in degrees. Feed rate is provided as
             // degrees/min
             if (fp_ZERO(feed_time)) {
-                feed_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / bf->gm.feed_rate;
+                feed_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / bf->gm->feed_rate;
             }
         }
     }
     // compute rate limits and absolute maximum limit
     for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
         if (bf->axis_flags[axis]) {
-            if (bf->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+            if (bf->gm->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
                 tmp_time = fabs(axis_length[axis]) / cm.a[axis].velocity_max;
             } else {  // gm.motion_mode == MOTION_MODE_STRAIGHT_FEED
                 tmp_time = fabs(axis_length[axis]) / cm.a[axis].feedrate_max;
@@ -616,6 +1104,17 @@ static void _calculate_vmaxes(mpBuf_t* bf, const float axis_length[], const floa
             }
         }
     }
+#if (KINEMATICS_LINEAR)
+    // step rate limit - no motor may need more than $srl of the DDA rate
+    if (cm.step_rate_limit > 0) {
+        tmp_time = kn_motor_steps_max(axis_length) / (cm.step_rate_limit * FREQUENCY_DDA * 60);  // minutes at the limit
+        if (tmp_time > max(feed_time, max_time)) {
+            max_time = tmp_time;
+            MP_TRACE(MP_TRACE_STEP_LIMIT, bf, bf->length / tmp_time);
+        }
+        min_time = max(min_time, tmp_time);
+    }
+#endif
     block_time        = max3(feed_time, max_time, MIN_BLOCK_TIME);
     min_time          = max(min_time, MIN_BLOCK_TIME);
     bf->cruise_vset   = bf->length / block_time;  // target velocity requested
@@ -678,12 +1177,20 @@ static void _calculate_junction_vmax(mpBuf_t* bf)
     // ++++ RG If we change cruise_vmax, we'll need to recompute junction_vmax, if we do this:
     float velocity = min(bf->cruise_vmax, bf->nx->cruise_vmax);  // start with our maximum possible velocity
 
+    // the direction this block ends in. An arc's unit vector is the direction it starts in.
+    const float* unit = bf->unit;
+    float arc_unit[AXES] = {0, 0, 0, 0, 0, 0};
+    if (bf->block_type == BLOCK_TYPE_ARC) {
+        mp_arc_direction(bf->arc, 0, arc_unit);
+        unit = arc_unit;
+    }
+
     // uint8_t jerk_axis = AXIS_X;
     // cmAxes jerk_axis = AXIS_X;
 
     for (uint8_t axis = 0; axis < AXES; axis++) {
         if (bf->axis_flags[axis] || bf->nx->axis_flags[axis]) {       // skip axes with no movement
-            float delta = fabs(bf->unit[axis] - bf->nx->unit[axis]);  // formula (1)
+            float delta = fabs(unit[axis] - bf->nx->unit[axis]);  // formula (1)
 
             // Corner case: If an axis has zero delta, we might have a straight line.
             // Corner case: An axis doesn't change (and it's not a straight line).
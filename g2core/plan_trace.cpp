@@ -0,0 +1,126 @@
+/*
+ * plan_trace.cpp - binary trace of planner events
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2026 g2core contributors
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "planner.h"
+#include "plan_trace.h"
+#include "text_parser.h"
+#include "util.h"
+#include "xio.h"
+
+#if MP_TRACE_ENABLE
+
+mpTrace_t mp_trace;
+
+/*
+ * mp_trace_dump_json()   - $trd - write the trace as one JSON line per entry, oldest first
+ * mp_trace_dump_binary() - $trb - write the raw entries as hex, two per line
+ * mp_trace_clear()       - $trc - empty the trace
+ *
+ *  Both dumps start with a header line:
+ *
+ *    {"trh":{"ver":1,"fmt":"json","size":24,"tick_us":1000,"recorded":N,"entries":n}}
+ *
+ *  "recorded" counts all events since the last clear, "entries" is how many follow (at
+ *  most MP_TRACE_SIZE). A $trd line is
+ *
+ *    {"tr":[time,event,buffer,linenum,queued,block_type,hint,zoid_exit,meet_iterations,value]}
+ *
+ *  and a $trb line is {"trb":"<hex>"} holding entries as they are in memory. The command
+ *  returns the number of entries written. Resources/debug/mp_trace.py decodes either form.
+ */
+
+static uint32_t _dump_header(const char *format)
+{
+    char buf[128];
+    mp_trace.suspended = true;                  // hold the ring still while it's written out
+    uint32_t recorded = mp_trace.head;
+    uint32_t entries = min(recorded, (uint32_t)MP_TRACE_SIZE);
+    sprintf(buf, "{\"trh\":{\"ver\":%d,\"fmt\":\"%s\",\"size\":%d,\"tick_us\":%lu,\"recorded\":%lu,\"entries\":%lu}}\n",
+            MP_TRACE_VERSION, format, (int)sizeof(mpTraceEntry_t), (unsigned long)MP_TRACE_TICK_US,
+            (unsigned long)recorded, (unsigned long)entries);
+    xio_writeline(buf);
+    return (entries);
+}
+
+static stat_t _dump_done(nvObj_t *nv, const uint32_t entries)
+{
+    mp_trace.suspended = false;
+    nv->value = (float)entries;
+    nv->valuetype = TYPE_INT;
+    return (STAT_OK);
+}
+
+stat_t mp_trace_dump_json(nvObj_t *nv)
+{
+    char buf[128];
+    uint32_t entries = _dump_header("json");
+    uint32_t first = mp_trace.head - entries;
+
+    for (uint32_t i = first; i < first + entries; i++) {
+        const mpTraceEntry_t *e = &mp_trace.entry[i & (MP_TRACE_SIZE - 1)];
+        sprintf(buf, "{\"tr\":[%lu,%d,%d,%lu,%d,%d,%d,%d,%d,%0.3f]}\n",
+                (unsigned long)e->time, e->event, e->buffer, (unsigned long)e->linenum, e->queued,
+                e->block_type, e->hint, e->zoid_exit, e->meet_iterations, (double)e->value);
+        xio_writeline(buf);
+    }
+    return (_dump_done(nv, entries));
+}
+
+stat_t mp_trace_dump_binary(nvObj_t *nv)
+{
+    char buf[16 + (4 * sizeof(mpTraceEntry_t))];
+    uint32_t entries = _dump_header("hex");
+    uint32_t first = mp_trace.head - entries;
+
+    for (uint32_t i = first; i < first + entries; i += 2) {
+        char *s = buf + sprintf(buf, "{\"trb\":\"");
+        for (uint32_t j = i; (j < i + 2) && (j < first + entries); j++) {
+            const uint8_t *b = (const uint8_t *)&mp_trace.entry[j & (MP_TRACE_SIZE - 1)];
+            for (uint8_t k = 0; k < sizeof(mpTraceEntry_t); k++) {
+                s += sprintf(s, "%02x", b[k]);
+            }
+        }
+        sprintf(s, "\"}\n");
+        xio_writeline(buf);
+    }
+    return (_dump_done(nv, entries));
+}
+
+stat_t mp_trace_clear(nvObj_t *nv)
+{
+    mp_trace.suspended = true;
+    memset(mp_trace.entry, 0, sizeof(mp_trace.entry));
+    mp_trace.head = 0;
+    mp_trace.suspended = false;
+    return (STAT_OK);
+}
+
+/*********************
+ * TEXT MODE SUPPORT *
+ *********************/
+#ifdef __TEXT_MODE
+
+static const char fmt_trd[] = "trace entries: %d\n";
+void mp_trace_print_trd(nvObj_t *nv) { text_print(nv, fmt_trd);}    // TYPE_INT
+
+#endif // __TEXT_MODE
+
+#endif // MP_TRACE_ENABLE
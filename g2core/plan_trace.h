@@ -0,0 +1,128 @@
+/*
+ * plan_trace.h - binary trace of planner events
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2026 g2core contributors
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ *  The trace is a ring of fixed size binary entries, one for each planner event of
+ *  interest. Recording copies a few fields into the next slot, so it can be left on while
+ *  a machine runs. The last MP_TRACE_SIZE events are dumped on request with $trd (one JSON
+ *  line per entry) or $trb (the raw entries as hex) and decoded on the host with
+ *  Resources/debug/mp_trace.py.
+ *
+ *  Slots are claimed with an atomic increment, so the main loop and the exec and stepper
+ *  interrupts can all record without locking. Recording is suspended while a dump runs.
+ *
+ *  A board turns the trace on by defining MP_TRACE_ENABLE 1 in its hardware.h. With it at
+ *  0 the MP_TRACE() calls compile out and the $tr commands are not in the config table.
+ */
+
+#ifndef PLAN_TRACE_H_ONCE
+#define PLAN_TRACE_H_ONCE
+
+#include "planner.h"
+
+#ifndef MP_TRACE_ENABLE
+#define MP_TRACE_ENABLE     0                   // 1 records planner events (see above)
+#endif
+#ifndef MP_TRACE_SIZE
+#define MP_TRACE_SIZE       ((uint16_t)128)     // entries in the ring - must be a power of 2
+#endif
+#ifndef MP_TRACE_CLOCK                          // boards with a finer clock may set both
+#define MP_TRACE_CLOCK()    SysTickTimer.getValue()
+#define MP_TRACE_TICK_US    1000                // microseconds per MP_TRACE_CLOCK() tick
+#endif
+
+#define MP_TRACE_VERSION    1                   // bump if mpTraceEntry_t or the dump formats change
+
+typedef enum {                      // entry.value holds:
+    MP_TRACE_NONE = 0,              // (unused slot)
+    MP_TRACE_COMMIT,                // block_time in ms - block queued by mp_commit_write_buffer()
+    MP_TRACE_BACKPLAN,              // blocks visited - a back-planning pass started from this block
+    MP_TRACE_PLAN,                  // exit velocity - ramps computed, see hint, zoid_exit, meet_iterations
+    MP_TRACE_RUN,                   // queued motion time in ms - block started running
+    MP_TRACE_STARVED,               // queued motion time in ms - block started with no prepped block behind it
+    MP_TRACE_UNPLANNED,             // queued motion time in ms - runtime reached a block not yet forward planned
+    MP_TRACE_FREE,                  // block_time in ms - block finished and was freed
+    MP_TRACE_STEP_LIMIT             // velocity limit - block was slowed so no motor steps faster than $srl allows
+} mpTraceEvent;
+
+typedef struct mpTraceEntry {       // 24 bytes, little endian on all targets. See mp_trace.py
+    uint32_t time;                  // MP_TRACE_CLOCK() when recorded
+    uint32_t linenum;               // Gcode line number of the block
+    float value;                    // depends on the event - see mpTraceEvent
+    uint16_t buffer;                // buffer number of the block
+    uint16_t queued;                // planner buffers in use
+    uint8_t event;                  // mpTraceEvent
+    uint8_t block_type;             // blockType
+    uint8_t hint;                   // blockHint
+    uint8_t zoid_exit;              // zoidExitPoint (PLAN only)
+    uint8_t meet_iterations;        // meet velocity solver iterations (PLAN only)
+    uint8_t reserved[3];
+} mpTraceEntry_t;
+
+typedef struct mpTrace {
+    volatile uint32_t head;         // count of entries recorded since the last clear
+    volatile bool suspended;        // set while dumping
+    mpTraceEntry_t entry[MP_TRACE_SIZE];
+} mpTrace_t;
+
+#if MP_TRACE_ENABLE
+
+static_assert((MP_TRACE_SIZE & (MP_TRACE_SIZE - 1)) == 0, "MP_TRACE_SIZE must be a power of 2");
+static_assert(sizeof(mpTraceEntry_t) == 24, "mpTraceEntry_t is decoded by mp_trace.py - keep it 24 bytes");
+
+extern mpTrace_t mp_trace;
+
+inline void mp_trace_record(const uint8_t event, const mpBuf_t *bf, const float value, const uint8_t zoid_exit)
+{
+    if (mp_trace.suspended) {
+        return;
+    }
+    mpTraceEntry_t *e = &mp_trace.entry[__atomic_fetch_add(&mp_trace.head, 1, __ATOMIC_RELAXED) & (MP_TRACE_SIZE - 1)];
+    e->time = MP_TRACE_CLOCK();
+    e->linenum = bf->gm->linenum;
+    e->value = value;
+    e->buffer = bf->buffer_number;
+    e->queued = mb.size - mb.buffers_available;
+    e->event = event;
+    e->block_type = bf->block_type;
+    e->hint = bf->hint;
+    e->zoid_exit = zoid_exit;
+    e->meet_iterations = bf->meet_iterations;
+}
+
+#define MP_TRACE(event, bf, value)          mp_trace_record(event, bf, value, ZOID_EXIT_NULL)
+#define MP_TRACE_ZOID(bf, exit_point)       mp_trace_record(MP_TRACE_PLAN, bf, bf->exit_velocity, exit_point)
+
+stat_t mp_trace_dump_json(nvObj_t *nv);
+stat_t mp_trace_dump_binary(nvObj_t *nv);
+stat_t mp_trace_clear(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+    void mp_trace_print_trd(nvObj_t *nv);
+#else
+    #define mp_trace_print_trd tx_print_stub
+#endif // __TEXT_MODE
+
+#else
+
+#define MP_TRACE(event, bf, value)
+#define MP_TRACE_ZOID(bf, exit_point)
+
+#endif // MP_TRACE_ENABLE
+
+#endif // End of include guard: PLAN_TRACE_H_ONCE
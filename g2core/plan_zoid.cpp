@@ -29,26 +29,12 @@
 #include "g2core.h"
 #include "config.h"
 #include "planner.h"
+#include "plan_trace.h"
 #include "report.h"
 #include "util.h"
 
 //+++++ DIAGNOSTICS
 
-#define LOG_RETURN(msg)  // LOG_RETURN with no action (production)
-/*
-#include "xio.h"
-static char logbuf[128];
-static void _logger(const char *msg, const mpBuf_t *bf)         // LOG_RETURN with full state dump
-{
-    sprintf(logbuf, "[%2d] %s (%d) mt:%5.2f, L:%1.3f [%1.3f, %1.3f, %1.3f] V:[%1.2f, %1.2f, %1.2f]\n",
-                    bf->buffer_number, msg, bf->hint, (bf->block_time * 60000),
-                    bf->length, bf->head_length, bf->body_length, bf->tail_length,
-                    bf->pv->exit_velocity, bf->cruise_velocity, bf->exit_velocity);
-    xio_writeline(logbuf);
-}
-#define LOG_RETURN(msg) { _logger(msg, bf); }
-*/
-
 //#define TRAP_ZERO(t,m)
 #define TRAP_ZERO(t, m)                             \
     if (fp_ZERO(t)) {                               \
@@ -61,11 +47,25 @@ static void _logger(const char *msg, const mpBuf_t *bf)         // LOG_RETURN wi
 /* local functions */
 
 // static float _get_target_length_min(const float v_0, const float v_1, const mpBuf_t *bf, const float min);
-static float _get_meet_velocity(const float          v_0,
-                                const float          v_2,
-                                const float          L,
-                                mpBuf_t*             bf,
-                                mpBlockRuntimeBuf_t* block);
+static float _get_no_meet_velocity(const float          v_0,
+                                   const float          v_2,
+                                   const float          L,
+                                   const mpBuf_t*       bf,
+                                   mpBlockRuntimeBuf_t* block);
+
+// Select the meet velocity solver at compile time (see MEET_VELOCITY_SOLVER in planner.h)
+static inline float _get_meet_velocity(const float          v_0,
+                                       const float          v_2,
+                                       const float          L,
+                                       mpBuf_t*             bf,
+                                       mpBlockRuntimeBuf_t* block)
+{
+#if (MEET_VELOCITY_SOLVER == MEET_SOLVER_NEWTON)
+    return mp_get_meet_velocity_newton(v_0, v_2, L, bf, block);
+#else
+    return mp_get_meet_velocity_bracketed(v_0, v_2, L, bf, block);
+#endif
+}
 
 /****************************************************************************************
  * mp_calculate_ramps() - calculate trapezoid-like ramp parameters for a block
@@ -112,8 +112,7 @@ static float _get_meet_velocity(const float          v_0,
 
 void _zoid_exit(mpBuf_t* bf, zoidExitPoint exit_point) 
 {
-    //+++++ DIAGNOSTIC
-    //    bf->zoid_exit = exit_point;
+    MP_TRACE_ZOID(bf, exit_point);
     if (mp_runtime_is_idle()) {  // normally the runtime keeps this value fresh
                                  //        bf->time_in_plan_ms += bf->block_time_ms;
         bf->plannable_time_ms += bf->block_time_ms;
@@ -170,7 +169,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
             block->body_time   = block->body_length / block->cruise_velocity;
             bf->block_time     = block->body_time;
 
-            LOG_RETURN("1c");
             return (_zoid_exit(bf, ZOID_EXIT_1c));
         } else {
             // we need to degrade the hint to MIXED_ACCELERATION
@@ -205,7 +203,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
             block->body_time = block->body_length / block->cruise_velocity;
             block->tail_time = block->tail_length * 2 / (block->exit_velocity + block->cruise_velocity);
             bf->block_time   = block->body_time + block->tail_time;
-            LOG_RETURN("2d");
             return (_zoid_exit(bf, ZOID_EXIT_2d));
         }
 
@@ -216,7 +213,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
             block->cruise_velocity = entry_velocity;
             block->tail_time       = block->tail_length * 2 / (block->exit_velocity + block->cruise_velocity);
             bf->block_time         = block->tail_time;
-            LOG_RETURN("1d");
             return (_zoid_exit(bf, ZOID_EXIT_1d));
         }
 
@@ -252,7 +248,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
             block->cruise_velocity = block->exit_velocity;
             block->head_time       = (block->head_length * 2.0) / (entry_velocity + block->cruise_velocity);
             bf->block_time         = block->head_time;
-            LOG_RETURN("1a");
             return (_zoid_exit(bf, ZOID_EXIT_1a));
         } else {  // it's hit the cusp
 
@@ -277,7 +272,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
                 block->head_time   = (block->head_length * 2.0) / (entry_velocity + block->cruise_velocity);
                 block->body_time   = block->body_length / block->cruise_velocity;
                 bf->block_time     = block->head_time + block->body_time;
-                LOG_RETURN("2a");
                 return (_zoid_exit(bf, ZOID_EXIT_2a));
             }
         }
@@ -311,7 +305,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
 
         bf->hint = ASYMMETRIC_BUMP;
 
-        LOG_RETURN("2c");
         return (_zoid_exit(bf, ZOID_EXIT_2c));
     }
 
@@ -341,7 +334,6 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
     }
     bf->block_time = block->head_time + block->body_time + block->tail_time;
 
-    LOG_RETURN("3c");
     return (_zoid_exit(bf, ZOID_EXIT_3c));  // 550us worst case
 }
 
@@ -351,7 +343,8 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t* block, mpBuf_t* bf, const float ent
  * mp_get_target_length()   - find accel/decel length from delta V and jerk
  * mp_get_target_velocity() - find velocity achievable from Vi, length and jerk
  * _get_target_length_min() - find target length with correction for minimum length moves
- * _get_meet_velocity()     - find velocity at which two lines intersect
+ * mp_get_meet_velocity_newton()     - find velocity at which two lines intersect (iterative)
+ * mp_get_meet_velocity_bracketed()  - find velocity at which two lines intersect (bounded)
  *
  *  The get_target functions know 3 things and return the 4th:
  *    Jm = maximum jerk of the move
@@ -464,19 +457,64 @@ float mp_get_decel_velocity(const float v_0, const float L, const mpBuf_t* bf)
 }
 
 /*
- * _get_meet_velocity() - find intersection velocity
+ * _get_no_meet_velocity() - handle a rate-limited move that has no meet velocity
+ *
+ * This is due to an inversion in the velocities of very short moves: the ramp from
+ * v_0 to v_2 alone is (nearly) as long as the move. We need to compute the head OR
+ * tail length, and the body will be the rest. Yes, that means we're computing a cruise
+ * in here. Sets the section lengths in block and returns the cruise velocity.
+ */
+
+static float _get_no_meet_velocity(const float          v_0,
+                                   const float          v_2,
+                                   const float          L,
+                                   const mpBuf_t*       bf,
+                                   mpBlockRuntimeBuf_t* block)
+{
+    float v_1 = max(v_0, v_2);
+
+    if (v_0 < v_2) {
+        // acceleration - it'll be a head/body
+        block->head_length = mp_get_target_length(v_0, v_2, bf);
+        if (block->head_length > L) {
+            block->head_length = L;
+            block->body_length = 0;
+            v_1                = mp_get_target_velocity(v_0, L, bf);
+        } else {
+            block->body_length = L - block->head_length;
+        }
+        block->tail_length = 0;
+
+    } else {
+        // deceleration - it'll be tail/body
+        block->tail_length = mp_get_target_length(v_2, v_0, bf);
+        if (block->tail_length > L) {
+            block->tail_length = L;
+            block->body_length = 0;
+            v_1                = mp_get_target_velocity(v_2, L, bf);
+        } else {
+            block->body_length = L - block->tail_length;
+        }
+        block->head_length = 0;
+    }
+    return v_1;
+}
+
+/*
+ * mp_get_meet_velocity_newton() - find intersection velocity
  *
  * This function, when given two velocities (v_0 and v_2) along with a length (L)
  * and jerk (J), will locate the velocity v_1 that will allow acceleration from v_0
  * at jerk J to v_1 and then deceleration at jerk J to v_2, all over total length L.
  *
+ * Newton's method from a one-sided guess. Usually a few iterations, but up to 30.
  */
 
-static float _get_meet_velocity(const float          v_0,
-                                const float          v_2,
-                                const float          L,
-                                mpBuf_t*             bf,
-                                mpBlockRuntimeBuf_t* block) 
+float mp_get_meet_velocity_newton(const float          v_0,
+                                  const float          v_2,
+                                  const float          L,
+                                  mpBuf_t*             bf,
+                                  mpBlockRuntimeBuf_t* block)
 {
     const float q_recip_2_sqrt_j = bf->q_recip_2_sqrt_j;
 
@@ -508,37 +546,7 @@ static float _get_meet_velocity(const float          v_0,
         if (v_1 < min_v_1) {
             // Case (2)
             // We have caught a rather nasty problem. There is no meet velocity.
-            // This is due to an inversion in the velocities of very short moves.
-            // We need to compute the head OR tail length, and the body will be the rest.
-            // Yes, that means we're computing a cruise in here.
-
-            v_1 = min_v_1;
-
-            if (v_0 < v_2) {
-                // acceleration - it'll be a head/body
-                block->head_length = mp_get_target_length(v_0, v_2, bf);
-                if (block->head_length > L) {
-                    block->head_length = L;
-                    block->body_length = 0;
-                    v_1                = mp_get_target_velocity(v_0, L, bf);
-                } else {
-                    block->body_length = L - block->head_length;
-                }
-                block->tail_length = 0;
-
-            } else {
-                // deceleration - it'll be tail/body
-                block->tail_length = mp_get_target_length(v_2, v_0, bf);
-                if (block->tail_length > L) {
-                    block->tail_length = L;
-                    block->body_length = 0;
-                    v_1                = mp_get_target_velocity(v_2, L, bf);
-                } else {
-                    block->body_length = L - block->tail_length;
-                }
-                block->head_length = 0;
-            }
-
+            v_1 = _get_no_meet_velocity(v_0, v_2, L, bf, block);
             break;
         }
 
@@ -587,3 +595,120 @@ static float _get_meet_velocity(const float          v_0,
 
     return v_1;
 }
+
+/*
+ * mp_get_meet_velocity_bracketed() - find intersection velocity with a bounded cost
+ *
+ * Solves the same problem as mp_get_meet_velocity_newton(), but never takes more than
+ * MEET_REFINEMENT_STEPS Newton steps. With v_lo and v_hi the lower and higher of v_0
+ * and v_2 we solve for s, where v_1 = v_hi + s^2. The two ramp lengths are then
+ *
+ *    l_hi(s) = k (2 v_hi s + s^3)                              k = q_recip_2_sqrt_j
+ *    l_lo(s) = k sqrt(v_hi - v_lo + s^2) (v_hi + v_lo + s^2)
+ *
+ * and F(s) = l_hi + l_lo - L is increasing and convex for s >= 0. That buys us:
+ *
+ *  - F(0) >= 0 means the ramp v_lo -> v_hi alone uses up L, so there is no meet velocity
+ *    (Case 2). This is known up front instead of by the iteration falling below v_hi.
+ *
+ *  - A start above the root from closed-form bounds, with no call to
+ *    mp_get_target_velocity().
+ *
+ *  - Newton steps from above stay above the root, so an iterate never overshoots L by
+ *    more than the allowed overlap. If we run out of steps we end on the secant from
+ *    s = 0 to the last iterate, which is always short of L. That plans a small body at
+ *    a slightly lower cruise - never an overlap.
+ *
+ *  Working in s keeps v_1 - v_hi accurate when the meet is just above v_hi, and l_hi
+ *  needs no sqrt. meet_iterations records the number of Newton steps taken.
+ *
+ *  Cost: 1 cbrt, 1 sqrt, 4 / to start, then 1 sqrt, 2 / per step, and 1 sqrt, 1 / to end
+ *  on the secant. On the sim host (--meet-accuracy) that is about 115-125 ns a call, against
+ *  100-110 ns for the Newton solver's usual 2 iterations - the cbrt dominates. What it buys
+ *  is the bound, not the average: Newton's worst cases run to 30 iterations.
+ */
+
+float mp_get_meet_velocity_bracketed(const float          v_0,
+                                     const float          v_2,
+                                     const float          L,
+                                     mpBuf_t*             bf,
+                                     mpBlockRuntimeBuf_t* block)
+{
+    const float k     = bf->q_recip_2_sqrt_j;
+    const float v_lo  = min(v_0, v_2);
+    const float v_hi  = max(v_0, v_2);
+    const float dv    = v_hi - v_lo;
+    const float sum_v = v_hi + v_lo;
+
+    // Case (1) - symmetric, as for the Newton solver
+    if (fp_EQ(v_0, v_2)) {
+        block->head_length  = L / 2.0;
+        block->body_length  = 0;
+        block->tail_length  = L - block->head_length;
+        bf->meet_iterations = -1;
+        return mp_get_target_velocity(v_hi, L / 2.0, bf);
+    }
+
+    // Case (2) - no meet velocity
+    const float F_0 = k * sqrt(dv) * sum_v - L;
+    if (F_0 >= 0) {
+        bf->meet_iterations = 0;
+        return _get_no_meet_velocity(v_0, v_2, L, bf, block);
+    }
+
+    // Start above the root. F(s) >= k (2 s^3 + p s) - L with p = v_lo + 3 v_hi, so the root
+    // of that cubic is an upper bound, and so are the roots of its two terms alone. F is also
+    // above its tangent at 0. Take the least of those three, then a Newton step on the (convex)
+    // cubic, which lands on or above the cubic's root from either side.
+    const float L_k = L / k;
+    const float p   = v_lo + 3 * v_hi;
+    float       s_hi = min(cbrtf(L_k / 2), L_k / p);
+    s_hi = min(s_hi, -F_0 / (2 * k * v_hi));
+    s_hi -= (s_hi * (2 * s_hi * s_hi + p) - L_k) / (6 * s_hi * s_hi + p);
+
+    float l_hi;  // ramp lengths at the s we end on
+    float l_lo;
+    float s;
+    int   i = 0;
+    while (true) {
+        const float s_2     = s_hi * s_hi;
+        const float sqrt_lo = sqrt(dv + s_2);
+        l_hi                = k * s_hi * (2 * v_hi + s_2);
+        l_lo                = k * sqrt_lo * (sum_v + s_2);
+        const float F_hi    = (l_hi + l_lo) - L;
+
+        if (F_hi < 0.00001) {  // allow 0.00001 overlap (Case 3b)
+            s = s_hi;
+            break;
+        }
+        if (i == MEET_REFINEMENT_STEPS) {  // out of steps - end on the secant, which is short of L (Case 3a)
+            s                 = s_hi * F_0 / (F_0 - F_hi);
+            const float s_sq = s * s;
+            l_hi              = k * s * (2 * v_hi + s_sq);
+            l_lo              = k * sqrt(dv + s_sq) * (sum_v + s_sq);
+            break;
+        }
+        i++;
+
+        // Newton step from above. F'(s) = k (2 v_hi + 3 s^2 + s (sum_v + 3 s^2 + 2 dv) / sqrt(dv + s^2))
+        const float dF = k * (2 * v_hi + 3 * s_2 + s_hi * (sum_v + 3 * s_2 + 2 * dv) / sqrt_lo);
+        s_hi           = s_hi - F_hi / dF;
+    }
+
+    if (v_0 < v_2) {
+        block->head_length = l_lo;
+        block->tail_length = l_hi;
+    } else {
+        block->head_length = l_hi;
+        block->tail_length = l_lo;
+    }
+    block->body_length = L - (block->head_length + block->tail_length);
+    if (block->body_length < 0) {  // fix the overlap
+        block->body_length = 0;
+        block->tail_length = L - block->head_length;
+    }
+
+    bf->meet_iterations = i;
+
+    return v_hi + s * s;
+}
@@ -56,7 +56,9 @@
 #include "canonical_machine.h"
 #include "plan_arc.h"
 #include "planner.h"
+#include "plan_trace.h"
 #include "kinematics.h"
+#include "mesh.h"
 #include "stepper.h"
 #include "encoder.h"
 #include "report.h"
@@ -121,10 +123,14 @@ _json_commands_t jc;
 
 // Local Scope Data and Functions
 #define spindle_speed block_time    // local alias for spindle_speed to the time variable
-#define value_vector gm.target      // alias for vector of values
+#define value_vector gm->target     // alias for vector of values
 
 //static void _planner_time_accounting();
+static void _clear_planner_time();
 static void _audit_buffers();
+#ifdef DEBUG
+static bool _planner_time_is_sane();
+#endif
 
 // Execution routines (NB: These are called from the LO interrupt)
 static void _exec_json_command(float *value, bool *flag);
@@ -172,9 +178,55 @@ stat_t planner_test_assertions()
         (BAD_MAGIC(mr.magic_start)) || (BAD_MAGIC(mr.magic_end))) {
         return(cm_panic(STAT_PLANNER_ASSERTION_FAILURE, "planner_test_assertions()"));
     }
+#ifdef DEBUG
+    if (!_planner_time_is_sane()) {
+        return(cm_panic(STAT_PLANNER_ASSERTION_FAILURE, "planner_test_assertions() time"));
+    }
+#endif
     return (STAT_OK);
 }
 
+/*
+ * _planner_time_is_sane() - check the planner time sums against a walk of the queue (DEBUG)
+ *
+ *  This is the walk the running sums replace (see mp_planner_time_accounting()).
+ *  Interrupts are held off so the queue can't change under it.
+ */
+#ifdef DEBUG
+
+#define PLANNER_TIME_TOLERANCE (0.001/60)   // one millisecond, in minutes
+
+static bool _planner_time_is_sane()
+{
+    float queued_time = 0;
+    float plannable_time = 0;
+    bool planned = true;                            // still in the run of blocks that are already planned
+
+    __disable_irq();
+    mpBuf_t *bf = mb.r;
+    if (bf->buffer_state != MP_BUFFER_EMPTY) {
+        do {
+            if (bf != mb.r) {
+                if (bf->plannable) {
+                    planned = false;
+                }
+                if (planned) {
+                    plannable_time += bf->block_time;
+                }
+            }
+            if (mp_is_aline_type(bf->block_type)) {
+                queued_time += bf->block_time;
+            }
+        } while ((bf = bf->nx) != mb.w);
+    }
+    bool sane = ((fabs(queued_time - mp.queued_time) < PLANNER_TIME_TOLERANCE) &&
+                 (fabs(plannable_time - mp.plannable_time) < PLANNER_TIME_TOLERANCE));
+    __enable_irq();
+    return (sane);
+}
+
+#endif // DEBUG
+
 /*
  * mp_halt_runtime() - stop runtime movement immediately
  */
@@ -230,7 +282,8 @@ void mp_set_runtime_position(uint8_t axis, const float position) { mr.position[a
 void mp_set_steps_to_runtime_position()
 {
     float step_position[MOTORS];
-    kn_inverse_kinematics(mr.position, step_position);      // convert lengths to steps in floating point
+    float compensated[AXES];
+    kn_inverse_kinematics(mesh_apply(mr.position, compensated), step_position);  // convert lengths to steps in floating point
     for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
         mr.target_steps[motor] = step_position[motor];
         mr.position_steps[motor] = step_position[motor];
@@ -242,6 +295,7 @@ void mp_set_steps_to_runtime_position()
         mr.following_error[motor] = 0;
         st_pre.mot[motor].corrected_steps = 0;
     }
+    mp_reset_step_history(step_position);
 }
 
 /************************************************************************************
@@ -278,9 +332,11 @@ void mp_queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
     bf->bf_func = _exec_command;      // callback to planner queue exec function
     bf->cm_func = cm_exec;            // callback to canonical machine exec function
 
-    for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-        bf->value_vector[axis] = value[axis];
-        bf->axis_flags[axis] = flag[axis];
+    if ((value != NULL) && (flag != NULL)) {        // the homing and probing callbacks take none
+        for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+            bf->value_vector[axis] = value[axis];
+            bf->axis_flags[axis] = flag[axis];
+        }
     }
     mp_commit_write_buffer(BLOCK_TYPE_COMMAND);     // must be final operation before exit
 }
@@ -429,10 +485,18 @@ stat_t mp_exec_out_of_band_dwell(void)
  *
  * mp_get_planner_buffers()  - return # of available planner buffers
  * mp_planner_is_full()      - true if planner has no room for a new block
+ * mp_planner_admits_input() - true if the planner wants another block (admission policy)
+ * mp_get_planner_queued_ms()- return motion time queued in the planner, in milliseconds
  * mp_has_runnable_buffer()  - true if next buffer is runnable, indicating motion has not stopped.
  * mp_is_it_phat_city_time() - test if there is time for non-essential processes
+ *
+ *  Admission: a block count says nothing about how much motion is queued - tiny segments
+ *  fill the queue in a few tens of milliseconds, long moves hold minutes. If a lookahead
+ *  time is set ($qt) input is held off once that much motion time is queued, even if
+ *  buffers are free. PLANNER_BUFFER_HEADROOM is always honored, so $qt can only ever
+ *  hold input back earlier than the block count would. $qt=0 is block count only.
  */
-uint8_t mp_get_planner_buffers()
+uint16_t mp_get_planner_buffers()
 {
     return (mb.buffers_available);
 }
@@ -443,6 +507,22 @@ bool mp_planner_is_full()
     return ((mb.buffers_available < PLANNER_BUFFER_HEADROOM) || (jc.available == 0));
 }
 
+bool mp_planner_admits_input()
+{
+    if (mp_planner_is_full()) {
+        return (false);
+    }
+    if (cm.planner_lookahead_ms == 0) {
+        return (true);
+    }
+    return (mp_get_planner_queued_ms() < cm.planner_lookahead_ms);
+}
+
+uint32_t mp_get_planner_queued_ms()
+{
+    return ((uint32_t)(mp.run_time_remaining * 60000));
+}
+
 bool mp_has_runnable_buffer()
 {
     return (mb.r->buffer_state);    // anything other than MP_BUFFER_EMPTY returns true
@@ -493,7 +573,7 @@ bool mp_is_phat_city_time()
 stat_t mp_planner_callback()
 {
     // Test if the planner has transitioned to an IDLE state
-    if ((mb.buffers_available == PLANNER_BUFFER_POOL_SIZE) &&   // detect and set IDLE state
+    if ((mb.buffers_available == mb.size) &&                   // detect and set IDLE state
         (cm.motion_state == MOTION_STOP) &&
         (cm.hold_state == FEEDHOLD_OFF)) {
         mp.planner_state = PLANNER_IDLE;
@@ -515,7 +595,7 @@ stat_t mp_planner_callback()
         mp.planner_state = PLANNER_STARTUP;
     }
     if (mp.planner_state == PLANNER_STARTUP) {
-        if (!mp_planner_is_full() && !_timed_out) {
+        if (mp_planner_admits_input() && !_timed_out) {
             return (STAT_OK);                       // remain in STARTUP
         }
         mp.planner_state = PLANNER_PRIMING;
@@ -594,24 +674,59 @@ void mp_end_feed_override(const float ramp_time)
 
 /*
  * mp_planner_time_accounting() - gather time in planner
+ * mp_add_block_time()          - add to the running sums for a block (negative to take away)
+ * mp_set_unplannable()         - clear bf->plannable, moving its time into plannable_time
+ *
+ *  The planner times are running sums, so nothing walks the queue to find them:
+ *
+ *    queued_time        block_time of every move from the run buffer to the newest block.
+ *                       Added on commit, adjusted when a block is replanned, taken away on free.
+ *    plannable_time     block_time of the blocks after the run buffer that are no longer
+ *                       plannable. Back-planning clears plannable from the oldest blocks
+ *                       forward, so these are always the blocks right behind the run buffer.
+ *    run_time_remaining queued_time less what the runtime has already executed. Counted down
+ *                       per segment by the exec and reset to queued_time as each move starts.
+ *
+ *  Whoever changes a queued block's block_time or plannable flag must use these functions.
+ *  The sums are cleared when the queue empties. Debug builds check them against a walk of
+ *  the queue in planner_test_assertions().
  */
 
 void mp_planner_time_accounting()
 {
-    mpBuf_t *bf = mb.r;                             // start with run buffer
-
-    // check the run buffer to see if anything is running. Might not be
-    if (bf->buffer_state != MP_BUFFER_RUNNING) {    // this is not an error condition
+    if (mb.r->buffer_state != MP_BUFFER_RUNNING) {  // this is not an error condition
         return;
     }
-    mp.plannable_time = 0; //UPDATE_BF_MS(bf); //+++++
-    while ((bf = bf->nx) != mb.r) {
-        if (bf->buffer_state == MP_BUFFER_EMPTY || bf->plannable == true) {
-            break;
+    mp.run_time_remaining = mp.queued_time;
+    UPDATE_MP_DIAGNOSTICS //+++++
+}
+
+static void _clear_planner_time()
+{
+    mp.queued_time = 0.0;
+    mp.plannable_time = 0.0;
+    mp.run_time_remaining = 0.0;
+}
+
+void mp_add_block_time(const mpBuf_t *bf, const float block_time)
+{
+    if (mp_is_aline_type(bf->block_type)) {
+        mp.queued_time += block_time;
+        mp.run_time_remaining += block_time;
+    }
+    if ((!bf->plannable) && (bf != mb.r)) {
+        mp.plannable_time += block_time;
+    }
+}
+
+void mp_set_unplannable(mpBuf_t *bf)
+{
+    if (bf->plannable) {
+        bf->plannable = false;
+        if (bf != mb.r) {
+            mp.plannable_time += bf->block_time;
         }
-        mp.plannable_time += bf->block_time;
     }
-    UPDATE_MP_DIAGNOSTICS //+++++
 }
 
 /**** PLANNER BUFFER PRIMITIVES ************************************************************
@@ -693,17 +808,21 @@ void mp_planner_time_accounting()
 // Also clears unlocked, so the buffer cannot be used
 static inline void _clear_buffer(mpBuf_t *bf)
 {
-    // Note: bf->bf_func is the first address we wish to clear as we must preserve
-    // the pointers and buffer number during interrupts
+    // Note: only the planning data is cleared, as we must preserve the pointers and
+    // buffer number during interrupts. bf->gm is not cleared - aline() overwrites it and
+    // commands only use the target. The axis vectors are, as aline() only sets the unit
+    // vector for axes that move and junctions read the vectors of command blocks.
 
     // We'll have to figure something else out for C, sorry.
     bf->clear();
+    memset(bf->unit, 0, sizeof(mb.unit[0]));
+    memset(bf->axis_flags, 0, sizeof(mb.axis_flags[0]));
 }
 
 void mp_init_buffers(void)
 {
     mpBuf_t *pv, *nx;
-    uint8_t i, nx_i;
+    uint16_t i, nx_i;
 
     memset(&mb, 0, sizeof(mb));                     // clear all values, pointers and status
     mb.magic_start = MAGICNUM;
@@ -711,18 +830,25 @@ void mp_init_buffers(void)
 
     mb.w = &mb.bf[0];                               // init all buffer pointers
     mb.r = &mb.bf[0];
-    pv = &mb.bf[PLANNER_BUFFER_POOL_SIZE-1];
-    for (i=0; i < PLANNER_BUFFER_POOL_SIZE; i++) {
-        mb.bf[i].buffer_number = i;                 //+++++ number it for diagnostics only (otherwise not used)
-
-        nx_i = ((i<PLANNER_BUFFER_POOL_SIZE-1)?(i+1):0); // buffer incr & wrap
+    pv = &mb.bf[mb.size-1];
+    for (i=0; i < mb.size; i++) {
+        mb.bf[i].buffer_number = i;                 // index into the pool arrays
+        mb.bf[i].gm = &mb.gm[i];                    // setup pointers to the data kept outside the buffer
+        mb.bf[i].unit = mb.unit[i];
+        mb.bf[i].axis_flags = mb.axis_flags[i];
+        mb.bf[i].arc = &mb.arc[i];
+
+        nx_i = ((i<mb.size-1)?(i+1):0);             // buffer incr & wrap
         nx = &mb.bf[nx_i];
         mb.bf[i].nx = nx;                           // setup ring pointers
         mb.bf[i].pv = pv;
 
         pv = &mb.bf[i];
     }
-    mb.buffers_available = PLANNER_BUFFER_POOL_SIZE;
+    mb.buffers_available = mb.size;
+    mp.backplan_pending = 0;                        // nothing is waiting to be back-planned
+    mp.coalesce = NULL;                             // no block to extend
+    _clear_planner_time();                          // the queue is empty
 
 //    mb.entry_changed = false;
 
@@ -777,8 +903,9 @@ void mp_commit_write_buffer(const blockType block_type)
 {
     mb.w->block_type = block_type;
     mb.w->block_state = BLOCK_INITIAL_ACTION;
+    MP_TRACE(MP_TRACE_COMMIT, mb.w, mb.w->block_time * 60000);
 
-    if (block_type == BLOCK_TYPE_ALINE) {
+    if (mp_is_aline_type(block_type)) {
         if (cm.motion_state == MOTION_STOP) {
             cm_set_motion_state(MOTION_PLANNING);
         }
@@ -790,6 +917,8 @@ void mp_commit_write_buffer(const blockType block_type)
         }
     }
     mb.w->plannable = true;                     // enable block for planning
+    mp_add_block_time(mb.w, mb.w->block_time);  // must follow plannable
+    mp.coalesce = NULL;                         // only mp_aline() makes a block extendable, after this
     mp.request_planning = true;
     mb.w = mb.w->nx;                            // advance write buffer pointer
     mp.block_timeout.set(BLOCK_TIMEOUT_MS);     // reset the block timer
@@ -815,12 +944,24 @@ bool mp_free_run_buffer()           // EMPTY current run buffer & advance to the
     _audit_buffers();               // diagnostic audit for buffer chain integrity (only runs in DEBUG mode)
 
     mpBuf_t *r = mb.r;
+    MP_PROFILE_BLOCK(r);            // last look at the block before it's cleared
+    MP_TRACE(MP_TRACE_FREE, r, r->block_time * 60000);
+    if (mp_is_aline_type(r->block_type)) {
+        mp.queued_time -= r->block_time;
+    }
     mb.r = mb.r->nx;                // advance to next run buffer
+    if (!mb.r->plannable) {
+        mp.plannable_time -= mb.r->block_time;  // the run buffer is not counted in plannable_time
+    }
     _clear_buffer(r);               // clear it out (& reset unlocked and set MP_BUFFER_EMPTY)
 
     mb.buffers_available++;
     qr_request_queue_report(-1);    // request a QR and add to the "removed buffers" count
-    return (mb.w == mb.r);          // return true if the queue emptied
+    if (mb.w == mb.r) {
+        _clear_planner_time();      // nothing left, so drop any residue from the sums
+        return (true);              // return true if the queue emptied
+    }
+    return (false);
 }
 
 /* UNUSED FUNCTIONS - left in for completeness and for reference
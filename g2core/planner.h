@@ -62,6 +62,7 @@ typedef enum {                      // bf->buffer_state values in incresing orde
 typedef enum {                      // bf->block_type values
     BLOCK_TYPE_NULL = 0,            // null move - does a no-op
     BLOCK_TYPE_ALINE,               // acceleration planned line
+    BLOCK_TYPE_ARC,                 // acceleration planned arc or helix (runs as an aline)
     BLOCK_TYPE_DWELL,               // delay with no movement
     BLOCK_TYPE_COMMAND,             // general command
     BLOCK_TYPE_JSON_WAIT,           // general command
@@ -123,22 +124,50 @@ typedef enum {
 
 /*** Most of these factors are the result of a lot of tweaking. Change with caution.***/
 
-#define PLANNER_BUFFER_POOL_SIZE    ((uint8_t)48)       // Suggest 12 min. Limit is 255
+#ifndef PLANNER_BUFFER_POOL_SIZE                        // boards set this in hardware.h - each buffer is
+#define PLANNER_BUFFER_POOL_SIZE    ((uint16_t)48)      // ~300 bytes of SRAM (see the sim bench "memory" report)
+#endif                                                  // Suggest 12 min. Limit is 65535
 #define PLANNER_BUFFER_HEADROOM     ((uint8_t)4)        // Buffers to reserve in planner before processing new input line
 #define JERK_MULTIPLIER             ((float)1000000)    // DO NOT CHANGE - must always be 1 million
 
 #define JUNCTION_INTEGRATION_MIN    (0.05)              // minimum allowable setting
 #define JUNCTION_INTEGRATION_MAX    (5.00)              // maximum allowable setting
+#define STEP_RATE_LIMIT_MAX         (1.00)              // the DDA makes at most one step per tick
 
 #define MIN_SEGMENT_MS              ((float)0.75)       // minimum segment milliseconds
 #define NOM_SEGMENT_MS              ((float)1.5)        // nominal segment ms (at LEAST MIN_SEGMENT_MS * 2)
+#define MAX_SEGMENT_MS              ((float)5.0)        // longest segment ms - used for cruise bodies (sets DDA_SUBSTEPS)
 #define MIN_BLOCK_MS                ((float)1.5)        // minimum block (whole move) milliseconds
 #define BLOCK_TIMEOUT_MS            ((float)30.0)       // MS before deciding there are no new blocks arriving
 #define PHAT_CITY_MS                ((float)100.0)      // if you have at least this much time in the planner
+#ifndef BACKPLAN_DEFER_MAX
+#define BACKPLAN_DEFER_MAX          ((uint8_t)8)        // new blocks that may share one back-planning pass (1 = never defer)
+#endif
+#define BLEND_COLINEAR_COSINE       ((float)0.99)       // G64 P corners turning less than ~8 degrees (or reversing) aren't blended
+
+// Meet velocity solver used by mp_calculate_ramps() for rate-limited (short) blocks
+#define MEET_SOLVER_NEWTON          0                   // Newton's method from a one-sided guess, up to 30 iterations
+#define MEET_SOLVER_BRACKETED       1                   // closed-form start, at most MEET_REFINEMENT_STEPS Newton steps
+#ifndef MEET_VELOCITY_SOLVER
+#define MEET_VELOCITY_SOLVER        MEET_SOLVER_BRACKETED
+#endif
+#ifndef MEET_REFINEMENT_STEPS
+#define MEET_REFINEMENT_STEPS       2                   // max Newton steps taken by the bracketed solver
+#endif
+
+// Segment interpolator used by the exec to step through head and tail velocity ramps
+#define SEGMENT_INTERPOLATOR_FLOAT  0                   // float forward differences of the velocity curve
+#define SEGMENT_INTERPOLATOR_FIXED  1                   // exact 64 bit integer differences of the position curve
+#ifndef SEGMENT_INTERPOLATOR
+#define SEGMENT_INTERPOLATOR        SEGMENT_INTERPOLATOR_FLOAT
+#endif
+#define FIXED_RAMP_SEGMENTS_MAX     ((uint32_t)1448)    // segments^6 must fit in an int64_t. Longer ramps use float
 
 #define NOM_SEGMENT_TIME            ((float)(NOM_SEGMENT_MS / 60000))       // DO NOT CHANGE - time in minutes
 #define NOM_SEGMENT_USEC            ((float)(NOM_SEGMENT_MS * 1000))        // DO NOT CHANGE - time in microseconds
 #define MIN_SEGMENT_TIME            ((float)(MIN_SEGMENT_MS / 60000))       // DO NOT CHANGE - time in minutes
+#define MAX_SEGMENT_TIME            ((float)(MAX_SEGMENT_MS / 60000))       // DO NOT CHANGE - time in minutes
+#define MAX_SEGMENT_USEC            ((float)(MAX_SEGMENT_MS * 1000))        // DO NOT CHANGE - time in microseconds
 #define MIN_BLOCK_TIME              ((float)(MIN_BLOCK_MS / 60000))         // DO NOT CHANGE - time in minutes
 #define PHAT_CITY_TIME              ((float)(PHAT_CITY_MS / 60000))         // DO NOT CHANGE - time in minutes
 
@@ -166,43 +195,69 @@ typedef enum {
 #define Veq2_lo 1.0
 #define VELOCITY_ROUGHLY_EQ(v0,v1) ( (v0 > Vthr2) ? fabs(v0-v1) < Veq2_hi : fabs(v0-v1) < Veq2_lo )
 
-//#define ASCII_ART(s)            xio_writeline(s)
-#define ASCII_ART(s)
 //#define UPDATE_BF_DIAGNOSTICS(bf) { bf->block_time_ms = bf->block_time*60000; bf->plannable_time_ms = bf->plannable_time*60000; }
 #define UPDATE_MP_DIAGNOSTICS     { mp.plannable_time_ms = mp.plannable_time*60000; }
 
+/* Planner profiling probes
+ *
+ *  A board that can time code defines MP_PROFILE_START(), MP_PROFILE_END(),
+ *  MP_PROFILE_BLOCK(), MP_PROFILE_BACKPLAN(), MP_PROFILE_COALESCE() and MP_PROFILE_BLEND() in its hardware.h
+ *  (see board/sim).
+ *  Otherwise they compile out.
+ */
+typedef enum {
+    MP_PROFILE_PLAN_BLOCK = 0,      // _plan_block() called from mp_plan_block_list()
+    MP_PROFILE_CALCULATE_RAMPS,     // mp_calculate_ramps() called from mp_plan_move()
+    MP_PROFILE_EXEC_ALINE,          // one segment of mp_exec_aline() called from mp_exec_move()
+    MP_PROFILE_PROBES               // count of probes
+} mpProfileProbe;
+
+#ifndef MP_PROFILE_START
+#define MP_PROFILE_START(probe)
+#define MP_PROFILE_END(probe)
+#define MP_PROFILE_BLOCK(bf)        // called with each buffer as it is freed
+#define MP_PROFILE_BACKPLAN(blocks, visited) // called after each back-planning pass
+#define MP_PROFILE_COALESCE()       // called for each line merged into the block before it
+#define MP_PROFILE_BLEND()          // called for each corner replaced by a blend arc
+#endif
+
 /*
  *    Planner structures
+ *
+ *  The planner buffer pool is kept as parallel arrays. mb.bf[] holds what the velocity planner works on,
+ *  with the fields read by the back-planning loop packed at the front. The Gcode state and
+ *  the axis vectors - needed only when a block is queued, at junctions and when it starts
+ *  to run - live in mb.gm[], mb.unit[] and mb.axis_flags[], at the same index as the
+ *  buffer (bf->buffer_number). Each buffer carries static pointers to its entries.
+ *
+ *  Arc blocks also keep their circle in mb.arc[]. The path is measured back from the end
+ *  of the arc, so a block cut short by a feedhold keeps its geometry and only its length
+ *  changes. For an arc bf->unit is the direction the arc starts in (see mp_arc()).
  */
 
+typedef struct mpArc {              // geometry of an arc block - see mp_arc_position()
+    float center_0;                 // center of circle at plane axis 0 (e.g. X for G17)
+    float center_1;                 // center of circle at plane axis 1 (e.g. Y for G17)
+    float radius;
+    float theta_end;                // angle at the end of the arc (same convention as plan_arc.cpp)
+    float theta_per_mm;             // angular travel per mm of path (signed)
+    float linear_end;               // linear axis position at the end of the arc
+    float linear_per_mm;            // linear travel per mm of path (signed)
+    uint8_t plane_axis_0;
+    uint8_t plane_axis_1;
+    uint8_t linear_axis;
+} mpArc_t;
+
 struct mpBuffer_to_clear {
     // Note: _clear_buffer() zeros all data from this point down
-    stat_t (*bf_func)(struct mpBuffer *bf); // callback to buffer exec function
-    cm_exec_t cm_func;              // callback to canonical machine execution function
-
-    //+++++ DIAGNOSTICS for easier debugging
-    uint32_t linenum;               // mirror of bf->gm.linenum
-    int iterations;
-    float block_time_ms;
-    float plannable_time_ms;        // time in planner
-    float plannable_length;         // length in planner
-    uint8_t meet_iterations;        // iterations needed in _get_meet_velocity
-    //+++++ to here
 
+    // read by the back-planning loop - keep these together
     bufferState buffer_state;       // used to manage queuing/dequeuing
     blockType block_type;           // used to dispatch to run routine
-    blockState block_state;         // move state machine sequence
     blockHint hint;                 // hint the block for zoid and other planning operations. Must be accurate or NO_HINT
-
-    // block parameters
-    float unit[AXES];               // unit vector for axis scaling & planning
-    bool axis_flags[AXES];          // set true for axes participating in the move & for command parameters
-
     bool plannable;                 // set true when this block can be used for planning
 
     float length;                   // total length of line or helix in mm
-    float block_time;               // computed move time for entire block (move)
-    float override_factor;          // feed rate or rapid override factor for this block ("override" is a reserved word)
 
     // We are removing all entry_* values.
     // To get the entry_* values, look at pv->exit_* or mr.exit_*
@@ -211,23 +266,36 @@ struct mpBuffer_to_clear {
     float cruise_velocity;          // cruise velocity requested & achieved
     float exit_velocity;            // exit velocity requested for the move
                                     // is also the entry velocity of the *next* move
-
-    float cruise_vset;              // cruise velocity requested for move - prior to overrides
     float cruise_vmax;              // cruise max velocity adjusted for overrides
     float exit_vmax;                // max exit velocity possible for this move
                                     // is also the maximum entry velocity of the next move
+    float jerk;                     // maximum linear jerk term for this move
+    int iterations;                 //+++++ DIAGNOSTIC - back-planning visits
 
+    // the rest of the velocity planning data
+    float cruise_vset;              // cruise velocity requested for move - prior to overrides
     float absolute_vmax;            // fastest this block can move w/o exceeding constraints
     float junction_vmax;            // maximum the exit velocity can be to go through the junction
                                     // between the NEXT BLOCK AND THIS ONE
+    float block_time;               // computed move time for entire block (move)
+    float override_factor;          // feed rate or rapid override factor for this block ("override" is a reserved word)
 
-    float jerk;                     // maximum linear jerk term for this move
     float jerk_sq;                  // Jm^2 is used for planning (computed and cached)
     float recip_jerk;               // 1/Jm used for planning (computed and cached)
     float sqrt_j;                   // sqrt(jM) used for planning (computed and cached)
     float q_recip_2_sqrt_j;         // (q/(2 sqrt(jM))) where q = (sqrt(10)/(3^(1/4))), used in length computations (computed and cached)
 
-    GCodeState_t gm;                // Gcode model state - passed from model, used by planner and runtime
+    blockState block_state;         // move state machine sequence
+    stat_t (*bf_func)(struct mpBuffer *bf); // callback to buffer exec function
+    cm_exec_t cm_func;              // callback to canonical machine execution function
+
+    //+++++ DIAGNOSTICS for easier debugging
+    uint32_t linenum;               // mirror of bf->gm->linenum
+    float block_time_ms;
+    float plannable_time_ms;        // time in planner
+    float plannable_length;         // length in planner
+    uint8_t meet_iterations;        // iterations needed by the meet velocity solver
+    //+++++ to here
 
     void clear() {
         memset((void *)(this), 0, sizeof(mpBuffer_to_clear));
@@ -236,22 +304,36 @@ struct mpBuffer_to_clear {
 
 typedef struct mpBuffer : mpBuffer_to_clear { // See Planning Velocity Notes for variable usage
 
-    // *** CAUTION *** These two pointers are not reset by _clear_buffer()
+    // *** CAUTION *** These pointers are not reset by _clear_buffer()
     struct mpBuffer *pv;            // static pointer to previous buffer
     struct mpBuffer *nx;            // static pointer to next buffer
-    uint8_t buffer_number;          //+++++ DIAGNOSTIC for easier debugging
+    GCodeState_t *gm;               // static pointer to Gcode model state - passed from model, used by planner and runtime
+    float *unit;                    // static pointer to unit vector for axis scaling & planning
+    bool *axis_flags;               // static pointer to flags set true for axes participating in the move & for command parameters
+    mpArc_t *arc;                   // static pointer to the arc geometry (arc blocks only)
+    uint16_t buffer_number;         // index of this buffer in the pool arrays
 } mpBuf_t;
 
-typedef struct mpBufferPool {       // ring buffer for sub-moves
+template <uint16_t _size>
+struct mpBufferPool {               // ring buffer for sub-moves
+    static_assert(_size > PLANNER_BUFFER_HEADROOM, "Planner pool must be larger than its headroom");
+    static constexpr uint16_t size = _size;     // number of buffers in the pool
+
     magic_t magic_start;            // magic number to test memory integrity
 
     mpBuf_t *r;                     // run buffer pointer
     mpBuf_t *w;                     // write buffer pointer
-    uint8_t buffers_available;      // running count of available buffers
-    mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage
+    uint16_t buffers_available;     // running count of available buffers
+    mpBuf_t bf[_size];              // buffer storage - velocity planning
+
+    GCodeState_t gm[_size];         // bf[i].gm
+    float unit[_size][AXES];        // bf[i].unit
+    bool axis_flags[_size][AXES];   // bf[i].axis_flags
+    mpArc_t arc[_size];             // bf[i].arc
 
     magic_t magic_end;
-} mpBufferPool_t;
+};
+typedef mpBufferPool<PLANNER_BUFFER_POOL_SIZE> mpBufferPool_t;
 
 typedef struct mpMotionPlannerSingleton {  // common variables for planning (move master)
     magic_t magic_start;            // magic number to test memory integrity
@@ -264,12 +346,14 @@ typedef struct mpMotionPlannerSingleton {  // common variables for planning (mov
     float position[AXES];           // final move position for planning purposes
 
     // timing variables
-    float run_time_remaining;       // time left in runtime (including running block)
+    float run_time_remaining;       // time left in runtime (including running block and all queued moves)
     float plannable_time;           // time in planner that can actually be planned
+    float queued_time;              // block_time of all queued moves (including the running block)
 
     // planner state variables
     plannerState planner_state;     // current state of planner
     bool request_planning;          // set true to request backplanning
+    uint16_t backplan_pending;      // blocks primed since the last back-planning pass
     bool backplanning;              // true if planner is in a back-planning pass
     bool mfo_active;                // true if mfo override is in effect
     bool ramp_active;               // true when a ramp is occurring
@@ -287,6 +371,8 @@ typedef struct mpMotionPlannerSingleton {  // common variables for planning (mov
     mpBuf_t *p;                     // planner buffer pointer
     mpBuf_t *c;                     // pointer to buffer immediately following critical region
     mpBuf_t *planning_return;       // buffer to return to once back-planning is complete
+    mpBuf_t *coalesce;              // newest block if mp_aline() may still extend it, otherwise NULL
+    float coalesce_deviation;       // worst case path deviation of the lines already merged into it
 
     magic_t magic_end;
 } mpMotionPlannerSingleton_t;
@@ -306,6 +392,26 @@ typedef struct mpBlockRuntimeBuf {  // Data structure for just the parts of RunT
     float exit_velocity;            // velocity at the end of the move
 } mpBlockRuntimeBuf_t;
 
+typedef struct mpSegmentRamp {      // interpolator state for one section - see mp_ramp_init_float()
+    float velocity;                 // velocity of the current segment
+    float distance;                 // fixed: distance from the start of the section to the end of the current segment
+    bool fixed;                     // true if the fixed point interpolator is running the section
+
+    float forward_diff_1;           // float: forward differences of the velocity, level 1..5
+    float forward_diff_2;
+    float forward_diff_3;
+    float forward_diff_4;
+    float forward_diff_5;
+
+    int64_t position;               // fixed: position numerator R(k) = k^4 (5n^2 - 6kn + 2k^2) at the current segment end
+    int64_t diff[6];                // fixed: forward differences of R, diff[0] is the next segment's R(k+1) - R(k)
+    uint32_t segment;               // fixed: segments run
+    float entry_velocity;           // fixed: velocity at the start of the ramp
+    float step_length;              // fixed: distance per segment at the entry velocity
+    float ramp_length;              // fixed: distance per unit of R (the velocity change's share)
+    float ramp_velocity;            // fixed: velocity per unit of R(k+1) - R(k)
+} mpSegmentRamp_t;
+
 typedef struct mpMotionRuntimeSingleton {    // persistent runtime variables
 //  uint8_t (*run_move)(struct mpMoveRuntimeSingleton *m); // currently running move - left in for reference
     magic_t magic_start;                // magic number to test memory integrity
@@ -319,6 +425,11 @@ typedef struct mpMotionRuntimeSingleton {    // persistent runtime variables
     float position[AXES];               // current move position
     float waypoint[SECTIONS][AXES];     // head/body/tail endpoints for correction
 
+    blockType block_type;               // BLOCK_TYPE_ALINE or BLOCK_TYPE_ARC
+    mpArc_t arc;                        // geometry of the running arc
+    float path_remaining;               // path length left in the running arc
+    float waypoint_remaining[SECTIONS]; // path length left at the head/body/tail ends
+
     float target_steps[MOTORS];         // current MR target (absolute target as steps)
     float position_steps[MOTORS];       // current MR position (target from previous segment)
     float commanded_steps[MOTORS];      // will align with next encoder sample (target from 2nd previous segment)
@@ -336,11 +447,9 @@ typedef struct mpMotionRuntimeSingleton {    // persistent runtime variables
     float segment_velocity;             // computed velocity for aline segment
     float segment_time;                 // actual time increment per aline segment
 
-    float forward_diff_1;               // forward difference level 1
-    float forward_diff_2;               // forward difference level 2
-    float forward_diff_3;               // forward difference level 3
-    float forward_diff_4;               // forward difference level 4
-    float forward_diff_5;               // forward difference level 5
+    mpSegmentRamp_t ramp;               // segment interpolator for the running section
+    float section_start[AXES];          // position at the start of the running section
+    float section_path_start;           // path_remaining at the start of the running section (arcs)
 
     GCodeState_t gm;                    // gcode model state currently executing
 
@@ -381,8 +490,10 @@ void mp_request_out_of_band_dwell(float seconds);
 stat_t mp_exec_out_of_band_dwell(void);
 
 // planner functions and helpers
-uint8_t mp_get_planner_buffers(void);
+uint16_t mp_get_planner_buffers(void);
 bool mp_planner_is_full(void);
+bool mp_planner_admits_input(void);
+uint32_t mp_get_planner_queued_ms(void);
 bool mp_has_runnable_buffer(void);
 bool mp_is_phat_city_time(void);
 
@@ -391,6 +502,8 @@ void mp_replan_queue(mpBuf_t *bf);
 void mp_start_feed_override(const float ramp_time, const float override);
 void mp_end_feed_override(const float ramp_time);
 void mp_planner_time_accounting(void);
+void mp_add_block_time(const mpBuf_t *bf, const float block_time);
+void mp_set_unplannable(mpBuf_t *bf);
 
 // planner buffer primitives
 void mp_init_buffers(void);
@@ -399,6 +512,7 @@ void mp_init_buffers(void);
 //mpBuf_t * mp_get_next_buffer(const mpBuf_t *bf);      // Use the following macro instead
 #define mp_get_prev_buffer(b) ((mpBuf_t *)(b->pv))
 #define mp_get_next_buffer(b) ((mpBuf_t *)(b->nx))
+#define mp_is_aline_type(t) (((t) == BLOCK_TYPE_ALINE) || ((t) == BLOCK_TYPE_ARC))  // blocks run by mp_exec_aline()
 
 mpBuf_t * mp_get_write_buffer(void);
 void mp_commit_write_buffer(const blockType block_type);
@@ -415,6 +529,9 @@ bool mp_get_runtime_busy(void);
 bool mp_runtime_is_idle(void);
 
 stat_t mp_aline(GCodeState_t *gm_in);                   // line planning...
+stat_t mp_arc(GCodeState_t *gm_in, const mpArc_t *arc, const float length); // arc planning...
+void mp_arc_position(const mpArc_t *arc, const float remaining, float position[]);
+void mp_arc_direction(const mpArc_t *arc, const float remaining, float unit[]);
 void mp_plan_block_list(void);
 void mp_plan_block_forward(mpBuf_t *bf);
 
@@ -423,6 +540,8 @@ void mp_calculate_ramps(mpBlockRuntimeBuf_t *block, mpBuf_t *bf, const float ent
 float mp_get_target_length(const float v_0, const float v_1, const mpBuf_t *bf);
 float mp_get_target_velocity(const float v_0, const float L, const mpBuf_t *bf); // acceleration ONLY
 float mp_get_decel_velocity(const float v_0, const float L, const mpBuf_t *bf); // decelleration ONLY
+float mp_get_meet_velocity_newton(const float v_0, const float v_2, const float L, mpBuf_t *bf, mpBlockRuntimeBuf_t *block);
+float mp_get_meet_velocity_bracketed(const float v_0, const float v_2, const float L, mpBuf_t *bf, mpBlockRuntimeBuf_t *block);
 float mp_find_t(const float v_0, const float v_1, const float L, const float totalL, const float initial_t, const float T);
 
 float mp_calc_v(const float t, const float v_0, const float v_1);                // compute the velocity along the curve accelerating from v_0 to v_1, at position t=[0,1]
@@ -435,6 +554,12 @@ stat_t mp_exec_move(void);
 stat_t mp_plan_move(void);
 stat_t mp_exec_aline(mpBuf_t *bf);
 void mp_exit_hold_state(void);
+void mp_reset_step_history(const float steps[]);
+
+void mp_ramp_init_float(mpSegmentRamp_t *ramp, const float v_0, const float v_1, const float segments);
+void mp_ramp_next_float(mpSegmentRamp_t *ramp);
+bool mp_ramp_init_fixed(mpSegmentRamp_t *ramp, const float v_0, const float v_1, const float segment_time, const uint32_t segments);
+void mp_ramp_next_fixed(mpSegmentRamp_t *ramp);
 
 void mp_dump_planner(mpBuf_t *bf_start);
 
@@ -0,0 +1,112 @@
+/*
+ * profile.cpp - latency profile of the interrupts and the main loop
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2026 g2core contributors
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "planner.h"
+#include "profile.h"
+#include "text_parser.h"
+#include "xio.h"
+
+#if PF_ENABLE
+
+pfProfile_t pf;
+
+static const char *const pf_stage_names[PF_STAGES] = { "exec", "plan", "load", "dda", "main" };
+
+/*
+ * profile_init() - start the clock and clear the profile
+ */
+
+void profile_init()
+{
+    PF_CLOCK_INIT();
+    pf_clear(NULL);
+}
+
+/*
+ * pf_dump()  - $prof - write the profile as JSON, one line per stage
+ * pf_clear() - $prc  - clear the profile
+ *
+ *  The dump starts with a header line, then has a line for each stage:
+ *
+ *    {"pfh":{"ver":1,"hz":84000000,"bins":24}}
+ *    {"pf":{"stage":"exec","n":N,"min_us":x,"mean_us":x,"max_us":x,"budget_us":x,"max_pct":x,"hist":[...]}}
+ *
+ *  "hz" is the profile clock. hist[n] counts runs of 2^n to 2^(n+1)-1 ticks of it, and the
+ *  last bin everything longer. budget_us is the time the stage has to fit in - a DDA tick
+ *  for the DDA interrupt, a nominal segment for the others - and max_pct is how much of it
+ *  the longest run took. The command returns the number of stages written.
+ */
+
+stat_t pf_dump(nvObj_t *nv)
+{
+    char buf[128 + (PF_HISTOGRAM_BINS * 11)];
+    const float us_per_tick = 1000000.0 / PF_CLOCK_HZ;
+
+    pf.suspended = true;                        // hold the stats still while they're written out
+    sprintf(buf, "{\"pfh\":{\"ver\":%d,\"hz\":%lu,\"bins\":%d}}\n",
+            PF_VERSION, (unsigned long)PF_CLOCK_HZ, PF_HISTOGRAM_BINS);
+    xio_writeline(buf);
+
+    for (uint8_t i = 0; i < PF_STAGES; i++) {
+        const pfStageStats_t *s = &pf.stage[i];
+        const float budget_us = (i == PF_DDA) ? (1000000.0 / FREQUENCY_DDA) : NOM_SEGMENT_USEC;
+        const float max_us = s->max * us_per_tick;
+        char *p = buf + sprintf(buf, "{\"pf\":{\"stage\":\"%s\",\"n\":%lu,\"min_us\":%0.3f,\"mean_us\":%0.3f,"
+                                     "\"max_us\":%0.3f,\"budget_us\":%0.3f,\"max_pct\":%0.2f,\"hist\":[",
+                                pf_stage_names[i], (unsigned long)s->count,
+                                (double)((s->count == 0) ? 0 : (s->min * us_per_tick)),
+                                (double)((s->count == 0) ? 0 : ((float)s->total / s->count * us_per_tick)),
+                                (double)max_us, (double)budget_us, (double)(max_us / budget_us * 100));
+        for (uint8_t bin = 0; bin < PF_HISTOGRAM_BINS; bin++) {
+            p += sprintf(p, (bin == 0) ? "%lu" : ",%lu", (unsigned long)s->histogram[bin]);
+        }
+        sprintf(p, "]}}\n");
+        xio_writeline(buf);
+    }
+    pf.suspended = false;
+
+    nv->value = (float)PF_STAGES;
+    nv->valuetype = TYPE_INT;
+    return (STAT_OK);
+}
+
+stat_t pf_clear(nvObj_t *nv)
+{
+    pf.suspended = true;
+    memset(pf.stage, 0, sizeof(pf.stage));
+    for (uint8_t i = 0; i < PF_STAGES; i++) {
+        pf.stage[i].min = 0xFFFFFFFF;
+    }
+    pf.suspended = false;
+    return (STAT_OK);
+}
+
+/*********************
+ * TEXT MODE SUPPORT *
+ *********************/
+#ifdef __TEXT_MODE
+
+static const char fmt_prof[] = "profile stages: %d\n";
+void pf_print_prof(nvObj_t *nv) { text_print(nv, fmt_prof);}   // TYPE_INT
+
+#endif // __TEXT_MODE
+
+#endif // PF_ENABLE
@@ -0,0 +1,129 @@
+/*
+ * profile.h - latency profile of the interrupts and the main loop
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2026 g2core contributors
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ *  The profile times each run of the stages that have to keep up with the machine: the
+ *  exec interrupt (mp_exec_move() and the prep), the forward plan interrupt (mp_plan_move()),
+ *  the loader (_load_move()), the DDA interrupt and one pass of the main loop. Each stage
+ *  keeps a count, min, max and total, and a histogram of log2 clock ticks. A time includes
+ *  any higher priority interrupt that preempted the stage, so it is how long the stage
+ *  took to finish, which is what the segment budget is spent on.
+ *
+ *  $prof writes the stages as JSON lines (see profile.cpp) and $prc clears them.
+ *
+ *  A board turns it on by defining PF_ENABLE 1 in its hardware.h. The clock is the
+ *  Cortex-M DWT cycle counter unless the board supplies PF_CLOCK() (the sim uses the host
+ *  clock). With PF_ENABLE at 0 the PF_START() and PF_END() calls compile out and the
+ *  commands are not in the config table.
+ */
+
+#ifndef PROFILE_H_ONCE
+#define PROFILE_H_ONCE
+
+#include "g2core.h"
+#include "config.h"
+#include "hardware.h"
+
+#ifndef PF_ENABLE
+#define PF_ENABLE           0                   // 1 profiles the interrupts and the main loop (see above)
+#endif
+#ifndef PF_CLOCK                                // Cortex-M cycle counter
+#define PF_CLOCK()          (DWT->CYCCNT)
+#define PF_CLOCK_HZ         (SystemCoreClock)
+#define PF_CLOCK_INIT()     { CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; DWT->CYCCNT = 0; DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; }
+#endif
+
+#define PF_HISTOGRAM_BINS   24                  // bin n counts times of 2^n to 2^(n+1)-1 clock ticks. The last takes the rest
+#define PF_VERSION          1                   // bump if the $prof format changes
+
+typedef enum {
+    PF_EXEC = 0,                    // exec interrupt
+    PF_PLAN,                        // forward plan interrupt
+    PF_LOAD,                        // _load_move(), from any of its callers
+    PF_DDA,                         // DDA interrupt, one tick (or one segment with step bitmaps)
+    PF_MAIN,                        // one pass of the controller
+    PF_STAGES                       // count of stages
+} pfStage;
+
+typedef struct pfStageStats {
+    uint32_t count;                 // runs since the last clear
+    uint32_t min;                   // clock ticks
+    uint32_t max;
+    uint64_t total;
+    uint32_t histogram[PF_HISTOGRAM_BINS];
+} pfStageStats_t;
+
+typedef struct pfProfile {
+    volatile bool suspended;        // set while dumping or clearing
+    pfStageStats_t stage[PF_STAGES];
+} pfProfile_t;
+
+#if PF_ENABLE
+
+extern pfProfile_t pf;
+
+/*
+ * pf_record() - add one run to a stage's stats
+ *
+ *  Each stage has one writer, except PF_LOAD: the loader runs from the load interrupt
+ *  (medium) and from the DDA and dwell interrupts (highest), which can preempt it part
+ *  way through the update. So PF_LOAD is recorded with interrupts masked. The compare
+ *  against a constant stage folds away for the other stages.
+ */
+inline void pf_record(const uint8_t stage, const uint32_t ticks)
+{
+    if (stage == PF_LOAD) {
+        __disable_irq();
+    }
+    if (!pf.suspended) {
+        pfStageStats_t *s = &pf.stage[stage];
+        uint8_t bin = 31 - __builtin_clz(ticks | 1);
+        s->histogram[(bin < PF_HISTOGRAM_BINS) ? bin : (PF_HISTOGRAM_BINS - 1)]++;
+        s->count++;
+        s->total += ticks;
+        if (ticks < s->min) { s->min = ticks; }
+        if (ticks > s->max) { s->max = ticks; }
+    }
+    if (stage == PF_LOAD) {
+        __enable_irq();
+    }
+}
+
+#define PF_START(stage)     const uint32_t stage##_start = PF_CLOCK()
+#define PF_END(stage)       pf_record(stage, PF_CLOCK() - stage##_start)
+
+void profile_init(void);
+stat_t pf_dump(nvObj_t *nv);
+stat_t pf_clear(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+    void pf_print_prof(nvObj_t *nv);
+#else
+    #define pf_print_prof tx_print_stub
+#endif // __TEXT_MODE
+
+#else
+
+#define PF_START(stage)
+#define PF_END(stage)
+
+inline void profile_init(void) {}
+
+#endif // PF_ENABLE
+
+#endif // End of include guard: PROFILE_H_ONCE
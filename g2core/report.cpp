@@ -529,20 +529,29 @@ stat_t qr_queue_report_callback()         // called by controller dispatcher
 
     qr.queue_report_requested = false;
 
-    char report[32];    // we know these reports can't be longer than 30 bytes
+    char report[64];    // we know these reports can't be longer than 60 bytes
+    int n;
 
     if (cs.comm_mode == TEXT_MODE) {
         if (qr.queue_report_verbosity == QR_SINGLE) {
-            sprintf(report, "qr:%d\n", qr.buffers_available);
+            n = sprintf(report, "qr:%d", qr.buffers_available);
         } else  {
-            sprintf(report, "qr:%d, qi:%d, qo:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
+            n = sprintf(report, "qr:%d, qi:%d, qo:%d", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
         }
+        if (cm.planner_lookahead_ms != 0) {         // only report queued time if admission is time-based
+            n += sprintf(report+n, ", qt:%lu, qq:%lu", (unsigned long)cm.planner_lookahead_ms, (unsigned long)mp_get_planner_queued_ms());
+        }
+        strcpy(report+n, "\n");
     } else {
         if (qr.queue_report_verbosity == QR_SINGLE) {
-            sprintf(report, "{\"qr\":%d}\n", qr.buffers_available);
+            n = sprintf(report, "{\"qr\":%d", qr.buffers_available);
         } else {
-            sprintf(report, "{\"qr\":%d,\"qi\":%d,\"qo\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+            n = sprintf(report, "{\"qr\":%d,\"qi\":%d,\"qo\":%d", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+        }
+        if (cm.planner_lookahead_ms != 0) {
+            n += sprintf(report+n, ",\"qt\":%lu,\"qq\":%lu", (unsigned long)cm.planner_lookahead_ms, (unsigned long)mp_get_planner_queued_ms());
         }
+        strcpy(report+n, "}\n");
     }
     xio_writeline(report);
     qr_init_queue_report();
@@ -571,6 +580,7 @@ stat_t qr_queue_report_callback()         // called by controller dispatcher
  * qr_get() - run a queue report (as data)
  * qi_get() - run a queue report - buffers in
  * qo_get() - run a queue report - buffers out
+ * qq_get() - run a queue report - motion time queued in the planner (ms)
  */
 stat_t qr_get(nvObj_t *nv)
 {
@@ -595,6 +605,13 @@ stat_t qo_get(nvObj_t *nv)
     return (STAT_OK);
 }
 
+stat_t qq_get(nvObj_t *nv)
+{
+    nv->value = (float)mp_get_planner_queued_ms();
+    nv->valuetype = TYPE_INT;
+    return (STAT_OK);
+}
+
 /*****************************************************************************
  * JOB ID REPORTS
  *
@@ -674,11 +691,15 @@ void job_print_job(nvObj_t *nv) { job_populate_job_report();}
 static const char fmt_qr[] = "qr:%d\n";
 static const char fmt_qi[] = "qi:%d\n";
 static const char fmt_qo[] = "qo:%d\n";
+static const char fmt_qq[] = "qq:%d ms\n";
 static const char fmt_qv[] = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple]\n";
+static const char fmt_qt[] = "[qt]  queue lookahead time%9d ms [0=block count only]\n";
 
 void qr_print_qr(nvObj_t *nv) { text_print(nv, fmt_qr);}    // TYPE_INT
 void qr_print_qi(nvObj_t *nv) { text_print(nv, fmt_qi);}    // TYPE_INT
 void qr_print_qo(nvObj_t *nv) { text_print(nv, fmt_qo);}    // TYPE_INT
+void qr_print_qq(nvObj_t *nv) { text_print(nv, fmt_qq);}    // TYPE_INT
 void qr_print_qv(nvObj_t *nv) { text_print(nv, fmt_qv);}    // TYPE_INT
+void qr_print_qt(nvObj_t *nv) { text_print(nv, fmt_qt);}    // TYPE_INT
 
 #endif // __TEXT_MODE
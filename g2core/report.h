@@ -80,8 +80,8 @@ typedef struct qrSingleton {        // data for queue reports
 
     /*** runtime values (PRIVATE) ***/
     uint8_t queue_report_requested;         // set to true to request a report
-    uint8_t buffers_available;              // stored buffer depth passed to by callback
-    uint8_t prev_available;                 // buffers available at last count
+    uint16_t buffers_available;             // stored buffer depth passed to by callback
+    uint16_t prev_available;                // buffers available at last count
     uint16_t buffers_added;                 // buffers added since last count
     uint16_t buffers_removed;               // buffers removed since last report
     uint8_t motion_mode;                    // used to detect arc movement
@@ -124,6 +124,7 @@ stat_t rx_report_callback(void);
 stat_t qr_get(nvObj_t *nv);
 stat_t qi_get(nvObj_t *nv);
 stat_t qo_get(nvObj_t *nv);
+stat_t qq_get(nvObj_t *nv);
 
 #ifdef __TEXT_MODE
 
@@ -134,6 +135,8 @@ stat_t qo_get(nvObj_t *nv);
     void qr_print_qr(nvObj_t *nv);
     void qr_print_qi(nvObj_t *nv);
     void qr_print_qo(nvObj_t *nv);
+    void qr_print_qq(nvObj_t *nv);
+    void qr_print_qt(nvObj_t *nv);
 
 #else
 
@@ -144,6 +147,8 @@ stat_t qo_get(nvObj_t *nv);
     #define qr_print_qr tx_print_stub
     #define qr_print_qi tx_print_stub
     #define qr_print_qo tx_print_stub
+    #define qr_print_qq tx_print_stub
+    #define qr_print_qt tx_print_stub
 
 #endif // __TEXT_MODE
 
@@ -66,6 +66,37 @@
 #define CHORDAL_TOLERANCE           0.01    // {ct: chordal tolerance for arcs (in mm)
 #endif
 
+#ifndef COALESCE_TOLERANCE
+#define COALESCE_TOLERANCE          0       // {lct: path deviation allowed when merging colinear feeds (in mm), 0=off
+#endif
+
+#ifndef STEP_RATE_LIMIT
+#define STEP_RATE_LIMIT             0.90    // {srl: fastest any motor may step, as a fraction of FREQUENCY_DDA, 0=off
+#endif
+
+#ifndef PLANNER_LOOKAHEAD_MS
+#define PLANNER_LOOKAHEAD_MS        0       // {qt: motion time to queue before holding off input (ms), 0=block count only
+#endif
+
+#ifndef MESH_ORIGIN_X
+#define MESH_ORIGIN_X               0       // {zmx: machine X of the Z compensation grid's first node
+#endif
+#ifndef MESH_ORIGIN_Y
+#define MESH_ORIGIN_Y               0       // {zmy: machine Y of the first node
+#endif
+#ifndef MESH_SPACING_X
+#define MESH_SPACING_X              50      // {zmdx: mm between nodes in X
+#endif
+#ifndef MESH_SPACING_Y
+#define MESH_SPACING_Y              50      // {zmdy: mm between nodes in Y
+#endif
+#ifndef MESH_COUNT_X
+#define MESH_COUNT_X                3       // {zmnx: nodes in X, 2 to 16
+#endif
+#ifndef MESH_COUNT_Y
+#define MESH_COUNT_Y                3       // {zmny: nodes in Y, 2 to 16
+#endif
+
 #ifndef MOTOR_POWER_TIMEOUT
 #define MOTOR_POWER_TIMEOUT         2.00    // {mt:  motor power timeout in seconds
 #endif
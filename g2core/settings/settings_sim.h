@@ -0,0 +1,137 @@
+/*
+ * settings_sim.h - host simulator profile
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ * Copyright (c) 2016 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/***********************************************************************/
+/**** Host simulator profile *******************************************/
+/***********************************************************************/
+
+// A generic 4 axis (XYZA) mill for the host simulator (make CONFIG=Sim).
+// Motion values are chosen to be typical of a small router, not any one machine,
+// so that planner and stepper measurements taken on the sim are representative.
+
+// ***> NOTE: The init message must be a single line with no CRs or LFs
+#define INIT_MESSAGE "Initializing configs to host simulator profile"
+
+//**** GLOBAL / GENERAL SETTINGS ******************************************************
+
+// Machine configuration settings
+
+#define JUNCTION_INTEGRATION_TIME   0.75                    // cornering - between 0.10 and 2.00 (higher is faster)
+#define CHORDAL_TOLERANCE           0.01                    // chordal tolerance for arcs (in mm)
+
+#define SOFT_LIMIT_ENABLE           0                       // 0=off, 1=on
+#define HARD_LIMIT_ENABLE           0                       // 0=off, 1=on
+#define SAFETY_INTERLOCK_ENABLE     0                       // 0=off, 1=on - the sim has no interlock switch
+
+// Communications and reporting settings
+
+#define COMM_MODE                   JSON_MODE               // one of: TEXT_MODE, JSON_MODE
+#define XIO_ENABLE_FLOW_CONTROL     FLOW_CONTROL_OFF        // FLOW_CONTROL_OFF, FLOW_CONTROL_RTS
+
+#define JSON_VERBOSITY              JV_MESSAGES             // one of: JV_SILENT, JV_FOOTER, JV_CONFIGS, JV_MESSAGES, JV_LINENUM, JV_VERBOSE
+#define QUEUE_REPORT_VERBOSITY      QR_OFF                  // one of: QR_OFF, QR_SINGLE, QR_TRIPLE
+#define STATUS_REPORT_VERBOSITY     SR_FILTERED             // one of: SR_OFF, SR_FILTERED, SR_VERBOSE
+
+#define STATUS_REPORT_DEFAULTS "line","posx","posy","posz","posa","feed","vel","momo","stat"
+
+// Gcode startup defaults
+#define GCODE_DEFAULT_UNITS         MILLIMETERS             // MILLIMETERS or INCHES
+#define GCODE_DEFAULT_PLANE         CANON_PLANE_XY          // CANON_PLANE_XY, CANON_PLANE_XZ, or CANON_PLANE_YZ
+#define GCODE_DEFAULT_COORD_SYSTEM  G54                     // G54, G55, G56, G57, G58 or G59
+#define GCODE_DEFAULT_PATH_CONTROL  PATH_CONTINUOUS
+#define GCODE_DEFAULT_DISTANCE_MODE ABSOLUTE_MODE
+
+// *** motor settings ************************************************************************************
+
+#define MOTOR_POWER_MODE            MOTOR_POWERED_IN_CYCLE  // default motor power mode (see cmMotorPowerMode in stepper.h)
+#define MOTOR_POWER_TIMEOUT         2.00                    // motor power timeout in seconds
+
+#define M1_MOTOR_MAP                AXIS_X                  // 1ma
+#define M1_STEP_ANGLE               1.8                     // 1sa
+#define M1_TRAVEL_PER_REV           40.00                   // 1tr
+#define M1_MICROSTEPS               8                       // 1mi  1,2,4,8,16,32
+#define M1_POLARITY                 0                       // 1po  0=normal, 1=reversed
+#define M1_POWER_MODE               MOTOR_POWER_MODE        // 1pm  TRUE=low power idle enabled
+
+#define M2_MOTOR_MAP                AXIS_Y
+#define M2_STEP_ANGLE               1.8
+#define M2_TRAVEL_PER_REV           40.00
+#define M2_MICROSTEPS               8
+#define M2_POLARITY                 0
+#define M2_POWER_MODE               MOTOR_POWER_MODE
+
+#define M3_MOTOR_MAP                AXIS_Z
+#define M3_STEP_ANGLE               1.8
+#define M3_TRAVEL_PER_REV           8.00
+#define M3_MICROSTEPS               8
+#define M3_POLARITY                 0
+#define M3_POWER_MODE               MOTOR_POWER_MODE
+
+#define M4_MOTOR_MAP                AXIS_A
+#define M4_STEP_ANGLE               1.8
+#define M4_TRAVEL_PER_REV           360                     // degrees moved per motor rev
+#define M4_MICROSTEPS               8
+#define M4_POLARITY                 0
+#define M4_POWER_MODE               MOTOR_POWER_MODE
+
+// *** axis settings **********************************************************************************
+
+#define JERK_MAX                    5000
+
+#define X_AXIS_MODE                 AXIS_STANDARD           // xam  see canonical_machine.h cmAxisMode for valid values
+#define X_VELOCITY_MAX              20000                   // xvm  G0 max velocity in mm/min
+#define X_FEEDRATE_MAX              X_VELOCITY_MAX          // xfr  G1 max feed rate in mm/min
+#define X_TRAVEL_MIN                0                       // xtn  minimum travel for soft limits
+#define X_TRAVEL_MAX                600                     // xtm  travel between switches or crashes
+#define X_JERK_MAX                  JERK_MAX                // xjm  jerk * 1,000,000
+#define X_JERK_HIGH_SPEED           20000                   // xjh
+
+#define Y_AXIS_MODE                 AXIS_STANDARD
+#define Y_VELOCITY_MAX              20000
+#define Y_FEEDRATE_MAX              Y_VELOCITY_MAX
+#define Y_TRAVEL_MIN                0
+#define Y_TRAVEL_MAX                600
+#define Y_JERK_MAX                  JERK_MAX
+#define Y_JERK_HIGH_SPEED           20000
+
+#define Z_AXIS_MODE                 AXIS_STANDARD
+#define Z_VELOCITY_MAX              2000
+#define Z_FEEDRATE_MAX              Z_VELOCITY_MAX
+#define Z_TRAVEL_MAX                0
+#define Z_TRAVEL_MIN                -100
+#define Z_JERK_MAX                  500
+#define Z_JERK_HIGH_SPEED           1000
+
+#define A_AXIS_MODE                 AXIS_STANDARD
+#define A_VELOCITY_MAX              36000                   // degrees per minute
+#define A_FEEDRATE_MAX              A_VELOCITY_MAX
+#define A_TRAVEL_MIN                -1
+#define A_TRAVEL_MAX                -1
+#define A_JERK_MAX                  24000
+#define A_JERK_HIGH_SPEED           A_JERK_MAX
+#define A_RADIUS                    1.0
@@ -34,7 +34,9 @@
 #include "stepper.h"
 #include "encoder.h"
 #include "planner.h"
+#include "kinematics.h"
 #include "hardware.h"
+#include "profile.h"
 #include "text_parser.h"
 #include "util.h"
 #include "controller.h"
@@ -49,6 +51,8 @@ static stRunSingleton_t st_run;
 /**** Static functions ****/
 
 static void _load_move(void);
+static bool _prep_has_room(void);
+static void _prep_commit(void);
 
 // handy macro
 //#define _f_to_period(f) (uint16_t)((float)F_CPU / (float)f)
@@ -111,7 +115,7 @@ void stepper_init()
 
     // setup software interrupt exec timer & initial condition
     exec_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityLow);
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;
+    st_pre.low_water = PREP_BUFFER_SIZE;
 
     // setup software interrupt forward plan timer & initial condition
     fwd_plan_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityLowest);
@@ -135,13 +139,23 @@ void stepper_reset()
 {
     dda_timer.stop();                                   // stop all movement
     dwell_timer.stop();
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    board_step_dma_stop();
+    st_pre.bitmaps_played = st_pre.bitmaps_prepped;     // drop the bitmaps with the segments
+#endif
     st_run.dda_ticks_downcount = 0;                     // signal the runtime is not busy
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // set to EXEC or it won't restart
+    st_run.dwell_ticks_downcount = 0;
+    st_pre.read_index = st_pre.write_index;             // empty the prep ring or it won't restart
+    for (uint8_t i=0; i<PREP_BUFFER_SIZE; i++) {
+        st_pre.buf[i].block_type = BLOCK_TYPE_NULL;
+    }
 
     for (uint8_t motor=0; motor<MOTORS; motor++) {
         st_pre.mot[motor].prev_direction = STEP_INITIAL_DIRECTION;
-        st_pre.mot[motor].direction = STEP_INITIAL_DIRECTION;
         st_run.mot[motor].substep_accumulator = 0;      // will become max negative during per-motor setup;
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+        st_pre.mot[motor].substep_accumulator = 0;
+#endif
         st_pre.mot[motor].corrected_steps = 0;          // diagnostic only - no action effect
     }
     mp_set_steps_to_runtime_position();                 // reset encoder to agree with the above
@@ -179,7 +193,16 @@ stat_t stepper_test_assertions()
 
 bool st_runtime_isbusy()
 {
-    return (st_run.dda_ticks_downcount);    // returns false if down count is zero
+    return (st_run.dda_ticks_downcount || st_run.dwell_ticks_downcount);    // returns false if both down counts are zero
+}
+
+/*
+ * st_get_lines_loaded() - count of line segments handed to the DDA since reset
+ */
+
+uint32_t st_get_lines_loaded()
+{
+    return (st_pre.lines_loaded);
 }
 
 /*
@@ -189,6 +212,8 @@ bool st_runtime_isbusy()
 stat_t st_clc(nvObj_t *nv)    // clear diagnostic counters, reset stepper prep
 {
     stepper_reset();
+    st_pre.high_water = 0;
+    st_pre.low_water = PREP_BUFFER_SIZE;
     return(STAT_OK);
 }
 
@@ -204,7 +229,7 @@ stat_t st_motor_power_callback()     // called by controller
     }
 
     bool have_actually_stopped = false;
-    if ((!st_runtime_isbusy()) && (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER)) {    // if there are no moves to load...
+    if ((!st_runtime_isbusy()) && (st_pre.write_index == st_pre.read_index)) {    // if there are no moves to load...
         have_actually_stopped = true;
     }
 
@@ -234,14 +259,63 @@ stat_t st_motor_power_callback()     // called by controller
  *
  *  Note that the motor_N.step.isNull() tests are compile-time tests, not run-time tests.
  *  If motor_N is not defined that if{} clause (i.e. that motor) drops out of the complied code.
+ *
+ *  With DDA_KERNEL_PACKED (see stepper.h) the channels are run by _dda_step(), which
+ *  returns the motor's bit in the step mask instead of setting its step pin.
+ */
+
+#ifndef DDA_KERNEL
+#define DDA_KERNEL DDA_KERNEL_BRANCHED
+#endif
+#if (DDA_KERNEL == DDA_KERNEL_PACKED) && !defined(BOARD_STEP_PORTS)
+#error "DDA_KERNEL_PACKED needs a board that defines BOARD_STEP_PORTS (see stepper.h)"
+#endif
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP) && !defined(BOARD_STEP_DMA)
+#error "DDA_KERNEL_BITMAP needs a board that defines BOARD_STEP_DMA (see stepper.h)"
+#endif
+
+#if (DDA_KERNEL == DDA_KERNEL_PACKED)
+static inline uint32_t _dda_step(const uint8_t motor)
+{
+    int32_t accumulator = st_run.mot[motor].substep_accumulator + st_run.mot[motor].substep_increment;
+    uint32_t step = (accumulator > 0);                      // compiles to a compare and set, not a branch
+    st_run.mot[motor].substep_accumulator = accumulator - (int32_t)(st_run.dda_ticks_X_substeps & (0 - step));
+    INCREMENT_ENCODER_BY(motor, step);
+    return (step << motor);
+}
+#endif
+
+/*
+ *  With DDA_KERNEL_BITMAP the DMA plays the ticks and the DDA interrupt is pended by the
+ *  board at the end of each bitmap. All that is left for it is the end of segment.
  */
 
 namespace Motate {            // Must define timer interrupts inside the Motate namespace
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+template<>
+void dda_timer_type::interrupt()
+{
+    dda_timer.getInterruptCause();        // clear interrupt condition
+    PF_START(PF_DDA);
+
+    st_pre.bitmaps_played++;              // hand the bitmap back to the prep
+    st_run.dda_ticks_downcount = 0;
+    if (mr.block_state != BLOCK_INACTIVE) {  // mid-move, so the ring should not be empty
+        st_pre.low_water = min(st_pre.low_water, (uint8_t)(st_pre.write_index - st_pre.read_index));
+    }
+    _load_move();                         // load the next move at the current interrupt level
+    PF_END(PF_DDA);
+}
+#else
 template<>
 void dda_timer_type::interrupt()
 {
     dda_timer.getInterruptCause();        // clear interrupt condition
+    PF_START(PF_DDA);
 
+#if (DDA_KERNEL == DDA_KERNEL_PACKED)
+    board_step_end();                     // clear all steps from the previous interrupt
+#else
     // clear all steps from the previous interrupt
 	// for (uint8_t motor=0; motor<MOTORS; motor++) {
 	//	  Motors[motor]->stepEnd();
@@ -260,14 +334,33 @@ void dda_timer_type::interrupt()
 #endif
 #if MOTORS > 5
     motor_6.stepEnd();
+#endif
 #endif
 
     // process last DDA tick after end of segment
     if (st_run.dda_ticks_downcount == 0) {
         dda_timer.stop(); // turn it off or it will keep stepping out the last segment
+        PF_END(PF_DDA);
         return;
     }
 
+#if (DDA_KERNEL == DDA_KERNEL_PACKED)
+    // process DDAs for all motors into one step bitmask and set the step pins with it
+    uint32_t steps = _dda_step(MOTOR_1) | _dda_step(MOTOR_2);
+#if MOTORS > 2
+    steps |= _dda_step(MOTOR_3);
+#endif
+#if MOTORS > 3
+    steps |= _dda_step(MOTOR_4);
+#endif
+#if MOTORS > 4
+    steps |= _dda_step(MOTOR_5);
+#endif
+#if MOTORS > 5
+    steps |= _dda_step(MOTOR_6);
+#endif
+    board_step_start(steps);
+#else
 //  The following code would work, but it's faster to loop unroll it
 //    for (uint8_t motor=0; motor<MOTORS; motor++) {
 //        if  ((st_run.mot[motor].substep_accumulator += st_run.mot[motor].substep_increment) > 0) {
@@ -315,13 +408,19 @@ void dda_timer_type::interrupt()
             st_run.mot[MOTOR_6].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_6);
         }
+#endif
 #endif
 
     // process end of segment
     if (--st_run.dda_ticks_downcount == 0) {
+        if (mr.block_state != BLOCK_INACTIVE) {  // mid-move, so the ring should not be empty
+            st_pre.low_water = min(st_pre.low_water, (uint8_t)(st_pre.write_index - st_pre.read_index));
+        }
         _load_move();                            // load the next move at the current interrupt level
     }
+    PF_END(PF_DDA);
 } // MOTATE_TIMER_INTERRUPT
+#endif // DDA_KERNEL_BITMAP
 } // namespace Motate
 
 /***** Dwell Interrupt Service Routine **************************************************
@@ -333,7 +432,7 @@ namespace Motate {            // Must define timer interrupts inside the Motate
     void dwell_timer_type::interrupt()
 {
     dwell_timer.getInterruptCause(); // read SR to clear interrupt condition
-    if (--st_run.dda_ticks_downcount == 0) {
+    if (--st_run.dwell_ticks_downcount == 0) {
         dwell_timer.stop();
         _load_move();
     }
@@ -344,11 +443,43 @@ namespace Motate {            // Must define timer interrupts inside the Motate
  * Exec sequencing code   - computes and prepares next load segment
  * st_request_exec_move() - SW interrupt to request to execute a move
  * exec_timer interrupt   - interrupt handler for calling exec function
+ * _prep_has_room()       - true if the exec may prep into the ring
+ * _prep_commit()         - hand the prepped slot to the loader
+ *
+ *  The exec is the only writer of write_index and the loader the only writer of
+ *  read_index, so the ring needs no locks (see stepper.h). Step bitmaps are handed
+ *  back the same way, with bitmaps_prepped and bitmaps_played.
  */
 
+static bool _prep_has_room()
+{
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    if ((uint8_t)(st_pre.bitmaps_prepped - st_pre.bitmaps_played) >= STEP_BITMAP_BUFFERS) {
+        return (false);                                     // both bitmaps are playing or waiting to
+    }
+#endif
+    uint8_t queued = (uint8_t)(st_pre.write_index - st_pre.read_index);
+    if (queued == 0) {
+        return (true);
+    }
+    if (queued >= PREP_BUFFER_SIZE) {
+        return (false);
+    }   // only run ahead of line segments. Anything else has to be loaded first
+    return (st_pre.buf[(st_pre.write_index - 1) & (PREP_BUFFER_SIZE-1)].block_type == BLOCK_TYPE_ALINE);
+}
+
+static void _prep_commit()
+{
+    uint8_t queued = (uint8_t)(st_pre.write_index + 1 - st_pre.read_index);
+    __atomic_store_n(&st_pre.write_index, (uint8_t)(st_pre.write_index + 1), __ATOMIC_RELEASE);
+    if (queued > st_pre.high_water) {
+        st_pre.high_water = queued;
+    }
+}
+
 void st_request_exec_move()
 {
-    if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) { // bother interrupting
+    if (_prep_has_room()) {                                 // bother interrupting
         exec_timer.setInterruptPending();
     }
 }
@@ -358,12 +489,17 @@ namespace Motate {    // Define timer inside Motate namespace
     void exec_timer_type::interrupt()
     {
         exec_timer.getInterruptCause();                    // clears the interrupt condition
-        if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {
-            if (mp_exec_move() != STAT_NOOP) {
-                st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
-                st_request_load_move();
+        PF_START(PF_EXEC);
+
+        // Prep until the ring is full, but only run ahead of line segments (see stepper.h)
+        while (_prep_has_room()) {
+            if (mp_exec_move() == STAT_NOOP) {
+                break;
             }
+            _prep_commit();                                 // hand it to the loader
+            st_request_load_move();
         }
+        PF_END(PF_EXEC);
     }
 } // namespace Motate
 
@@ -377,9 +513,11 @@ namespace Motate {    // Define timer inside Motate namespace
     void fwd_plan_timer_type::interrupt()
     {
         fwd_plan_timer.getInterruptCause();       // clears the interrupt condition
+        PF_START(PF_PLAN);
         if (mp_plan_move() != STAT_NOOP) { // We now have a move to exec.
             st_request_exec_move();
         }
+        PF_END(PF_PLAN);
     }
 } // namespace Motate
 
@@ -398,7 +536,7 @@ void st_request_load_move()
     if (st_runtime_isbusy()) {                                      // don't request a load if the runtime is busy
         return;
     }
-    if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) {       // bother interrupting
+    if (st_pre.write_index != st_pre.read_index) {                  // bother interrupting
         load_timer.setInterruptPending();
     }
 }
@@ -425,6 +563,23 @@ namespace Motate {    // Define timer inside Motate namespace
  *   - If axis has 0 steps the motor power must be set accord to the power mode
  */
 
+// rescale the accumulator phase to the new segment's depth (see st_prep_line())
+static inline int32_t _corrected_accumulator(const int32_t accumulator, const stPrepBufferMotor_t *mot)
+{
+#if (STEP_PREP == STEP_PREP_FIXED)
+    return ((int32_t)(((int64_t)accumulator * mot->accumulator_correction) / ((int64_t)1 << ACCUMULATOR_CORRECTION_SHIFT)));  // toward zero, as the float cast
+#else
+    return ((int32_t)(accumulator * mot->accumulator_correction));
+#endif
+}
+
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+#define CORRECT_ACCUMULATOR(m)      // done to the prep's accumulator by _prep_bitmap()
+#else
+#define CORRECT_ACCUMULATOR(m) st_run.mot[m].substep_accumulator = \
+    _corrected_accumulator(st_run.mot[m].substep_accumulator, &slot->mot[m]);
+#endif
+
 static void _load_move()
 {
     // Be aware that dda_ticks_downcount must equal zero for the loader to run.
@@ -432,7 +587,8 @@ static void _load_move()
     if (st_runtime_isbusy()) {
         return;                                                    // exit if the runtime is busy
     }
-    if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER) {    // if there are no moves to load...
+    PF_START(PF_LOAD);
+    if (__atomic_load_n(&st_pre.write_index, __ATOMIC_ACQUIRE) == st_pre.read_index) {  // if there are no moves to load...
 		
 	// ...start motor power timeouts
 	//	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
@@ -453,16 +609,19 @@ static void _load_move()
 #if (MOTORS > 5)
         motor_6.motionStopped();    // ...start motor power timeouts
 #endif
+        PF_END(PF_LOAD);
         return;
     }
 
+    stPrepBuffer_t *slot = &st_pre.buf[st_pre.read_index & (PREP_BUFFER_SIZE-1)];
+
     // handle aline loads first (most common case)  NB: there are no more lines, only alines
-    if (st_pre.block_type == BLOCK_TYPE_ALINE) {
+    if (slot->block_type == BLOCK_TYPE_ALINE) {
 
         //**** setup the new segment ****
 
-        st_run.dda_ticks_downcount = st_pre.dda_ticks;
-        st_run.dda_ticks_X_substeps = st_pre.dda_ticks_X_substeps;
+        st_run.dda_ticks_downcount = slot->dda_ticks;
+        st_run.dda_ticks_X_substeps = slot->dda_ticks_X_substeps;
 
         // INLINED VERSION: 4.3us
         //**** MOTOR_1 LOAD ****
@@ -471,31 +630,29 @@ static void _load_move()
         // is supposed to take < 5 uSec (Arm M3 core). Be careful if you mess with this.
 
         // the following if() statement sets the runtime substep increment value or zeroes it
-        if ((st_run.mot[MOTOR_1].substep_increment = st_pre.mot[MOTOR_1].substep_increment) != 0) {
+        if ((st_run.mot[MOTOR_1].substep_increment = slot->mot[MOTOR_1].substep_increment) != 0) {
 
             // NB: If motor has 0 steps the following is all skipped. This ensures that state comparisons
             //     always operate on the last segment actually run by this motor, regardless of how many
             //     segments it may have been inactive in between.
 
             // Apply accumulator correction if the time base has changed since previous segment
-            if (st_pre.mot[MOTOR_1].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_1].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_1].substep_accumulator *= st_pre.mot[MOTOR_1].accumulator_correction;
+            if (slot->mot[MOTOR_1].accumulator_correction_flag) {
+                CORRECT_ACCUMULATOR(MOTOR_1);
             }
 
             // Detect direction change and if so:
             //    Set the direction bit in hardware.
             //    Compensate for direction change by flipping substep accumulator value about its midpoint.
 
-            if (st_pre.mot[MOTOR_1].direction != st_pre.mot[MOTOR_1].prev_direction) {
-                st_pre.mot[MOTOR_1].prev_direction = st_pre.mot[MOTOR_1].direction;
+            if (slot->mot[MOTOR_1].direction_change) {
                 st_run.mot[MOTOR_1].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_1].substep_accumulator);
-                motor_1.setDirection(st_pre.mot[MOTOR_1].direction);
+                motor_1.setDirection(slot->mot[MOTOR_1].direction);
             }
 
             // Enable the stepper and start/update motor power management
             motor_1.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_1, st_pre.mot[MOTOR_1].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_1, slot->mot[MOTOR_1].step_sign);
 
         } else {  // Motor has 0 steps; might need to energize motor for power mode processing
             motor_1.motionStopped();
@@ -504,90 +661,80 @@ static void _load_move()
         ACCUMULATE_ENCODER(MOTOR_1);
 
 #if (MOTORS >= 2)
-        if ((st_run.mot[MOTOR_2].substep_increment = st_pre.mot[MOTOR_2].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_2].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_2].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_2].substep_accumulator *= st_pre.mot[MOTOR_2].accumulator_correction;
+        if ((st_run.mot[MOTOR_2].substep_increment = slot->mot[MOTOR_2].substep_increment) != 0) {
+            if (slot->mot[MOTOR_2].accumulator_correction_flag) {
+                CORRECT_ACCUMULATOR(MOTOR_2);
             }
-            if (st_pre.mot[MOTOR_2].direction != st_pre.mot[MOTOR_2].prev_direction) {
-                st_pre.mot[MOTOR_2].prev_direction = st_pre.mot[MOTOR_2].direction;
+            if (slot->mot[MOTOR_2].direction_change) {
                 st_run.mot[MOTOR_2].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_2].substep_accumulator);
-                motor_2.setDirection(st_pre.mot[MOTOR_2].direction);
+                motor_2.setDirection(slot->mot[MOTOR_2].direction);
             }
             motor_2.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_2, st_pre.mot[MOTOR_2].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_2, slot->mot[MOTOR_2].step_sign);
         } else {
             motor_2.motionStopped();
         }
         ACCUMULATE_ENCODER(MOTOR_2);
 #endif
 #if (MOTORS >= 3)
-        if ((st_run.mot[MOTOR_3].substep_increment = st_pre.mot[MOTOR_3].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_3].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_3].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_3].substep_accumulator *= st_pre.mot[MOTOR_3].accumulator_correction;
+        if ((st_run.mot[MOTOR_3].substep_increment = slot->mot[MOTOR_3].substep_increment) != 0) {
+            if (slot->mot[MOTOR_3].accumulator_correction_flag) {
+                CORRECT_ACCUMULATOR(MOTOR_3);
             }
-            if (st_pre.mot[MOTOR_3].direction != st_pre.mot[MOTOR_3].prev_direction) {
-                st_pre.mot[MOTOR_3].prev_direction = st_pre.mot[MOTOR_3].direction;
+            if (slot->mot[MOTOR_3].direction_change) {
                 st_run.mot[MOTOR_3].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_3].substep_accumulator);
-                motor_3.setDirection(st_pre.mot[MOTOR_3].direction);
+                motor_3.setDirection(slot->mot[MOTOR_3].direction);
             }
             motor_3.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_3, st_pre.mot[MOTOR_3].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_3, slot->mot[MOTOR_3].step_sign);
         } else {
             motor_3.motionStopped();
         }
         ACCUMULATE_ENCODER(MOTOR_3);
 #endif
 #if (MOTORS >= 4)
-        if ((st_run.mot[MOTOR_4].substep_increment = st_pre.mot[MOTOR_4].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_4].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_4].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_4].substep_accumulator *= st_pre.mot[MOTOR_4].accumulator_correction;
+        if ((st_run.mot[MOTOR_4].substep_increment = slot->mot[MOTOR_4].substep_increment) != 0) {
+            if (slot->mot[MOTOR_4].accumulator_correction_flag) {
+                CORRECT_ACCUMULATOR(MOTOR_4);
             }
-            if (st_pre.mot[MOTOR_4].direction != st_pre.mot[MOTOR_4].prev_direction) {
-                st_pre.mot[MOTOR_4].prev_direction = st_pre.mot[MOTOR_4].direction;
+            if (slot->mot[MOTOR_4].direction_change) {
                 st_run.mot[MOTOR_4].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_4].substep_accumulator);
-                motor_4.setDirection(st_pre.mot[MOTOR_4].direction);
+                motor_4.setDirection(slot->mot[MOTOR_4].direction);
             }
             motor_4.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_4, st_pre.mot[MOTOR_4].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_4, slot->mot[MOTOR_4].step_sign);
         } else {
             motor_4.motionStopped();
         }
         ACCUMULATE_ENCODER(MOTOR_4);
 #endif
 #if (MOTORS >= 5)
-        if ((st_run.mot[MOTOR_5].substep_increment = st_pre.mot[MOTOR_5].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_5].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_5].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_5].substep_accumulator *= st_pre.mot[MOTOR_5].accumulator_correction;
+        if ((st_run.mot[MOTOR_5].substep_increment = slot->mot[MOTOR_5].substep_increment) != 0) {
+            if (slot->mot[MOTOR_5].accumulator_correction_flag) {
+                CORRECT_ACCUMULATOR(MOTOR_5);
             }
-            if (st_pre.mot[MOTOR_5].direction != st_pre.mot[MOTOR_5].prev_direction) {
-                st_pre.mot[MOTOR_5].prev_direction = st_pre.mot[MOTOR_5].direction;
+            if (slot->mot[MOTOR_5].direction_change) {
                 st_run.mot[MOTOR_5].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_5].substep_accumulator);
-                motor_5.setDirection(st_pre.mot[MOTOR_5].direction);
+                motor_5.setDirection(slot->mot[MOTOR_5].direction);
             }
             motor_5.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_5, st_pre.mot[MOTOR_5].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_5, slot->mot[MOTOR_5].step_sign);
         } else {
             motor_5.motionStopped();
         }
         ACCUMULATE_ENCODER(MOTOR_5);
 #endif
 #if (MOTORS >= 6)
-        if ((st_run.mot[MOTOR_6].substep_increment = st_pre.mot[MOTOR_6].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_6].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_6].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_6].substep_accumulator *= st_pre.mot[MOTOR_6].accumulator_correction;
+        if ((st_run.mot[MOTOR_6].substep_increment = slot->mot[MOTOR_6].substep_increment) != 0) {
+            if (slot->mot[MOTOR_6].accumulator_correction_flag) {
+                CORRECT_ACCUMULATOR(MOTOR_6);
             }
-            if (st_pre.mot[MOTOR_6].direction != st_pre.mot[MOTOR_6].prev_direction) {
-                st_pre.mot[MOTOR_6].prev_direction = st_pre.mot[MOTOR_6].direction;
+            if (slot->mot[MOTOR_6].direction_change) {
                 st_run.mot[MOTOR_6].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_6].substep_accumulator);
-                motor_6.setDirection(st_pre.mot[MOTOR_6].direction);
+                motor_6.setDirection(slot->mot[MOTOR_6].direction);
             }
             motor_6.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_6, st_pre.mot[MOTOR_6].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_6, slot->mot[MOTOR_6].step_sign);
         } else {
             motor_6.motionStopped();
         }
@@ -596,24 +743,92 @@ static void _load_move()
 
         //**** do this last ****
 
+        st_pre.lines_loaded++;
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+        for (uint8_t motor=0; motor<MOTORS; motor++) {
+            en.en[motor].steps_run = slot->mot[motor].bitmap_steps;   // the DMA doesn't count them
+        }
+        board_step_dma_start(slot->bitmap, slot->dda_ticks);  // play it once the one playing ends
+#else
         dda_timer.start();                                    // start the DDA timer if not already running
+#endif
 
     // handle dwells
-    } else if (st_pre.block_type == BLOCK_TYPE_DWELL) {
-        st_run.dda_ticks_downcount = st_pre.dda_ticks;
-        dwell_timer.start();
+    } else if (slot->block_type == BLOCK_TYPE_DWELL) {
+        if ((st_run.dwell_ticks_downcount = slot->dda_ticks) != 0) {   // a zero length dwell (G4 P0) is done now
+            dwell_timer.start();
+        }
 
     // handle synchronous commands
-    } else if (st_pre.block_type == BLOCK_TYPE_COMMAND) {
-        mp_runtime_command(st_pre.bf);
+    } else if (slot->block_type == BLOCK_TYPE_COMMAND) {
+        mp_runtime_command(slot->bf);
 
     } // else null - WARNING - We cannot printf from here!! Causes crashes.
 
     // all other cases drop to here (e.g. Null moves after Mcodes skip to here)
-    st_pre.block_type = BLOCK_TYPE_NULL;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // we are done with the prep buffer - flip the flag back
+    slot->block_type = BLOCK_TYPE_NULL;
+    __atomic_store_n(&st_pre.read_index, (uint8_t)(st_pre.read_index + 1), __ATOMIC_RELEASE); // done with the slot - hand it back
     st_request_exec_move();                                // exec and prep next move
+    PF_END(PF_LOAD);
+}
+
+/***********************************************************************************
+ * _prep_bitmap() - run the DDA over a prepped line segment into the next step bitmap
+ *
+ *  This is the loader's accumulator setup and the packed DDA kernel done for every tick of
+ *  the segment at once. The accumulators are the prep's, carried from segment to segment
+ *  the way the runtime's are, so the bitmap steps exactly as the DDA interrupt would.
+ */
+
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+static boardStepBitmap_t st_bitmap[STEP_BITMAP_BUFFERS];
+
+static stat_t _prep_bitmap(stPrepBuffer_t *slot)
+{
+    if (slot->dda_ticks > STEP_BITMAP_TICKS) {                  // never supposed to happen
+        return (cm_panic(STAT_INTERNAL_ERROR, "st_prep_line() segment is longer than a step bitmap"));
+    }
+    const int32_t depth = slot->dda_ticks_X_substeps;
+    int32_t accumulator[MOTORS];
+    int32_t increment[MOTORS];
+    int32_t steps_run[MOTORS];
+
+    for (uint8_t motor=0; motor<MOTORS; motor++) {
+        accumulator[motor] = st_pre.mot[motor].substep_accumulator;
+        increment[motor] = slot->mot[motor].substep_increment;
+        steps_run[motor] = 0;
+        if (increment[motor] != 0) {
+            if (slot->mot[motor].accumulator_correction_flag) {
+                accumulator[motor] = _corrected_accumulator(accumulator[motor], &slot->mot[motor]);
+            }
+            if (slot->mot[motor].direction_change) {
+                accumulator[motor] = -(depth + accumulator[motor]);
+            }
+        }
+    }
+
+    boardStepBitmap_t *bitmap = &st_bitmap[st_pre.bitmaps_prepped & (STEP_BITMAP_BUFFERS-1)];
+    for (uint32_t tick=0; tick<slot->dda_ticks; tick++) {
+        uint32_t steps = 0;
+        for (uint8_t motor=0; motor<MOTORS; motor++) {      // same math as _dda_step()
+            int32_t next = accumulator[motor] + increment[motor];
+            uint32_t step = (next > 0);
+            accumulator[motor] = next - (int32_t)(depth & (0 - step));
+            steps_run[motor] += step;
+            steps |= step << motor;
+        }
+        board_step_bitmap_set(bitmap, tick, steps);
+    }
+
+    for (uint8_t motor=0; motor<MOTORS; motor++) {
+        st_pre.mot[motor].substep_accumulator = accumulator[motor];
+        slot->mot[motor].bitmap_steps = (increment[motor] == 0) ? 0 : steps_run[motor] * slot->mot[motor].step_sign;
+    }
+    slot->bitmap = bitmap;
+    st_pre.bitmaps_prepped++;
+    return (STAT_OK);
 }
+#endif // DDA_KERNEL_BITMAP
 
 /***********************************************************************************
  * st_prep_line() - Prepare the next move for the loader
@@ -639,10 +854,11 @@ static void _load_move()
  *          dda_ticks_X_substeps = (int32_t)((microseconds/1000000) * f_dda * dda_substeps);
  */
 
+#if (STEP_PREP == STEP_PREP_FLOAT)
 stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time)
 {
     // trap assertion failures and other conditions that would prevent queuing the line
-    if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_EXEC) {     // never supposed to happen
+    if ((uint8_t)(st_pre.write_index - st_pre.read_index) >= PREP_BUFFER_SIZE) {   // never supposed to happen
         return (cm_panic(STAT_INTERNAL_ERROR, "st_prep_line() prep sync error"));
     } else if (isinf(segment_time)) {                           // never supposed to happen
         return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE, "st_prep_line()"));
@@ -655,9 +871,10 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
     // - dda_ticks is the integer number of DDA clock ticks needed to play out the segment
     // - ticks_X_substeps is the maximum depth of the DDA accumulator (as a negative number)
 
-    //st_pre.dda_period = _f_to_period(FREQUENCY_DDA);                // FYI: this is a constant
-    st_pre.dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
-    st_pre.dda_ticks_X_substeps = st_pre.dda_ticks * DDA_SUBSTEPS;
+    stPrepBuffer_t *slot = &st_pre.buf[st_pre.write_index & (PREP_BUFFER_SIZE-1)];
+    //slot->dda_period = _f_to_period(FREQUENCY_DDA);                 // FYI: this is a constant
+    slot->dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA); // NB: converts minutes to seconds
+    slot->dda_ticks_X_substeps = slot->dda_ticks * DDA_SUBSTEPS;
 
     // setup motor parameters
 
@@ -666,7 +883,7 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 
         // Skip this motor if there are no new steps. Leave all other values intact.
         if (fp_ZERO(travel_steps[motor])) {
-            st_pre.mot[motor].substep_increment = 0;        // substep increment also acts as a motor flag
+            slot->mot[motor].substep_increment = 0;         // substep increment also acts as a motor flag
             continue;
         }
 
@@ -674,21 +891,28 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
         // Set the step_sign which is used by the stepper ISR to accumulate step position
 
         if (travel_steps[motor] >= 0) {                    // positive direction
-            st_pre.mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
-            st_pre.mot[motor].step_sign = 1;
+            slot->mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
+            slot->mot[motor].step_sign = 1;
         } else {
-            st_pre.mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
-            st_pre.mot[motor].step_sign = -1;
+            slot->mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
+            slot->mot[motor].step_sign = -1;
         }
 
+        // Detect direction changes against the last segment prepped for this motor. The loader
+        // flips the substep accumulator and sets the direction bit when it loads this segment.
+
+        slot->mot[motor].direction_change = (slot->mot[motor].direction != st_pre.mot[motor].prev_direction);
+        st_pre.mot[motor].prev_direction = slot->mot[motor].direction;
+
         // Detect segment time changes and setup the accumulator correction factor and flag.
         // Putting this here computes the correct factor even if the motor was dormant for some
         // number of previous moves. Correction is computed based on the last segment time actually used.
 
+        slot->mot[motor].accumulator_correction_flag = false;
         if (fabs(segment_time - st_pre.mot[motor].prev_segment_time) > 0.0000001) { // highly tuned FP != compare
             if (fp_NOT_ZERO(st_pre.mot[motor].prev_segment_time)) {                    // special case to skip first move
-                st_pre.mot[motor].accumulator_correction_flag = true;
-                st_pre.mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
+                slot->mot[motor].accumulator_correction_flag = true;
+                slot->mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
             }
             st_pre.mot[motor].prev_segment_time = segment_time;
         }
@@ -715,12 +939,108 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
         // Rounding is performed to eliminate a negative bias in the uint32 conversion
         // that results in long-term negative drift. (fabs/round order doesn't matter)
 
-        st_pre.mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+        slot->mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+    }
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    stat_t status = _prep_bitmap(slot);
+    if (status != STAT_OK) {
+        return (status);
+    }
+#endif
+    slot->block_type = BLOCK_TYPE_ALINE;                // the exec interrupt hands it to the loader
+    return (STAT_OK);
+}
+#endif // STEP_PREP_FLOAT
+
+/***********************************************************************************
+ * st_prep_line_fixed() - Prepare the next move for the loader without float math
+ *
+ *  The STEP_PREP_FIXED version of st_prep_line().
+ *
+ * Args:
+ *    - travel_substeps[] are signed relative motion in substeps (DDA_SUBSTEPS_FIXED per
+ *      step) for each motor, the difference of two target positions.
+ *
+ *    - following_error[] is the measured error in substeps, saturated to int32_t. Used for correction.
+ *
+ *    - segment_ticks - the segment time in DDA clock ticks, with SEGMENT_TICKS_SHIFT
+ *      fraction bits. The DDA runs the whole ticks.
+ *
+ *  The accumulator phase factor is the ratio of the new segment's time to that of the motor's
+ *  previous segment. It is taken from the fractional ticks and skipped for changes under
+ *  SEGMENT_TICKS_TOLERANCE, exactly as st_prep_line() does with the segment times, so the
+ *  DDA gets the same phase and the same pulses from either path.
+ */
+
+#if (STEP_PREP == STEP_PREP_FIXED)
+stat_t st_prep_line_fixed(const int32_t travel_substeps[], const int32_t following_error[], const uint32_t segment_ticks)
+{
+    uint32_t dda_ticks = segment_ticks >> SEGMENT_TICKS_SHIFT;
+
+    if ((uint8_t)(st_pre.write_index - st_pre.read_index) >= PREP_BUFFER_SIZE) {   // never supposed to happen
+        return (cm_panic(STAT_INTERNAL_ERROR, "st_prep_line() prep sync error"));
+    } else if (dda_ticks == 0) {
+        return (STAT_MINIMUM_TIME_MOVE);
+    }
+    stPrepBuffer_t *slot = &st_pre.buf[st_pre.write_index & (PREP_BUFFER_SIZE-1)];
+    slot->dda_ticks = dda_ticks;
+    slot->dda_ticks_X_substeps = dda_ticks * DDA_SUBSTEPS_FIXED;
+
+    for (uint8_t motor=0; motor<MOTORS; motor++) {
+        if (travel_substeps[motor] == 0) {
+            slot->mot[motor].substep_increment = 0;         // substep increment also acts as a motor flag
+            continue;
+        }
+
+        if (travel_substeps[motor] > 0) {                   // positive direction
+            slot->mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
+            slot->mot[motor].step_sign = 1;
+        } else {
+            slot->mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
+            slot->mot[motor].step_sign = -1;
+        }
+        slot->mot[motor].direction_change = (slot->mot[motor].direction != st_pre.mot[motor].prev_direction);
+        st_pre.mot[motor].prev_direction = slot->mot[motor].direction;
+
+        slot->mot[motor].accumulator_correction_flag = false;
+        uint32_t prev_ticks = st_pre.mot[motor].prev_segment_ticks;
+        if ((segment_ticks > prev_ticks + SEGMENT_TICKS_TOLERANCE) || (segment_ticks + SEGMENT_TICKS_TOLERANCE < prev_ticks)) {
+            if (prev_ticks != 0) {                                                      // skip the first move
+                slot->mot[motor].accumulator_correction_flag = true;
+                slot->mot[motor].accumulator_correction =
+                    ((int64_t)segment_ticks << ACCUMULATOR_CORRECTION_SHIFT) / prev_ticks;
+            }
+            st_pre.mot[motor].prev_segment_ticks = segment_ticks;
+        }
+
+        // 'Nudge' correction strategy, as in st_prep_line()
+        int32_t travel = travel_substeps[motor];
+        int32_t magnitude = (travel > 0) ? travel : -travel;
+        if ((--st_pre.mot[motor].correction_holdoff < 0) &&
+            ((following_error[motor] > STEP_CORRECTION_THRESHOLD_SUBSTEPS) ||
+             (following_error[motor] < -STEP_CORRECTION_THRESHOLD_SUBSTEPS))) {
+
+            st_pre.mot[motor].correction_holdoff = STEP_CORRECTION_HOLDOFF;
+            int64_t correction = (following_error[motor] * STEP_CORRECTION_FACTOR_Q8) / 256;
+            int32_t limit = min(magnitude, STEP_CORRECTION_MAX_SUBSTEPS);
+            int32_t correction_substeps = (correction > limit) ? limit : ((correction < -limit) ? -limit : (int32_t)correction);
+
+            st_pre.mot[motor].corrected_steps += (float)correction_substeps / DDA_SUBSTEPS_FIXED;  // diagnostic only
+            travel -= correction_substeps;
+            magnitude = (travel > 0) ? travel : -travel;
+        }
+        slot->mot[motor].substep_increment = magnitude;    // exact - no rounding
+    }
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    stat_t status = _prep_bitmap(slot);
+    if (status != STAT_OK) {
+        return (status);
     }
-    st_pre.block_type = BLOCK_TYPE_ALINE;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+#endif
+    slot->block_type = BLOCK_TYPE_ALINE;                // the exec interrupt hands it to the loader
     return (STAT_OK);
 }
+#endif // STEP_PREP_FIXED
 
 /*
  * st_prep_null() - Keeps the loader happy. Otherwise performs no action
@@ -728,8 +1048,7 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 
 void st_prep_null()
 {
-    st_pre.block_type = BLOCK_TYPE_NULL;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // signal that prep buffer is empty
+    st_pre.buf[st_pre.write_index & (PREP_BUFFER_SIZE-1)].block_type = BLOCK_TYPE_NULL;
 }
 
 /*
@@ -738,9 +1057,9 @@ void st_prep_null()
 
 void st_prep_command(void *bf)
 {
-    st_pre.block_type = BLOCK_TYPE_COMMAND;
-    st_pre.bf = (mpBuf_t *)bf;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    stPrepBuffer_t *slot = &st_pre.buf[st_pre.write_index & (PREP_BUFFER_SIZE-1)];
+    slot->block_type = BLOCK_TYPE_COMMAND;
+    slot->bf = (mpBuf_t *)bf;
 }
 
 /*
@@ -749,10 +1068,10 @@ void st_prep_command(void *bf)
 
 void st_prep_dwell(float microseconds)
 {
-    st_pre.block_type = BLOCK_TYPE_DWELL;
-    //st_pre.dda_period = _f_to_period(FREQUENCY_DWELL);
-    st_pre.dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL);
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    stPrepBuffer_t *slot = &st_pre.buf[st_pre.write_index & (PREP_BUFFER_SIZE-1)];
+    slot->block_type = BLOCK_TYPE_DWELL;
+    //slot->dda_period = _f_to_period(FREQUENCY_DWELL);
+    slot->dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL);
 }
 
 /*
@@ -763,7 +1082,7 @@ void st_prep_dwell(float microseconds)
 void st_request_out_of_band_dwell(float microseconds)
 {
     st_prep_dwell(microseconds);
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    _prep_commit();                                     // signal that prep buffer is ready
     st_request_load_move();
 }
 
@@ -810,9 +1129,11 @@ static void _set_motor_steps_per_unit(nvObj_t *nv)
     uint8_t m = _get_motor(nv->index);
     st_cfg.mot[m].units_per_step = (st_cfg.mot[m].travel_rev * st_cfg.mot[m].step_angle) / (360 * st_cfg.mot[m].microsteps);
     st_cfg.mot[m].steps_per_unit = 1/st_cfg.mot[m].units_per_step;
+    kn_config_changed();
 }
 
 /* PER-MOTOR FUNCTIONS
+ * st_set_ma() - set motor map (axis)
  * st_set_sa() - set motor step angle
  * st_set_tr() - set travel per motor revolution
  * st_set_mi() - set motor microsteps
@@ -821,6 +1142,13 @@ static void _set_motor_steps_per_unit(nvObj_t *nv)
  * st_set_pl() - set motor power level
  */
 
+stat_t st_set_ma(nvObj_t *nv)            // motor map
+{
+    set_ui8(nv);
+    kn_config_changed();
+    return(STAT_OK);
+}
+
 stat_t st_set_sa(nvObj_t *nv)            // motor step angle
 {
     set_flt(nv);
@@ -868,7 +1196,7 @@ stat_t st_set_su(nvObj_t *nv)			// motor steps per unit (direct)
     // Scale TR so all the other values make sense
     // You could scale any one of the other values, but TR makes the most sense
     st_cfg.mot[m].travel_rev = (360.0*st_cfg.mot[m].microsteps)/(st_cfg.mot[m].steps_per_unit*st_cfg.mot[m].step_angle);
-
+    kn_config_changed();
     return(STAT_OK);
 }
 
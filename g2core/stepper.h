@@ -242,6 +242,21 @@
  *  be thought of as a phase angle value for the DDA accumulation. Each 360
  *  degrees of phase angle results in a step being generated.
  */
+/* Prep ring
+ *
+ *  The "prep buffer" above is a ring of PREP_BUFFER_SIZE prepped segments (st_pre.buf).
+ *  The exec (LO) is the only writer of write_index and the loader (HI/MED) the only
+ *  writer of read_index, so neither side locks. After a line segment is prepped the exec
+ *  keeps going until the ring is full, so it can fall behind by several segments before
+ *  the DDA notices. Commands, dwells and null preps stop the run-ahead - the exec waits
+ *  until the loader has taken them, so they are acted on in the same order as before.
+ *
+ *  Running ahead puts the runtime (mr) and the steppers up to PREP_BUFFER_SIZE segments
+ *  apart. Encoder feedback is matched to the segment the DDA last finished (see
+ *  st_get_lines_loaded()) and a feedhold starts its deceleration after the segments
+ *  already in the ring. Boards size the ring with PREP_BUFFER_SIZE in hardware.h, using
+ *  $_pbh and $_pbl (the most and fewest segments seen waiting) to check it.
+ */
 
 // These includes must be BEFORE the STEPPER_H_ONCE is defined
 #include "g2core.h"
@@ -259,10 +274,9 @@
  *********************************/
 //See hardware.h for platform specific stepper definitions
 
-typedef enum {
-    PREP_BUFFER_OWNED_BY_LOADER = 0,    // staging buffer is ready for load
-    PREP_BUFFER_OWNED_BY_EXEC           // staging buffer is being loaded
-} prepBufferState;
+#ifndef PREP_BUFFER_SIZE
+#define PREP_BUFFER_SIZE ((uint8_t)4)   // segments exec may prep ahead of the loader - must be a power of 2
+#endif
 
 typedef enum {                          // used w/start and stop flags to sequence motor power
     MOTOR_OFF = 0,                      // motor is stopped and deenergized
@@ -305,14 +319,14 @@ typedef enum {
  *
  *    MAX_LONG == 2^31, maximum signed long (depth of accumulator. NB: accumulator values are negative)
  *    FREQUENCY_DDA == DDA clock rate in Hz.
- *    NOM_SEGMENT_TIME == upper bound of segment time in minutes
+ *    MAX_SEGMENT_TIME == upper bound of segment time in minutes (cruise bodies run the longest segments)
  *    0.90 == a safety factor used to reduce the result from theoretical maximum
  *
  *  The number is about 8.5 million for the Xmega running a 50 KHz DDA with 5 millisecond segments
- *  The ARM is roughly the same as the DDA clock rate is 4x higher but the segment time is ~1/5
- *  Decreasing the nominal segment time increases the number precision.
+ *  The ARM at 150 KHz with 5 millisecond cruise segments gets about 2.6 million.
+ *  Decreasing the maximum segment time increases the number precision.
  */
-#define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (NOM_SEGMENT_TIME * 60)))
+#define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (MAX_SEGMENT_TIME * 60)))
 
 /* Step correction settings
  *
@@ -328,6 +342,73 @@ typedef enum {
 #define STEP_CORRECTION_MAX         (float)0.60     // max step correction allowed in a single segment
 #define STEP_CORRECTION_HOLDOFF            5        // minimum number of segments to wait between error correction
 
+/* Step prep path
+ *
+ *  STEP_PREP_FLOAT hands st_prep_line() each segment's travel in float steps and its time in
+ *  minutes, and st_prep_line() does the conversions and the correction math in float.
+ *
+ *  STEP_PREP_FIXED keeps motor positions as int64_t counts of substeps (DDA_SUBSTEPS_FIXED per
+ *  step). The exec converts the kinematics' target steps once per segment, and a segment's
+ *  substep increment is the difference of two such positions, so rounding is never carried
+ *  from one segment to the next. st_prep_line_fixed() takes the travel, the following error
+ *  and the segment time in DDA ticks as integers and does the correction and the accumulator
+ *  phase factor in integer math. The loader applies the factor with one 64 bit multiply.
+ *
+ *  Both paths give the DDA the same pulses. The fixed path gets the segment time in
+ *  fractional ticks, so it rescales the accumulator on the same segments as the float path and
+ *  by the same ratio, and rounds the rescaled accumulator toward zero as the float cast does.
+ */
+#define STEP_PREP_FLOAT             0
+#define STEP_PREP_FIXED             1
+#ifndef STEP_PREP
+#define STEP_PREP                   STEP_PREP_FLOAT
+#endif
+
+#define DDA_SUBSTEPS_FIXED          ((int32_t)DDA_SUBSTEPS)     // substeps per step, as an integer
+#define ACCUMULATOR_CORRECTION_SHIFT    30                      // binary point of the fixed point phase factor
+#define SEGMENT_TICKS_SHIFT         8                           // binary point of the segment length in DDA ticks
+#define SEGMENT_TICKS_TOLERANCE     ((uint32_t)(0.0000001 * 60 * FREQUENCY_DDA * (1 << SEGMENT_TICKS_SHIFT)))  // st_prep_line()'s time compare
+
+#define STEP_CORRECTION_THRESHOLD_SUBSTEPS  ((int32_t)(STEP_CORRECTION_THRESHOLD * DDA_SUBSTEPS_FIXED))
+#define STEP_CORRECTION_FACTOR_Q8           ((int64_t)(STEP_CORRECTION_FACTOR * 256))
+#define STEP_CORRECTION_MAX_SUBSTEPS        ((int32_t)(STEP_CORRECTION_MAX * DDA_SUBSTEPS_FIXED))
+
+/* DDA step kernel
+ *
+ *  The DDA interrupt runs at FREQUENCY_DDA, so its cost per motor sets how fast the DDA can
+ *  be clocked. DDA_KERNEL_BRANCHED tests each motor's accumulator and sets its step pin on
+ *  its own. DDA_KERNEL_PACKED steps all accumulators without branching, collects the motors
+ *  that overflowed in a bitmask (bit 0 is motor_1), and hands the mask to the board. The
+ *  board turns it into step pins with tables of port masks built at compile time from its
+ *  step pin map (see stStepPortMasks below), one store per port the step pins are on.
+ *  Step pins are cleared the same way on the next tick.
+ *
+ *  A board that supplies board_step_start() and board_step_end() defines BOARD_STEP_PORTS
+ *  in its board_stepper.h, and can then be built with DDA_KERNEL=1. The branched kernel
+ *  stays the default: on the sim host the packed one is slower (30-34 against 10-17 ns a
+ *  tick, PF_ENABLE=0), and it has yet to be timed on a Cortex-M, where any gain would show.
+ *
+ *  DDA_KERNEL_BITMAP takes no interrupt per tick. The prep runs the packed kernel's math for
+ *  every tick of the segment and stores the port masks in a step bitmap, one entry per
+ *  tick. When the loader loads the segment it hands the bitmap to a DMA channel, which a
+ *  timer makes write one entry to the step port(s) per DDA tick and clear it half a tick
+ *  later. The DMA's end of buffer interrupt pends the DDA interrupt, which runs only at
+ *  segment boundaries to load the next segment. The accumulators move from the runtime to
+ *  the prep, and the encoder is given each segment's step count at load time.
+ *
+ *  Bitmaps are double buffered. The exec may prep a segment only while one of the two is
+ *  free, i.e. not playing and not waiting to play, so the run-ahead is one segment.
+ *  A board offers it by defining BOARD_STEP_DMA and supplying boardStepBitmap_t with
+ *  board_step_bitmap_set(), board_step_dma_start() and board_step_dma_stop(). It is
+ *  chosen by building with DDA_KERNEL=2.
+ */
+#define DDA_KERNEL_BRANCHED     0
+#define DDA_KERNEL_PACKED       1
+#define DDA_KERNEL_BITMAP       2
+
+#define STEP_BITMAP_TICKS       ((uint32_t)(MAX_SEGMENT_MS * FREQUENCY_DDA / 1000) + 1) // entries in a bitmap - the longest segment's ticks
+#define STEP_BITMAP_BUFFERS     2
+
 /*
  * Stepper control structures
  *
@@ -380,49 +461,115 @@ typedef struct stRunMotor {                 // one per controlled motor
 typedef struct stRunSingleton {             // Stepper static values and axis parameters
     magic_t magic_start;                    // magic number to test memory integrity
     uint32_t dda_ticks_downcount;           // tick down-counter (unscaled)
+    uint32_t dwell_ticks_downcount;         // dwell tick down-counter - apart from the DDA's, which may still tick once
     uint32_t dda_ticks_X_substeps;          // ticks multiplied by scaling factor
     stRunMotor_t mot[MOTORS];               // runtime motor structures
     magic_t magic_end;
 } stRunSingleton_t;
 
-// Motor prep structure. Used by exec/prep ISR (MED) and read-only during load
-// Must be careful about volatiles in this one
+// Motor prep structures. Used by exec/prep ISR (LO) and read-only during load
 
-typedef struct stPrepMotor {
-    uint32_t substep_increment;             // total steps in axis times substep factor
-    bool motor_flag;                        // true if motor is participating in this move
-
-    // direction and direction change
-    uint8_t direction;                      // travel direction corrected for polarity (CW==0. CCW==1)
-    uint8_t prev_direction;                 // travel direction from previous segment run for this motor
-    int8_t step_sign;                       // set to +1 or -1 for encoders
+typedef struct stPrepMotor {                // exec's running state for each motor
+    uint8_t prev_direction;                 // travel direction of the last segment prepped for this motor
 
     // following error correction
     int32_t correction_holdoff;             // count down segments between corrections
     float corrected_steps;                  // accumulated correction steps for the cycle (for diagnostic display only)
 
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    int32_t substep_accumulator;            // DDA phase angle accumulator - the prep runs the DDA
+#endif
+
     // accumulator phase correction
-    float prev_segment_time;                // segment time from previous segment run for this motor
-    float accumulator_correction;           // factor for adjusting accumulator between segments
-    uint8_t accumulator_correction_flag;    // signals accumulator needs correction
+#if (STEP_PREP == STEP_PREP_FIXED)
+    uint32_t prev_segment_ticks;            // fractional DDA ticks of the previous segment prepped for this motor
+#else
+    float prev_segment_time;                // segment time from previous segment prepped for this motor
+#endif
 } stPrepMotor_t;
 
-typedef struct stPrepSingleton {
-    magic_t magic_start;                    // magic number to test memory integrity
-    volatile prepBufferState buffer_state;  // prep buffer state - owned by exec or loader
-    struct mpBuffer *bf;                    // static pointer to relevant buffer
-    blockType block_type;                   // move type (requires planner.h)
-
-    //uint16_t dda_period;                    // DDA or dwell clock period setting (No longer used)
+typedef struct stPrepBufferMotor {          // one motor of one prepped segment
+    uint32_t substep_increment;             // total steps in axis times substep factor. 0 if the motor doesn't move
+    uint8_t direction;                      // travel direction corrected for polarity (CW==0. CCW==1)
+    bool direction_change;                  // direction differs from the last segment that moved this motor
+    int8_t step_sign;                       // set to +1 or -1 for encoders
+    bool accumulator_correction_flag;       // signals accumulator needs correction
+#if (STEP_PREP == STEP_PREP_FIXED)
+    int64_t accumulator_correction;         // factor for adjusting accumulator, binary point at ACCUMULATOR_CORRECTION_SHIFT
+#else
+    float accumulator_correction;           // factor for adjusting accumulator between segments
+#endif
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    int16_t bitmap_steps;                   // signed steps in the segment's bitmap, for the encoder
+#endif
+} stPrepBufferMotor_t;
+
+typedef struct stPrepBuffer {               // one slot of the prep ring
+    blockType block_type;                   // move type (requires planner.h). NULL when empty
+    struct mpBuffer *bf;                    // static pointer to relevant buffer (commands)
     uint32_t dda_ticks;                     // DDA or dwell ticks for the move
     uint32_t dda_ticks_X_substeps;          // DDA ticks scaled by substep factor
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    struct boardStepBitmap *bitmap;         // the segment's step bitmap (see board_stepper.h)
+#endif
+    stPrepBufferMotor_t mot[MOTORS];
+} stPrepBuffer_t;
+
+typedef struct stPrepSingleton {
+    magic_t magic_start;                    // magic number to test memory integrity
+    volatile uint8_t write_index;           // slots prepped - written by exec only (free running, masked on use)
+    volatile uint8_t read_index;            // slots loaded - written by the loader only
+    volatile uint32_t lines_loaded;         // line segments loaded since reset - written by the loader only
+    uint8_t high_water;                     // most segments seen waiting when one was added ($_pbh)
+    uint8_t low_water;                      // fewest seen waiting when the DDA finished a segment mid-move ($_pbl)
+#if (DDA_KERNEL == DDA_KERNEL_BITMAP)
+    volatile uint8_t bitmaps_prepped;       // step bitmaps filled - written by exec only (free running)
+    volatile uint8_t bitmaps_played;        // step bitmaps played out by the DMA - written by the DDA interrupt only
+#endif
     stPrepMotor_t mot[MOTORS];              // prep time motor structs
+    stPrepBuffer_t buf[PREP_BUFFER_SIZE];
     magic_t magic_end;
 } stPrepSingleton_t;
 
 extern stConfig_t st_cfg;                   // config struct is exposed. The rest are private
 extern stPrepSingleton_t st_pre;            // only used by config_app diagnostics
 
+// Step port masks for the packed DDA kernel. Built at compile time, e.g.
+//
+//    constexpr stStepPin_t board_step_pins[MOTORS] = { st_step_pin<Motate::kSocket1_StepPinNumber>(), ...};
+//    constexpr stStepPortMasks board_step_port_a{'A', board_step_pins};
+//
+// then board_step_start(steps) writes board_step_port_a.mask[steps] to the port's set register.
+
+typedef struct stStepPin {                  // where a motor's step pin is
+    uint8_t port;                           // port letter, 0 if the motor has no step pin
+    uint32_t mask;                          // the pin's bit in the port
+} stStepPin_t;
+
+template <Motate::pin_number step_num>
+constexpr stStepPin_t st_step_pin() {
+    return (Motate::Pin<step_num>::isNull() ? stStepPin_t{0, 0} :
+            stStepPin_t{Motate::Pin<step_num>::portLetter, Motate::Pin<step_num>::mask});
+}
+
+struct stStepPortMasks {                    // one port's step pins for every combination of stepping motors
+    uint8_t port;                           // port letter
+    uint32_t all;                           // all step pins on this port - 0 if there are none
+    uint32_t mask[1 << MOTORS];             // indexed by the step bitmask of the packed DDA kernel
+
+    constexpr stStepPortMasks(const uint8_t port_letter, const stStepPin_t (&pins)[MOTORS]) :
+        port{port_letter}, all{0}, mask{} {
+        for (uint32_t steps = 0; steps < (1 << MOTORS); steps++) {
+            for (uint8_t motor = 0; motor < MOTORS; motor++) {
+                if ((steps & (1 << motor)) && (pins[motor].port == port_letter)) {
+                    mask[steps] |= pins[motor].mask;
+                }
+            }
+        }
+        all = mask[(1 << MOTORS) - 1];
+    }
+};
+
 
 /**** Stepper (base object) ****/
 
@@ -566,6 +713,7 @@ stat_t st_clc(nvObj_t *nv);
 void st_set_motor_power(const uint8_t motor);
 stat_t st_motor_power_callback(void);
 
+uint32_t st_get_lines_loaded(void);
 void st_request_plan_move(void);
 void st_request_exec_move(void);
 void st_request_load_move(void);
@@ -575,7 +723,9 @@ void st_prep_dwell(float microseconds);
 void st_request_out_of_band_dwell(float microseconds);
 //stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
 stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
+stat_t st_prep_line_fixed(const int32_t travel_substeps[], const int32_t following_error[], const uint32_t segment_ticks);
 
+stat_t st_set_ma(nvObj_t *nv);
 stat_t st_set_sa(nvObj_t *nv);
 stat_t st_set_tr(nvObj_t *nv);
 stat_t st_set_mi(nvObj_t *nv);
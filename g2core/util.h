@@ -58,7 +58,7 @@ inline void _debug_trap(const char *reason) {
     // and might be deep in an ISR, so we had better just _NOP() and hope for the best.
     __NOP();
 #ifdef IN_DEBUGGER
-    __asm__("BKPT");
+    __BKPT(0);
 #endif
 }
 #pragma GCC reset_options
@@ -109,12 +109,11 @@ using std::isnan;
 using std::isinf;
 using std::min;
 using std::max;
+using std::abs;
 
 template <typename T>
 inline T square(const T x) { return (x)*(x); }        /* UNSAFE */
 
-inline float abs(const float a) { return fabs(a); }
-
 #ifndef avg
 template <typename T>
 inline T avg(const T a,const T b) {return (a+b)/2; }